@@ -0,0 +1,92 @@
+#include <cmath>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <filesystem>
+
+#include "../include/mapping.h"
+#include "../include/analysis.h"
+// the allocations of a tick are counted as by the entrypoint
+#include "../include/allocation_counting.h"
+#include "bench_support.h"
+
+/**
+ * A tick of a synthetic watchlist (100k symbols by default) evaluated by the analyzer
+ * with the given shard counts (TTM_SHARDS)
+ * - the prices oscillate within the Bollinger bands, no symbol trades
+ * (the tick is the indicators and the merge of the decisions)
+ * - e.g. ./bench/analysis_shards_bench 100000 20 1,2,auto
+ */
+
+#ifndef ANALYSIS_SHARDS_BENCHMARKS
+
+/**
+ * @returns price of a synthetic symbol, it alternates between two values
+ */
+inline static double get_synthetic_price(size_t symbol, size_t tick) {
+	double base = 1 + (double)(symbol % 1000);
+	return (symbol + tick) % 2 == 0 ? base : base * 1.001;
+}
+
+double measure_shards(const std::string& shard_count, size_t symbol_count, size_t ticks) {
+	setenv("TTM_SHARDS", shard_count.c_str(), 1);
+	auto symbols = std::make_shared<SymbolTable>();
+	SymbolMap<std::deque<double>> close_prices;
+	TokenTable tokens;
+	std::vector<SymbolId> due;
+	due.reserve(symbol_count);
+	for (size_t i = 0; i < symbol_count; ++i) {
+		SymbolId symbol = symbols->intern("SYN" + std::to_string(i) + "USDT");
+		auto&& prices = close_prices[symbol];
+		// a full period of rows for both indicators
+		for (size_t row = 0; row < 30; ++row) {
+			prices.push_back(get_synthetic_price(i, row));
+		}
+		tokens.insert(symbol, prices.back());
+		due.push_back(symbol);
+	}
+	auto analyzer = create_shared<Analyzer>(symbols);
+	analyzer->prepare(close_prices);
+	close_prices = {};
+	double per_tick = measure("TTM_SHARDS=" + shard_count, ticks, [&](size_t tick) {
+		int64_t timestamp = get_unix_time_ms();
+		for (size_t position = 0; position < tokens.size(); ++position) {
+			tokens.set_quote(position, get_synthetic_price(position, tick), timestamp, "Synthetic");
+		}
+		analyzer->get_analysis(tokens, due, false);
+		return tokens.get_values()[tick % tokens.size()];
+	});
+	auto&& stats = analyzer->get_allocation_stats();
+	print("  ", per_tick / (double)symbol_count, " ns per symbol, ", stats.allocating_ticks, " of ", stats.ticks,
+		" ticks allocated (warm-up), ", stats.last_tick, " allocations in the last tick, ", stats.arena_bytes, " arena bytes\n");
+	return per_tick;
+}
+
+int main(int argc, char** argv) {
+	size_t symbol_count = argc > 1 ? convert_string_to<size_t>(argv[1]) : 100'000;
+	size_t ticks = argc > 2 ? convert_string_to<size_t>(argv[2]) : 20;
+	std::string shard_counts = argc > 3 ? argv[3] : "1,auto";
+	auto&& previous = std::filesystem::current_path();
+	auto&& directory = previous / "analysis_shards_bench";
+	print("Evaluating ", symbol_count, " synthetic symbols per tick\n");
+	double single = 0;
+	for (auto&& shard_count : tokenize(shard_counts, ',')) {
+		// the analyzer keeps its journal and snapshots relative to the working directory,
+		// every run starts without them
+		std::filesystem::remove_all(directory);
+		std::filesystem::create_directories(directory);
+		std::filesystem::current_path(directory);
+		double per_tick = measure_shards(shard_count, symbol_count, ticks);
+		std::filesystem::current_path(previous);
+		if (single == 0) {
+			single = per_tick;
+		}
+		else {
+			print("  ", single / per_tick, "x the first shard count\n");
+		}
+	}
+	std::filesystem::remove_all(directory);
+	return 0;
+}
+
+#endif // !ANALYSIS_SHARDS_BENCHMARKS
@@ -0,0 +1,38 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+#include "../include/utilities.h"
+
+/**
+ * Benchmark support header
+ * @brief Timing shared by the micro-benchmarks
+ * - a benchmark is a function called repeatedly, the result it returns
+ * is accumulated so that the compiler cannot drop the work
+ */
+
+#ifndef BENCH_SUPPORT
+
+/**
+ * @brief Runs the function the given number of times and prints the time per call
+ * @returns the mean time per call in ns
+ */
+template <typename Function>
+double measure(const std::string& name, size_t iterations, Function&& function) {
+	volatile double sink = 0;
+	// warm-up (caches, branch predictors, lazily initialized state)
+	for (size_t i = 0; i < iterations / 10 + 1; ++i) {
+		sink = sink + function(i);
+	}
+	auto&& started = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; ++i) {
+		sink = sink + function(i);
+	}
+	auto&& elapsed = std::chrono::steady_clock::now() - started;
+	double per_call = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / (double)iterations;
+	print(name, ": ", per_call, " ns per call (", iterations, " calls)\n");
+	return per_call;
+}
+
+#endif // !BENCH_SUPPORT
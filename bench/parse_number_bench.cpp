@@ -0,0 +1,63 @@
+#include <vector>
+#include <string>
+#include <locale>
+#include <sstream>
+#include <stdexcept>
+
+#include "bench_support.h"
+
+/**
+ * parse_number (std::from_chars) against the conversions it has replaced
+ * on strings shaped like the exchange prices (8 decimals) and dataset cells
+ */
+
+#ifndef PARSE_NUMBER_BENCHMARKS
+
+/**
+ * @brief The conversion before parse_number (an istringstream per value)
+ */
+template <typename T>
+T convert_by_stream(const std::string& str) {
+	T converted {};
+	std::istringstream s_stream(str);
+	if (!(s_stream >> converted)) {
+		throw std::invalid_argument("Can't be converted.");
+	}
+	return converted;
+}
+
+std::vector<std::string> get_prices(size_t count) {
+	std::vector<std::string> prices;
+	prices.reserve(count);
+	std::mt19937 generator(42);
+	std::uniform_real_distribution<double> distribution(0.00001, 70000);
+	for (size_t i = 0; i < count; ++i) {
+		std::ostringstream os;
+		os << std::fixed << std::setprecision(8) << distribution(generator);
+		prices.push_back(os.str());
+	}
+	return prices;
+}
+
+int main(int argc, char** argv) {
+	size_t iterations = argc > 1 ? convert_string_to<size_t>(argv[1]) : 2'000'000;
+	std::vector<std::string> prices = get_prices(4096);
+	size_t mask = prices.size() - 1;
+	print("Parsing ", prices.size(), " distinct prices (e.g. ", prices[0], ")\n");
+	double parsed = measure("parse_number", iterations, [&](size_t i) {
+		double value = 0;
+		parse_number(prices[i & mask], value);
+		return value;
+	});
+	double converted = measure("convert_string_to", iterations, [&](size_t i) {
+		return convert_string_to<double>(prices[i & mask]);
+	});
+	double streamed = measure("istringstream (former convert_string_to)", iterations, [&](size_t i) {
+		return convert_by_stream<double>(prices[i & mask]);
+	});
+	print("parse_number is ", streamed / parsed, "x faster than the istringstream, ",
+		converted / parsed, "x faster than convert_string_to\n");
+	return 0;
+}
+
+#endif // !PARSE_NUMBER_BENCHMARKS
@@ -0,0 +1,41 @@
+#pragma once
+#include <new>
+#include <cstdlib>
+
+#include "tick_arena.h"
+
+/**
+ * @brief Replaces the global operator new/delete so that every heap allocation
+ * of the process is counted (see tick_arena.h)
+ * - included once per executable (the entrypoint, the benchmarks)
+ * - array and nothrow forms end up here as well
+ * - the deallocation is not inlined, GCC would report its free() as mismatched
+ * with the replaced operator new (-Wmismatched-new-delete)
+ */
+
+#if defined(__GNUC__)
+#define TTM_NOINLINE __attribute__((noinline))
+#else
+#define TTM_NOINLINE
+#endif
+
+#ifndef ALLOCATION_COUNTING
+
+void* operator new(std::size_t size) {
+	heap_allocations.fetch_add(1, std::memory_order_relaxed);
+	++thread_heap_allocations;
+	if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+		return pointer;
+	}
+	throw std::bad_alloc();
+}
+
+TTM_NOINLINE void operator delete(void* pointer) noexcept {
+	std::free(pointer);
+}
+
+TTM_NOINLINE void operator delete(void* pointer, std::size_t) noexcept {
+	std::free(pointer);
+}
+
+#endif // !ALLOCATION_COUNTING
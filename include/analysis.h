@@ -6,14 +6,26 @@
 #include <fstream>
 #include <filesystem>
 #include <numeric>
+#include <atomic>
+#include <thread>
+#include <optional>
 
 #include "stats.h"
+#include "crypto_token.h"
 #include "utilities.h"
+#include "symbol_table.h"
+#include "csv_loader.h"
+#include "journal_writer.h"
+#include "trade_journal.h"
+#include "state_snapshot.h"
+#include "transaction_store.h"
+#include "market_view.h"
+#include "shard_pool.h"
+#include "tick_arena.h"
 
 namespace fs = std::filesystem;
 using matrix = std::deque<std::deque<double>>;
-using data_map = std::unordered_map<std::string, matrix>;
-using crypto_map = std::unordered_map<std::string, std::shared_ptr<CryptoToken>>;
+using data_map = SymbolMap<matrix>;
 using action_map = std::unordered_map<Action, std::string>;
 
 /**
@@ -25,6 +37,11 @@ using action_map = std::unordered_map<Action, std::string>;
  */
 class Analyzer {
 public:
+	/**
+	 * @brief Writes the final snapshot of the state (if snapshots are enabled).
+	 */
+	~Analyzer();
+
 	/**
 	 * 
 	 * @brief A set of initialization methods
@@ -33,12 +50,12 @@ public:
 
 	/**
 	 * @brief API function used to process various crypto tokens (symbols)
-	 * @param data - input data - keys as symbols,
-	 * values as cryptocurrency tokens with info needed for the analysis
+	 * @param tokens - watched cryptocurrencies with info needed for the analysis
+	 * @param due - symbols to be analyzed in this tick (in the order of the watchlist)
 	 * @param shall_add - whether the findings should be added to the dataset or not
 	 * -- adding happens only once upon a time
 	 */
-	void get_analysis(crypto_map& data, bool shall_add);
+	void get_analysis(const TokenTable& tokens, const std::vector<SymbolId>& due, bool shall_add);
 
 	/**
 	 * @brief Prepares dataset from previously created csv file
@@ -51,7 +68,35 @@ public:
 	 * @brief Prepares dataset from the polished output of rest api call
 	 * @param dictionary - a dictionary where keys are symbols (i. e. BTCUSDT), values are column records
 	 */
-	void prepare(const std::unordered_map<std::string, std::deque<double>>& dictionary);
+	void prepare(const SymbolMap<std::deque<double>>& dictionary);
+
+	/**
+	 * @brief Continues the dataset preparation of an already prepared symbol
+	 * @param symbol - cryptocurrency
+	 * @param close_prices - closing prices which follow the last dataset row
+	 */
+	void extend(SymbolId symbol, const std::deque<double>& close_prices);
+
+	/**
+	 * @brief Restores dataset rows of a symbol (i.e. from a cached checkpoint)
+	 * @param symbol - cryptocurrency
+	 * @param rows - dataset rows as returned by get_rows
+	 */
+	void restore(SymbolId symbol, const matrix& rows);
+
+	/**
+	 * @returns Dataset rows of a symbol (empty if the symbol is not prepared)
+	 */
+	matrix get_rows(SymbolId symbol) const;
+
+	/**
+	 * @brief Resumes the indicator state of a symbol from the snapshot
+	 * loaded upon the start
+	 * - only a snapshot younger than one dataset row (1 minute) is used,
+	 * an older one lacks rows which have to be requested anyway
+	 * @returns whether the symbol is ready to be analyzed
+	 */
+	bool resume(SymbolId symbol);
 
 	/**
 	 * @brief Removes a cryptocurrency from the watchlist
@@ -59,7 +104,7 @@ public:
 	 * at the current exchange rate
 	 * @param symbol - cryptocurrency
 	 */
-	void remove(const std::string& symbol);
+	void remove(SymbolId symbol);
 
 	/**
 	 * @brief Adds USD to user's account 
@@ -69,11 +114,12 @@ public:
 
 	/**
 	 * @brief Converts all currently possessed cryptocurrencies to USD
-	 * @param map - keys: cryptocurrency symbols, values: pointers to cryptocurrencies
-	 * (with their value and amount embedded)
+	 * - the watched ones are sold at their current sell prices, the others at the latest
+	 * known ones (booked as sell transactions, the trading fee is deducted)
+	 * @param tokens - watched cryptocurrencies (with their current values)
 	 * @returns USD which the user obtains (if it were real) 
 	 */
-	double withdraw(const crypto_map& map);
+	double withdraw(const TokenTable& tokens);
 
 	/**
 	 * @returns an user's current USD asset.
@@ -81,32 +127,47 @@ public:
 	double get_balance() const;
 
 	/**
-	 * @brief Print current market exchange rate
-	 * of user's watchlist
+	 * @returns heap allocations of the indicators and the ledger (get_analysis) so far
+	 * - called once the ticks are stopped
+	 */
+	AllocationStats get_allocation_stats() const;
+
+	/**
+	 * @returns cryptocurrencies the user possesses (i.e. recovered from the journal)
+	 */
+	std::vector<std::string> get_held_symbols() const;
+
+	/**
+	 * @brief Fills the portfolio (assets, estimated withdrawal at the current
+	 * exchange rates of user's watchlist, recent transactions) and the indicators of a view
+	 * - called by the thread which runs the analysis, readers get the published view
+	 * - the view may be a former version (see VersionedSnapshot::acquire), all of its fields are overwritten
 	 */
-	void print_current(const crypto_map&) const;
+	void fill_view(MarketView& view, const TokenTable& tokens) const;
 
 	/**
-	 * @brief Prints last couple of accomplished transactions
+	 * @brief Prints last couple of accomplished transactions (of a published view)
 	 * -- full history is stored in a separate csv file
 	 */
-	void print_transactions() const;
+	void print_transactions(const MarketView& view) const;
 
 	/**
-	 * @brief Shows indicators of Relative Strength Index (RSI), Bollinger Bands (BB)
-	 * for a user's current watchlist
-	 * @see https://www.investopedia.com/terms/r/rsi.asp
-	 * @see https://www.investopedia.com/terms/b/bollingerbands.asp.
+	 * @brief Prints a page of the whole transaction history
+	 * and aggregates (volume, realized PnL) of the traded symbols
+	 * @param symbol - all symbols if none
+	 * @param from, to - time range (Unix time in ms, inclusive)
+	 * @param page - 1 is the newest one
 	 */
-	void print_indicators() const;
-	
+	void print_history(std::optional<SymbolId> symbol, int64_t from, int64_t to, size_t page) const;
+
 private: // methods
 	template<typename T, typename ...Args>
 	friend std::shared_ptr<T> create_shared(Args&& ...args);
 
-	Analyzer() : dataset(), assets(), transactions(),
+	Analyzer(const std::shared_ptr<SymbolTable>& in_symbol_table)
+		: dataset(), assets(), transactions(),
 		out_dir("transactions"), out_fname("results"),
-		extension(".csv"), us_dollar("USD") {
+		extension(".csv"), us_dollar("USD"), symbol_table(in_symbol_table) {
 		init();
 	}
 	Analyzer(Analyzer&&) = delete;
@@ -118,7 +179,7 @@ private: // methods
 	 * @param action - whether to buy or sell
 	 * @param price - current exchange rate of the cryptocurrency given 
 	 */
-	void print_signal(const std::string& symbol, const Action& action, double price) const;
+	void print_signal(SymbolId symbol, const Action& action, double price) const;
 
 	/**
 	 * @brief Prints current dataset
@@ -129,7 +190,14 @@ private: // methods
 	/**
 	 * @brief Prepares one row of the dataset.
 	 */
-	void prepare_single(const std::pair<std::string, std::deque<double>>&);
+	void prepare_single(const std::pair<SymbolId, const std::deque<double>&>&);
+
+	/**
+	 * @brief Adds dataset rows computed from consecutive closing prices
+	 * @param iteration - number of closing prices processed so far
+	 * (indicators need a full period of previous rows)
+	 */
+	void prepare_rows(SymbolId symbol, const std::deque<double>& close_prices, size_t iteration);
 
 	/**
 	 * @brief Sets typical actions - decisions to be
@@ -143,7 +211,7 @@ private: // methods
 	 * @param symbol - cryptocurrency which we want to buy
 	 * @param price - current exchange rate of the cryptocurrency given 
 	 */
-	void process_buy_signal(const std::string& symbol, double price);
+	void process_buy_signal(SymbolId symbol, double price);
 	
 	/**
 	 * @brief Takes currently possessed amount of cryptocurrency and converts it to USD
@@ -152,23 +220,117 @@ private: // methods
 	 * @param symbol - cryptocurrency which we want to sell
 	 * @param price - current exchange rate of the cryptocurrency given 
 	 */
-	void process_sell_signal(const std::string& symbol, double price);
+	void process_sell_signal(SymbolId symbol, double price);
+
+	/**
+	 * @brief Sells the whole holding of a symbol, the trading fee is deducted
+	 * (as by any sell signal)
+	 * @returns USD obtained
+	 */
+	double sell_holding(SymbolId symbol, double price);
+
+	/**
+	 * @returns price a holding would be sold at - the current sell price of a watched symbol,
+	 * otherwise the latest known one (nullopt if the symbol has never been priced)
+	 */
+	std::optional<double> get_liquidation_price(SymbolId symbol, const TokenTable& tokens) const;
 	
 	/**
 	 * @brief Adds a transaction 
-	 * record to a local storage (contains last couple of records).
+	 * record to a local storage (contains last couple of records)
+	 * and to the journal.
 	 * @param symbol - cryptocurrency
 	 * @param xrate - exchange rate
 	 * @param amount - amount of cryptocurrency we want to process a transaction of
+	 * @param usd - change of the USD balance
 	 * @param action - whether to buy or sell
 	 */
-	void create_transaction(const std::string& symbol, double xrate, double amount, Action action);
+	void create_transaction(SymbolId symbol, double xrate, double amount, double usd, Action action);
+
+	/**
+	 * @brief Keeps the transaction among the last couple of records.
+	 */
+	void remember_transaction(const std::shared_ptr<Transaction>& transaction);
+
+	/**
+	 * @brief Rebuilds assets and recent transactions from the journal.
+	 */
+	void recover();
+
+	/**
+	 * @brief Loads the history checkpoints which the snapshot reflects
+	 * (later ones are cut off) and opens the file for appending
+	 * @param to_offset - journal offset of the snapshot
+	 * @returns journal offset of the last loaded checkpoint (0 if none)
+	 */
+	uint64_t load_history(uint64_t to_offset);
+
+	/**
+	 * @brief Applies a replayed journal record.
+	 */
+	void apply_entry(const JournalEntry& entry);
+
+	/**
+	 * @brief Adds a journal record to the transaction history.
+	 */
+	void index_entry(const JournalEntry& entry);
+
+	/**
+	 * @brief Creates an empty asset record of a symbol
+	 * - recovered holdings are kept
+	 */
+	void init_asset(SymbolId symbol);
+
+	/**
+	 * @returns state to be written to a snapshot
+	 * - rows of the symbols unchanged since the previous capture are shared with it
+	 */
+	AnalyzerState capture_state();
+
+	/**
+	 * @brief Loads a snapshot - the indicator state of the symbols
+	 * is kept aside until they are resumed
+	 * @param with_ledger - whether assets and transactions are taken as well
+	 * (otherwise they are rebuilt from the journal)
+	 */
+	void apply_state(const AnalyzerState& state, bool with_ledger);
+
+	/**
+	 * @brief Hands a snapshot over to the writer once per snapshot interval.
+	 */
+	void take_snapshot_if_due();
+
+	/**
+	 * @brief Hands a snapshot over to the writer and checkpoints the history
+	 * at the same journal offset.
+	 */
+	void take_snapshot();
+
+	/**
+	 * @brief Signal of a symbol in the current tick
+	 * - evaluated by a shard, applied to the ledger by the coordinator
+	 */
+	struct SignalDecision {
+		SymbolId symbol;
+		TokenQuote quote; // the indicators see the value, trades take the buy or sell price
+		Action signal; // BUY if any indicator says so, otherwise SELL if any says so
+	};
+
+	struct ShardSlab;
 
 	/**
-	 * @brief 
-	 * @returns A new row which may be further added to the dataset 
+	 * @brief Computes the indicators of a symbol and counts its consecutive signals
+	 * - touches the state of the symbol only (safe to run on its shard)
+	 * @param slab - state of the shard which owns the symbol
+	 * @param shall_add - the new row is appended to the dataset
 	 */
-	std::deque<double> set_technical_indicators(const std::string&, double);
+	void evaluate_signal(ShardSlab& slab, SignalDecision& decision, bool shall_add);
+
+	/**
+	 * @brief Buys/sells once the signal streak is long enough
+	 * - changes the ledger, called by the coordinator in the order of the symbols
+	 */
+	void apply_signal(const SignalDecision& decision);
 
 	/**
 	* @brief Calculates Bollinger Bands
@@ -176,9 +338,13 @@ private: // methods
 	* @param price - current exchange rate of the cryptocurrency
 	* @param cells - row cells to be filled in order to form a dataset row
 	* @param period - window which we consider when calculating bollinger bands
+	* @param scratch - memory of the temporaries
 	* @see https://www.investopedia.com/terms/b/bollingerbands.asp
 	*/
-	Action set_bollinger_bands(const std::string& symbol, double price, std::deque<double>& cells, size_t period);
+	Action set_bollinger_bands(
+		SymbolId symbol, double price, std::deque<double>& cells, size_t period,
+		std::pmr::memory_resource* scratch = std::pmr::get_default_resource()
+	);
 
 	/**
 	* @brief Calculates Relative Strengh Index
@@ -186,18 +352,23 @@ private: // methods
 	* @param price - current exchange rate of the cryptocurrency
 	* @param cells - row cells to be filled in order to form a dataset row
 	* @param period - window which we consider when calculating RSI
+	* @param scratch - memory of the temporaries
 	* @see https://www.investopedia.com/terms/r/rsi.asp
 	*/
-	Action set_rsi(const std::string& symbol, double price, std::deque<double>& cells, size_t period);
+	Action set_rsi(
+		SymbolId symbol, double price, std::deque<double>& cells, size_t period,
+		std::pmr::memory_resource* scratch = std::pmr::get_default_resource()
+	);
 
 	/**
-	* @brief Prepares output transaction file where all transactions are accomplished
-	* - it needs to clean up a potential previous run first
+	* @brief Prepares output directory and the optional csv export
+	* - the history of previous runs is kept
 	*/
 	void prepare_output_file();
 
 	/**
-	 * @brief Adds a row to the csv file
+	 * @brief Hands a row of the csv export over to its writer
+	 * - the row is written in the background, the trading never waits for the disk
 	 * @param transaction - pointer to transactions which holds all the needed
 	 * info to be filled in the file
 	 */
@@ -208,6 +379,21 @@ private: // methods
 	 */
 	inline std::string get_filename() const;
 
+	/**
+	 * @brief Receive filename of the binary journal.
+	 */
+	inline std::string get_journal_filename() const;
+
+	/**
+	 * @brief Receive filename (prefix of the slots) of the state snapshots.
+	 */
+	inline std::string get_snapshot_filename() const;
+
+	/**
+	 * @brief Receive filename of the history checkpoints.
+	 */
+	inline std::string get_history_filename() const;
+
 	/**
 	 * @brief Writes the header of the output csv file
 	 */
@@ -231,21 +417,73 @@ private: // fields
 
 	/**
 	 * @brief latest transactions "window"
-	 * - whole transaction history is kept in the csv file
+	 * - whole transaction history is kept in the journal and the history store
 	 */
 	const size_t max_transactions = 20;
 
 	/**
-	 * @brief last record of each (user desired)
-	 * cryptocurrency symbol with indicator info
+	 * @brief transactions per page of the history.
+	 */
+	const size_t history_page_size = 20;
+
+	/**
+	 * @brief upper bound of a history checkpoint (the first one holds the whole history).
+	 */
+	static constexpr uint32_t history_max_payload = 1 << 28;
+
+	/**
+	 * @brief State of the symbols owned by a shard (symbol id modulo the shard count)
+	 * - written by its shard during a tick, by the calling thread between the ticks
+	 * - slabs are allocated one by one and start at a cache line,
+	 * two shards never write to the same line
+	 */
+	struct alignas(64) ShardSlab {
+		/**
+		 * @brief last record of each (user desired)
+		 * cryptocurrency symbol with indicator info
+		 */
+		SymbolMap<std::deque<double>> last_records;
+
+		/**
+		 * @brief consecutive signals of each cryptocurrency
+		 */
+		SymbolMap<size_t> signal_counters;
+
+		/**
+		 * @brief due symbols of the tick (in the order of the watchlist)
+		 * - the capacity is kept, a warmed up tick does not allocate
+		 */
+		std::vector<SignalDecision> decisions;
+		size_t merged = 0; // decisions already applied to the ledger
+
+		/**
+		 * @brief memory of the indicator temporaries
+		 * (reset after every symbol - its size does not depend on the watchlist)
+		 */
+		TickArena scratch;
+		uint64_t allocations = 0; // heap allocations of the latest tick
+	};
+
+	/**
+	 * @returns slab of the shard which owns the symbol
 	 */
-	std::map<std::string, std::deque<double>> last_records;
+	ShardSlab& get_slab(SymbolId symbol) { return *slabs[symbol % slabs.size()]; }
+	const ShardSlab& get_slab(SymbolId symbol) const { return *slabs[symbol % slabs.size()]; }
+
+	std::vector<std::unique_ptr<ShardSlab>> slabs;
 
 	/**
-	 * @brief A map consiting of consecutive signals for each
-	 * cryptocurrency in the user's watchlist.
+	 * @brief Workers evaluating the symbols of a tick (TTM_SHARDS), one slab per shard
 	 */
-	std::map<std::string, size_t> signal_counter_map;
+	std::unique_ptr<ShardPool> shards;
+
+	/**
+	 * @brief below this number of symbols per shard a tick is evaluated on the calling thread
+	 * (the hand-off would cost more than the indicators)
+	 */
+	const size_t min_symbols_per_shard = 64;
+
+	AllocationStats allocation_stats;
 
 	/**
 	 * @brief A hook to statistics class to use its formulae.
@@ -263,9 +501,10 @@ private: // fields
 	std::unordered_map<Action, std::string> action_mapper;
 
 	/**
-	 * @brief A map of currently possessed user assets.
+	 * @brief A map of currently possessed user assets
+	 * - US dollars are kept under their own symbol id.
 	 */
-	std::unordered_map<std::string, double> assets;
+	SymbolMap<double> assets;
 
 	/**
 	 * @brief A double ended queue consiting
@@ -273,20 +512,83 @@ private: // fields
 	 */
 	std::deque<std::shared_ptr<Transaction>> transactions;
 
+	/**
+	 * @brief Durable record of everything which changes the assets.
+	 */
+	std::unique_ptr<TradeJournal> trade_journal;
+
+	/**
+	 * @brief Whole transaction history indexed by symbol and time.
+	 */
+	TransactionStore trade_history;
+
+	/**
+	 * @brief Background writer of the history checkpoints (taken with the snapshots).
+	 */
+	std::unique_ptr<JournalWriter> history_checkpoints;
+
+	/**
+	 * @brief Background writer of the csv export (none if disabled).
+	 */
+	std::unique_ptr<JournalWriter> csv_export;
+
+	/**
+	 * @brief Indicator state of a symbol loaded from the snapshot.
+	 */
+	struct ResumableState {
+		matrix rows;
+		std::deque<double> last_record;
+		size_t signal_counter = 0;
+	};
+
+	/**
+	 * @brief Symbols of the snapshot which have not been resumed yet.
+	 */
+	SymbolMap<ResumableState> resumable;
+
+	/**
+	 * @brief Dataset rows as captured by the latest snapshot (shared with the writer)
+	 * - a symbol is dropped whenever its rows change, the next capture copies it again
+	 */
+	SymbolMap<std::shared_ptr<const matrix>> captured_rows;
+
+	/**
+	 * @brief Background writer of the state snapshots.
+	 */
+	std::unique_ptr<SnapshotWriter> snapshots;
+	ms snapshot_interval = ms(0);
+	time_var last_snapshot;
+
+	/**
+	 * @brief Unix time (ms) of the snapshot loaded upon the start.
+	 */
+	int64_t snapshot_time = 0;
+
 	std::string out_dir;
 	std::string out_fname;
 	std::string extension;
 	std::string us_dollar;
+
+	/**
+	 * @brief Names of the symbols (needed only for the output).
+	 */
+	std::shared_ptr<SymbolTable> symbol_table;
+	SymbolId us_dollar_id = 0;
 };
 
 #ifndef PRINT_FUNCTIONS
 
-void Analyzer::print_transactions() const {
+void Analyzer::print_transactions(const MarketView& view) const {
+	auto&& transactions = view.transactions;
 	if (transactions.empty()) {
 		print("No transactions have been accomplished yet\n");
 	}
 	else {
-		print("Transactions (full history in ", get_filename(), ")\n");
+		print("Transactions (full history in ", csv_export ? get_filename() : get_journal_filename(), ")\n");
+		size_t pending = trade_journal ? trade_journal->get_queue_depth() : 0;
+		if (pending > 0) {
+			print("- ", pending, " of them not written to the file yet\n");
+		}
 		int row_num = 1;
 		for (auto it = transactions.rbegin(); it != transactions.rend(); ++it) {
 			print(row_num, ": ", (*it)->get_datetime(),
@@ -300,9 +602,49 @@ void Analyzer::print_transactions() const {
 	}
 }
 
+void Analyzer::print_history(std::optional<SymbolId> symbol, int64_t from, int64_t to, size_t page) const {
+	TradePage result = trade_history.query(symbol, from, to, page, history_page_size);
+	if (result.total == 0) {
+		print("No transactions found\n");
+		return;
+	}
+	size_t pages = (result.total + history_page_size - 1) / history_page_size;
+	print(result.total, " transactions - page ", page, "/", pages, "\n");
+	if (result.rows.empty()) {
+		return;
+	}
+	size_t row_num = (page - 1) * history_page_size + 1;
+	for (uint32_t row : result.rows) {
+		TradeRow trade = trade_history.get_row(row);
+		bool is_buy = trade.side == TradeSide::Buy;
+		print(row_num, ": ", get_datetime(sys_clock::time_point(ms(trade.timestamp))),
+			" Name: ", symbol_table->get_name(trade.symbol),
+			" Exchange rate: ", trade.xrate,
+			" Amount: ", trade.amount,
+			" Action: ", action_mapper.at(is_buy ? Action::BUY : Action::SELL)
+		);
+		if (!is_buy) {
+			print(" PnL: ", trade.realized_pnl, " ", us_dollar);
+		}
+		print('\n');
+		++row_num;
+	}
+	print("Summary:\n");
+	std::vector<SymbolId> traded = symbol ? std::vector<SymbolId>{ *symbol } : trade_history.get_symbols();
+	for (SymbolId id : traded) {
+		TradeAggregate total = trade_history.aggregate(id, from, to);
+		if (total.buys + total.sells > 0) {
+			print("[", symbol_table->get_name(id), "] Buys: ", total.buys, " Sells: ", total.sells,
+				" Volume: ", total.volume, " ", us_dollar,
+				" Realized PnL: ", total.realized_pnl, " ", us_dollar, "\n"
+			);
+		}
+	}
+}
+
 void Analyzer::print_dataset() const {
 	for (auto&& [key, matrix] : dataset) {
-		print(key, "\n");
+		print(symbol_table->get_name(key), "\n");
 		for (auto&& deque : matrix) {
 			for (double d : deque) {
 				print(d, " ");
@@ -313,38 +655,48 @@ void Analyzer::print_dataset() const {
 	}
 }
 
-void Analyzer::print_current(const crypto_map& input) const {
+void Analyzer::fill_view(MarketView& view, const TokenTable& tokens) const {
+	// the view may be a former version - every field is overwritten
+	view.assets.resize(assets.size());
+	size_t index = 0;
 	for (auto&& [key, value] : assets) {
-		print("[", key, " : ", value, "]\n");
+		view.assets[index].first = symbol_table->get_name(key);
+		view.assets[index].second = value;
+		++index;
 	}
-	double withdraw_v = assets.at(us_dollar);
-	for (auto&& [name, amount] : assets) {
-		if (name != us_dollar) {
-			double current_v = input.at(name)->get_value();
-			double in_usd = current_v * amount;
-			withdraw_v += in_usd;
+	double withdraw_v = assets.at(us_dollar_id);
+	for (auto&& [symbol, amount] : assets) {
+		if (symbol == us_dollar_id || amount <= 0) {
+			continue;
+		}
+		// the holdings would be sold
+		if (auto&& price = get_liquidation_price(symbol, tokens)) {
+			double in_usd = *price * amount;
+			withdraw_v += in_usd - in_usd * trading_fee;
 		}
 	}
-	print("Estimated withdrawal: ", withdraw_v, " ", us_dollar, "\n");
-}
-
-inline static void print_indicators_header() {
-	auto&& time = get_current_datetime();
-	print("Indicators at ", time, "\n");
-	print("RSI = Relative Strength Index \n");
-	print("BB = Bollinger Bands\n\n");
-}
-
-void Analyzer::print_indicators() const {
-	print_indicators_header();
-	for (auto&& [symbol, value] : last_records) {
-		print("[ --- ", symbol, " --- ]\n");
-		print("- RSI: ", value[0], " % \n");
-		print("- BB: Lowerband: ", value[1], " ", us_dollar,
-			", Upperband: ", value[2], " ", us_dollar, "\n"
-		);
-		print("- Current value: ", value[value.size() - 1], " ", us_dollar, "\n\n");
+	view.estimated_withdrawal = withdraw_v;
+	// transactions are immutable, the view shares them
+	view.transactions.assign(transactions.begin(), transactions.end());
+	// RSI, lower band, upper band, ..., current value
+	size_t indicator_count = 0;
+	for (auto&& slab : slabs) {
+		indicator_count += slab->last_records.size();
+	}
+	view.indicators.resize(indicator_count);
+	index = 0;
+	for (auto&& slab : slabs) {
+		for (auto&& [symbol, value] : slab->last_records) {
+			auto&& indicator = view.indicators[index++];
+			indicator.symbol = symbol_table->get_name(symbol);
+			indicator.rsi = value[0];
+			indicator.lower_band = value[1];
+			indicator.upper_band = value[2];
+			indicator.price = value.back();
+		}
 	}
+	std::sort(view.indicators.begin(), view.indicators.end(),
+		[](const IndicatorView& lhs, const IndicatorView& rhs) { return lhs.symbol < rhs.symbol; });
 }
 
 inline static void print_RSI_data(double rsi, double avg_up, double avg_down) {
@@ -368,8 +720,8 @@ inline static void print_row(int iteration, const std::deque<double>& cells) {
 	print("\n");
 }
 
-void Analyzer::print_signal(const std::string& symbol, const Action& action, double xrate) const {
-	print("\n[", action_mapper.at(action), " SIGNAL]: ", symbol, "\n");
+void Analyzer::print_signal(SymbolId symbol, const Action& action, double xrate) const {
+	print("\n[", action_mapper.at(action), " SIGNAL]: ", symbol_table->get_name(symbol), "\n");
 	print(" - at exchange rate : ", xrate, "\n\n");
 }
 
@@ -381,6 +733,10 @@ inline static void print_cant_sell(const std::string& symbol, double price) {
 	print("\n[SELL SIGNAL]: ", symbol, " at ", price, " USD  - could not sell, I dont have any\n\n");
 }
 
+inline static void print_written_off(const std::string& symbol, double amount) {
+	print(amount, " ", symbol, " could not be sold (no price is known) - written off\n");
+}
+
 inline static void print_debug_trigger_signal(const std::string& action, size_t streak) {
 	print("Trigger: ", action, ": ", streak, "x\n");
 }
@@ -390,9 +746,194 @@ inline static void print_debug_trigger_signal(const std::string& action, size_t
 #ifndef INITIALIZATION
 
 void Analyzer::init() {
-	assets[us_dollar] = 0;
+	us_dollar_id = symbol_table->intern(us_dollar);
+	assets[us_dollar_id] = 0;
 	set_actions();
+	shards = std::make_unique<ShardPool>(get_shard_count());
+	for (size_t shard = 0; shard < shards->get_shard_count(); ++shard) {
+		slabs.push_back(std::make_unique<ShardSlab>());
+	}
 	prepare_output_file();
+	recover();
+}
+
+Analyzer::~Analyzer() {
+	// the next run starts where this one ended
+	if (snapshots && snapshot_interval.count() > 0) {
+		take_snapshot();
+		snapshots->stop();
+	}
+}
+
+void Analyzer::recover() {
+	trade_journal = std::make_unique<TradeJournal>(get_journal_filename(), get_journal_config());
+	snapshots = std::make_unique<SnapshotWriter>(get_snapshot_filename());
+	snapshot_interval = get_snapshot_interval();
+	last_snapshot = high_clock::now();
+	uint64_t from_offset = 0;
+	auto&& state = snapshots->load_latest();
+	if (state) {
+		std::error_code error;
+		uint64_t journal_size = fs::file_size(get_journal_filename(), error);
+		// trades which did not reach the journal before a crash are not trusted
+		bool with_ledger = !error && state->journal_offset <= journal_size;
+		if (!with_ledger) {
+			print("The snapshot is ahead of the journal - assets are rebuilt from the journal\n");
+		}
+		apply_state(*state, with_ledger);
+		from_offset = with_ledger ? state->journal_offset : 0;
+	}
+	// the history comes from its checkpoints, only the records after the last one are indexed
+	uint64_t indexed_offset = load_history(from_offset);
+	trade_journal->scan(indexed_offset, from_offset, [this](const JournalEntry& entry) { index_entry(entry); });
+	size_t replayed = trade_journal->recover(from_offset, [this](const JournalEntry& entry) {
+		apply_entry(entry);
+		index_entry(entry);
+	});
+	if (state) {
+		print("Resumed from the snapshot of ", get_datetime(sys_clock::time_point(ms(state->timestamp))),
+			" - ", replayed, " later journal records replayed, balance: ",
+			assets.at(us_dollar_id), " ", us_dollar, "\n");
+	}
+	else if (replayed > 0) {
+		print("Recovered ", replayed, " journal records - balance: ",
+			assets.at(us_dollar_id), " ", us_dollar, "\n");
+	}
+}
+
+uint64_t Analyzer::load_history(uint64_t to_offset) {
+	std::string path = get_history_filename();
+	uint64_t indexed_offset = 0;
+	uint64_t valid_end = read_records(path, history_max_payload, [&](const std::string& payload, uint64_t) {
+		uint64_t journal_offset = TransactionStore::get_checkpoint_offset(payload);
+		// a checkpoint ahead of the snapshot is rebuilt from the journal
+		if (journal_offset > to_offset || !trade_history.load_checkpoint(payload, *symbol_table)) {
+			return false;
+		}
+		indexed_offset = journal_offset;
+		return true;
+	});
+	drop_torn_tail(path, valid_end);
+	JournalConfig config;
+	// the checkpoints can always be rebuilt from the journal
+	config.policy = FsyncPolicy::None;
+	history_checkpoints = std::make_unique<JournalWriter>(path, config);
+	return indexed_offset;
+}
+
+void Analyzer::apply_state(const AnalyzerState& state, bool with_ledger) {
+	snapshot_time = state.timestamp;
+	for (auto&& [name, rows] : state.dataset) {
+		resumable[symbol_table->intern(name)].rows = *rows;
+	}
+	for (auto&& [name, record] : state.last_records) {
+		resumable[symbol_table->intern(name)].last_record = record;
+	}
+	for (auto&& [name, counter] : state.signal_counters) {
+		resumable[symbol_table->intern(name)].signal_counter = (size_t)counter;
+	}
+	if (!with_ledger) {
+		return;
+	}
+	for (auto&& [name, amount] : state.assets) {
+		assets[symbol_table->intern(name)] = amount;
+	}
+	for (auto&& transaction : state.transactions) {
+		remember_transaction(create_shared<Transaction>(
+			transaction.amount, transaction.xrate, transaction.action,
+			transaction.symbol, transaction.datetime
+		));
+	}
+}
+
+AnalyzerState Analyzer::capture_state() {
+	AnalyzerState state;
+	state.timestamp = get_unix_time_ms();
+	state.journal_offset = trade_journal->get_end_offset();
+	for (auto&& [symbol, amount] : assets) {
+		state.assets.emplace_back(symbol_table->get_name(symbol), amount);
+	}
+	for (auto&& slab : slabs) {
+		for (auto&& [symbol, counter] : slab->signal_counters) {
+			state.signal_counters.emplace_back(symbol_table->get_name(symbol), counter);
+		}
+		for (auto&& [symbol, record] : slab->last_records) {
+			state.last_records.emplace_back(symbol_table->get_name(symbol), record);
+		}
+	}
+	for (auto&& [symbol, rows] : dataset) {
+		auto&& captured = captured_rows[symbol];
+		if (!captured) {
+			captured = std::make_shared<const matrix>(rows);
+		}
+		state.dataset.emplace_back(symbol_table->get_name(symbol), captured);
+	}
+	for (auto&& transaction : transactions) {
+		state.transactions.push_back({ transaction->get_name(), transaction->get_action(),
+			transaction->get_amount(), transaction->get_xrate(), transaction->get_datetime() });
+	}
+	return state;
+}
+
+void Analyzer::take_snapshot_if_due() {
+	if (!snapshots || snapshot_interval.count() <= 0
+		|| high_clock::now() - last_snapshot < snapshot_interval) {
+		return;
+	}
+	last_snapshot = high_clock::now();
+	take_snapshot();
+}
+
+void Analyzer::take_snapshot() {
+	AnalyzerState state = capture_state();
+	std::string checkpoint = trade_history.take_checkpoint(state.journal_offset, *symbol_table);
+	if (!checkpoint.empty()) {
+		history_checkpoints->append(frame_record(checkpoint));
+	}
+	snapshots->submit(std::move(state));
+}
+
+void Analyzer::apply_entry(const JournalEntry& entry) {
+	switch (entry.type) {
+	case JournalEntryType::Deposit:
+		assets[us_dollar_id] += entry.usd;
+		break;
+	case JournalEntryType::Buy:
+	case JournalEntryType::Sell: {
+		SymbolId symbol = symbol_table->intern(entry.symbol);
+		bool is_buy = entry.type == JournalEntryType::Buy;
+		assets[us_dollar_id] += entry.usd;
+		double& held = assets[symbol];
+		held = is_buy ? held + entry.amount : std::max(0.0, held - entry.amount);
+		remember_transaction(create_shared<Transaction>(
+			entry.amount, entry.xrate, action_mapper.at(is_buy ? Action::BUY : Action::SELL),
+			entry.symbol, get_datetime(sys_clock::time_point(ms(entry.timestamp)))
+		));
+		break;
+	}
+	case JournalEntryType::Withdraw:
+		// everything has been converted to USD and paid out
+		assets.clear();
+		assets[us_dollar_id] = 0;
+		break;
+	}
+}
+
+void Analyzer::index_entry(const JournalEntry& entry) {
+	switch (entry.type) {
+	case JournalEntryType::Buy:
+	case JournalEntryType::Sell:
+		trade_history.append(entry.timestamp, symbol_table->intern(entry.symbol),
+			entry.type == JournalEntryType::Buy ? TradeSide::Buy : TradeSide::Sell,
+			entry.amount, entry.xrate, entry.usd
+		);
+		break;
+	case JournalEntryType::Withdraw:
+		trade_history.close_positions();
+		break;
+	default:
+		break;
+	}
 }
 
 void Analyzer::set_actions() {
@@ -405,15 +946,57 @@ void Analyzer::set_actions() {
 
 #ifndef ANALYSIS_ENTRYPOINT
 
-void Analyzer::get_analysis(crypto_map& data, bool shall_add) {
-	for (auto&& [symbol, crypto_token] : data) {
-		double cr_value = crypto_token->get_value();
-		auto&& new_row = set_technical_indicators(symbol, cr_value);
+void Analyzer::get_analysis(const TokenTable& tokens, const std::vector<SymbolId>& due, bool shall_add) {
+	uint64_t allocations = thread_heap_allocations;
+	// the due symbols are partitioned once, a shard walks its own decisions only
+	for (auto&& slab : slabs) {
+		slab->decisions.clear();
+		slab->merged = 0;
+	}
+	for (SymbolId symbol : due) {
+		ShardSlab& slab = get_slab(symbol);
+		slab.decisions.push_back({ symbol, tokens.get_quote(symbol), Action::HOLD });
+		// slots are created up front - the shards only change their contents
+		slab.signal_counters[symbol];
+		slab.last_records[symbol];
+	}
+	bool is_parallel = due.size() >= slabs.size() * min_symbols_per_shard && slabs.size() > 1;
+	auto&& evaluate_slab = [this, shall_add](ShardSlab& slab) {
+		uint64_t slab_start = thread_heap_allocations;
+		for (auto&& decision : slab.decisions) {
+			evaluate_signal(slab, decision, shall_add);
+			slab.scratch.reset();
+		}
+		slab.allocations = thread_heap_allocations - slab_start;
+	};
+	if (is_parallel) {
+		auto&& evaluate_shard = [this, &evaluate_slab](size_t shard) {
+			evaluate_slab(*slabs[shard]);
+		};
+		// by reference - the job does not fit into std::function without an allocation
+		shards->run(std::ref(evaluate_shard));
+	}
+	else {
+		for (auto&& slab : slabs) {
+			evaluate_slab(*slab);
+		}
+	}
+	// the ledger has a single writer - decisions are merged in the order of the symbols
+	for (SymbolId symbol : due) {
+		ShardSlab& slab = get_slab(symbol);
+		apply_signal(slab.decisions[slab.merged++]);
 		if (shall_add) {
-			dataset.at(symbol).pop_front();
-			dataset.at(symbol).push_back(new_row);
+			captured_rows.erase(symbol);
 		}
 	}
+	take_snapshot_if_due();
+	// shard 0 runs on this thread
+	uint64_t shard_allocations = 0;
+	for (size_t shard = 1; is_parallel && shard < slabs.size(); ++shard) {
+		shard_allocations += slabs[shard]->allocations;
+	}
+	allocation_stats.add_tick(thread_heap_allocations - allocations + shard_allocations);
+	allocation_stats.last_tick_shards = shard_allocations;
 }
 
 #endif // !ANALYSIS_ENTRYPOINT
@@ -421,21 +1004,67 @@ void Analyzer::get_analysis(crypto_map& data, bool shall_add) {
 #ifndef ASSETS_HANDLING
 
 double Analyzer::get_balance() const {
-	return assets.at(us_dollar);
+	return assets.at(us_dollar_id);
+}
+
+AllocationStats Analyzer::get_allocation_stats() const {
+	AllocationStats stats = allocation_stats;
+	for (auto&& slab : slabs) {
+		stats.arena_bytes += slab->scratch.get_capacity();
+	}
+	return stats;
+}
+
+std::vector<std::string> Analyzer::get_held_symbols() const {
+	std::vector<std::string> held;
+	for (auto&& [symbol, amount] : assets) {
+		if (symbol != us_dollar_id && amount > 0) {
+			held.push_back(symbol_table->get_name(symbol));
+		}
+	}
+	return held;
 }
 
 void Analyzer::deposit(double value) {
-	assets[us_dollar] += value;
+	assets[us_dollar_id] += value;
+	JournalEntry entry;
+	entry.type = JournalEntryType::Deposit;
+	entry.timestamp = get_unix_time_ms();
+	entry.usd = value;
+	trade_journal->append(entry);
 }
 
-double Analyzer::withdraw(const crypto_map& input) {
-	double withdraw_v = assets[us_dollar];
-	assets.erase(us_dollar);
-	for (auto&& [name, amount] : assets) {
-		double current_v = input.at(name)->get_value();
-		double in_usd = current_v * amount;
-		withdraw_v += in_usd;
+double Analyzer::withdraw(const TokenTable& tokens) {
+	std::vector<std::pair<SymbolId, double>> liquidated;
+	for (auto&& [symbol, amount] : assets) {
+		if (symbol == us_dollar_id || amount <= 0) {
+			continue;
+		}
+		if (auto&& price = get_liquidation_price(symbol, tokens)) {
+			liquidated.emplace_back(symbol, *price);
+		}
+		else {
+			print_written_off(symbol_table->get_name(symbol), amount);
+		}
+	}
+	// the liquidation is a sell - the history books its profit or loss
+	for (auto&& [symbol, price] : liquidated) {
+		sell_holding(symbol, price);
 	}
+	double withdraw_v = assets[us_dollar_id];
+	// everything has been converted to USD and paid out (as the journal replay does),
+	// the final snapshot must not bring the holdings back
+	// - the watched symbols keep their (empty) slots
+	for (auto&& [symbol, amount] : assets) {
+		amount = 0;
+	}
+	assets[us_dollar_id] = 0;
+	JournalEntry entry;
+	entry.type = JournalEntryType::Withdraw;
+	entry.timestamp = get_unix_time_ms();
+	entry.usd = withdraw_v;
+	trade_journal->append(entry);
+	index_entry(entry);
 	return withdraw_v;
 }
 #endif // !ASSETS_HANDLING
@@ -443,12 +1072,13 @@ double Analyzer::withdraw(const crypto_map& input) {
 #ifndef TECHNICAL_INDICATORS
 
 Action Analyzer::set_bollinger_bands(
-	const std::string& key, double value,
-	std::deque<double>& cells, size_t period
+	SymbolId key, double value,
+	std::deque<double>& cells, size_t period,
+	std::pmr::memory_resource* scratch
 ) {
-	matrix mat;
-	std::vector<double> close_values;
-	mat = dataset.at(key);
+	const matrix& mat = dataset.at(key);
+	std::pmr::vector<double> close_values(scratch);
+	close_values.reserve(period + 1);
 	for (auto it = mat.end() - period; it != mat.end(); ++it) {
 		auto&& row = *it;
 		close_values.push_back(row[row.size() - 1]);
@@ -477,17 +1107,19 @@ Action Analyzer::set_bollinger_bands(
 }
 
 Action Analyzer::set_rsi(
-	const std::string& symbol, double price,
-	std::deque<double>& cells, size_t period
+	SymbolId symbol, double price,
+	std::deque<double>& cells, size_t period,
+	std::pmr::memory_resource* scratch
 ) {
 	int perc = 100;
 	int sell_signal_perc = 70;
 	int buy_signal_perc = 30;
 
-	std::deque<double> values;
-	std::deque<double> differences;
-	matrix mat;
-	mat = dataset.at(symbol);
+	std::pmr::vector<double> values(scratch);
+	std::pmr::vector<double> differences(scratch);
+	values.reserve(period + 1);
+	differences.reserve(period);
+	const matrix& mat = dataset.at(symbol);
 	for (auto it = mat.end() - period; it != mat.end(); ++it) {
 		auto&& row = *it;
 		values.push_back(row[row.size() - 1]);
@@ -526,54 +1158,93 @@ Action Analyzer::set_rsi(
 }
 
 void Analyzer::create_transaction(
-	const std::string& symbol,  double exchange_rate,
-	double crypto_amount, Action signal
+	SymbolId symbol,  double exchange_rate,
+	double crypto_amount, double usd, Action signal
 ) {
+	const std::string& name = symbol_table->get_name(symbol);
+	JournalEntry entry;
+	entry.type = signal == Action::BUY ? JournalEntryType::Buy : JournalEntryType::Sell;
+	entry.timestamp = get_unix_time_ms();
+	entry.symbol = name;
+	entry.amount = crypto_amount;
+	entry.xrate = exchange_rate;
+	entry.usd = usd;
+	trade_journal->append(entry);
+	index_entry(entry);
+
 	std::shared_ptr<Transaction> transaction = create_shared<Transaction>(
-		crypto_amount, exchange_rate, action_mapper.at(signal), symbol
+		crypto_amount, exchange_rate, action_mapper.at(signal), name
 	);
+	remember_transaction(transaction);
+	append_to_file(transaction);
+}
+
+void Analyzer::remember_transaction(const std::shared_ptr<Transaction>& transaction) {
 	if (transactions.size() >= max_transactions) {
 		transactions.pop_front();
 	}
 	transactions.push_back(transaction);
-	append_to_file(transaction);
 }
 
-void Analyzer::process_sell_signal(const std::string& symbol, double price) {
+void Analyzer::process_sell_signal(SymbolId symbol, double price) {
 	print_signal(symbol, Action::SELL, price);
+	sell_holding(symbol, price);
+	get_slab(symbol).signal_counters[symbol] = 0;
+}
+
+double Analyzer::sell_holding(SymbolId symbol, double price) {
 	double crypto_amount = assets.at(symbol);
 	double value_in_dollars = crypto_amount * price;
 	double value_with_trading_fee = value_in_dollars - value_in_dollars * trading_fee;
-	create_transaction(symbol, price, crypto_amount, Action::SELL);
+	create_transaction(symbol, price, crypto_amount, value_with_trading_fee, Action::SELL);
 	assets[symbol] = 0;
-	assets[us_dollar] += value_with_trading_fee;
-	signal_counter_map[symbol] = 0;
+	assets[us_dollar_id] += value_with_trading_fee;
+	return value_with_trading_fee;
+}
+
+std::optional<double> Analyzer::get_liquidation_price(SymbolId symbol, const TokenTable& tokens) const {
+	size_t position = tokens.find(symbol);
+	if (position != TokenTable::npos) {
+		return tokens.get_sell_values()[position];
+	}
+	// no longer watched - the latest evaluated value or the latest close of its dataset
+	if (auto&& record = get_slab(symbol).last_records.find(symbol); record != nullptr && !record->empty()) {
+		return record->back();
+	}
+	if (auto&& rows = dataset.find(symbol); rows != nullptr && !rows->empty() && !rows->back().empty()) {
+		return rows->back().back();
+	}
+	return std::nullopt;
 }
 
-void Analyzer::process_buy_signal(const std::string& symbol, double price) {
+void Analyzer::process_buy_signal(SymbolId symbol, double price) {
 	print_signal(symbol, Action::BUY, price);
-	double invested_value = assets.at(us_dollar)  / investment_split;
+	double invested_value = assets.at(us_dollar_id)  / investment_split;
 	double value_with_trading_fee = invested_value - invested_value * trading_fee;
 	double crypto_amount = value_with_trading_fee / price;
-	assets[us_dollar] -= invested_value;
-	create_transaction(symbol, price, crypto_amount, Action::BUY);
+	assets[us_dollar_id] -= invested_value;
+	create_transaction(symbol, price, crypto_amount, -invested_value, Action::BUY);
 	assets[symbol] += crypto_amount;
-	signal_counter_map[symbol] = 0;
+	get_slab(symbol).signal_counters[symbol] = 0;
 }
 
-std::deque<double> Analyzer::set_technical_indicators(
-	const std::string& symbol, double price
-) {
-	std::deque<double> row_cells{};
+void Analyzer::evaluate_signal(ShardSlab& slab, SignalDecision& decision, bool shall_add) {
+	SymbolId symbol = decision.symbol;
+	double price = decision.quote.value;
+	std::pmr::memory_resource* scratch = slab.scratch.get_resource();
+	// the row is built in place of the previous one (the memory is reused)
+	auto&& row_cells = slab.last_records.at(symbol);
+	auto&& signal_counter = slab.signal_counters.at(symbol);
+	row_cells.clear();
 
 	size_t rsi_period = 13;
 	size_t bb_period = 20;
-	Action rsi_signal = set_rsi(symbol, price, row_cells, rsi_period);
-	Action bb_signal = set_bollinger_bands(symbol, price, row_cells, bb_period);
+	Action rsi_signal = set_rsi(symbol, price, row_cells, rsi_period, scratch);
+	Action bb_signal = set_bollinger_bands(symbol, price, row_cells, bb_period, scratch);
 
 #ifdef DEBUG
-	print_suggestion("RSI", action_mapper[rsi_signal]);
-	print_suggestion("BB", action_mapper[bb_signal]);
+	print_suggestion("RSI", action_mapper.at(rsi_signal));
+	print_suggestion("BB", action_mapper.at(bb_signal));
 #endif // !DEBUG
 
 	// NOTE: Conditions that at least one technical indicator triggers a signal
@@ -584,66 +1255,87 @@ std::deque<double> Analyzer::set_technical_indicators(
 	// need to trigger a signal in order to count it as a proper signal 
 	// to do something about a particular cryptocurrency
 	if (bb_signal == Action::BUY || rsi_signal == Action::BUY) {
-		++signal_counter_map[symbol];
-		auto&& dollars = assets[us_dollar];
+		decision.signal = Action::BUY;
+		++signal_counter;
+	}
+	else if (bb_signal == Action::SELL || rsi_signal == Action::SELL) {
+		decision.signal = Action::SELL;
+		++signal_counter;
+	}
+	else {
+		signal_counter = 0;
+	}
+	row_cells.push_back(price);
+	if (shall_add) {
+		// the oldest row is overwritten and moved to the end (rows are swapped, not allocated)
+		auto&& rows = dataset.at(symbol);
+		rows.front().assign(row_cells.begin(), row_cells.end());
+		std::rotate(rows.begin(), rows.begin() + 1, rows.end());
+	}
+}
+
+void Analyzer::apply_signal(const SignalDecision& decision) {
+	SymbolId symbol = decision.symbol;
+	size_t streak = get_slab(symbol).signal_counters.at(symbol);
+	if (decision.signal == Action::BUY) {
+		double price = decision.quote.buy;
+		auto&& dollars = assets[us_dollar_id];
 		if (dollars / investment_split > 1
-			&& signal_counter_map.at(symbol) >= signal_threshold) {
+			&& streak >= signal_threshold) {
 			process_buy_signal(symbol, price);
 		}
 		else if (dollars / investment_split <= 1
-			&& signal_counter_map.at(symbol) >= signal_threshold) {
-			print_insufficient_funds(symbol, price);
+			&& streak >= signal_threshold) {
+			print_insufficient_funds(symbol_table->get_name(symbol), price);
 		}
 		else {
 #ifdef DEBUG
 			// Useful to get prepared for the signal streak, 
 			// nevertheless, it is not desirable in the released application
-			print_debug_trigger_signal(action_mapper.at(Action::SELL), signal_counter_map.at(symbol));
+			print_debug_trigger_signal(action_mapper.at(Action::SELL), streak);
 #endif // !DEBUG
 		}
 	}
-	else if (bb_signal == Action::SELL || rsi_signal == Action::SELL) {
-		++signal_counter_map[symbol];
+	else if (decision.signal == Action::SELL) {
+		double price = decision.quote.sell;
 		auto&& crypto_amount = assets.at(symbol);
 		if (crypto_amount > 0
-			&& signal_counter_map.at(symbol) >= signal_threshold) {
+			&& streak >= signal_threshold) {
 			process_sell_signal(symbol, price);
 		}
-		else if (crypto_amount ==  0 && signal_counter_map.at(symbol) >= signal_threshold) {
-			print_cant_sell(symbol, price);
+		else if (crypto_amount ==  0 && streak >= signal_threshold) {
+			print_cant_sell(symbol_table->get_name(symbol), price);
 		}
 		else { 
 #ifdef DEBUG
-			print_debug_trigger_signal(action_mapper.at(Action::SELL), signal_counter_map.at(symbol));
+			print_debug_trigger_signal(action_mapper.at(Action::SELL), streak);
 #endif // !DEBUG
 		}
 	}
-	else {
-		signal_counter_map[symbol] = 0;
-	}
-	row_cells.push_back(price);
-	last_records[symbol] = row_cells;
-	return row_cells;
 }
 #endif // !TECHNICAL_INDICATORS
 
 #ifndef OUTPUT_FILE_HANDLING
 
-void delete_dir_content(const std::string& out_dir) {
-	fs::path dir_path = out_dir;
-	for (auto& path : fs::directory_iterator(dir_path)) {
-		fs::remove_all(path);
-	}
+/**
+ * @brief The csv export is on unless TTM_CSV_EXPORT=off
+ * - the binary journal is the durable record in any case
+ */
+inline static bool is_csv_export_enabled() {
+	const char* configured = std::getenv("TTM_CSV_EXPORT");
+	return configured == nullptr || std::string(configured) != "off";
 }
 
 void Analyzer::prepare_output_file() {
 	if (!fs::exists(out_dir)) {
 		fs::create_directory(out_dir);
 	}
-	else {
-		delete_dir_content(out_dir);
+	if (is_csv_export_enabled()) {
+		if (!fs::exists(get_filename())) {
+			write_header();
+		}
+		csv_export = std::make_unique<JournalWriter>(get_filename(), get_journal_config());
 	}
-	write_header();
 }
 
 void Analyzer::write_header() const {
@@ -678,6 +1370,18 @@ std::string get_csv_row(const std::shared_ptr<Transaction>& value) {
 #endif
 }
 
+inline std::string Analyzer::get_journal_filename() const {
+	return (fs::path(out_dir) / "journal.bin").string();
+}
+
+inline std::string Analyzer::get_snapshot_filename() const {
+	return (fs::path(out_dir) / "snapshot").string();
+}
+
+inline std::string Analyzer::get_history_filename() const {
+	return (fs::path(out_dir) / "history.idx").string();
+}
+
 inline std::string Analyzer::get_filename() const {
 #ifdef __cpp_lib_format
 	return std::format("{}/{}{}", out_dir, out_fname, extension);
@@ -691,12 +1395,11 @@ inline std::string Analyzer::get_filename() const {
 void Analyzer::append_to_file(
 	const std::shared_ptr<Transaction>& transaction
 ) {
+	if (!csv_export) {
+		return;
+	}
 	try {
-		std::ofstream file;
-		const std::string& filename = get_filename();
-		file.open(filename, std::ios::app);
-		file << get_csv_row(transaction);
-		file.close();
+		csv_export->append(get_csv_row(transaction));
 	}
 	catch(std::exception& exc) {
 		print(exc.what(), "\n");
@@ -710,50 +1413,101 @@ void Analyzer::append_to_file(
 
 void Analyzer::prepare_values_from_file(const std::vector<std::string>& symbols) {
 	char csv_delimiter = ',';
-	for (auto&& symbol : symbols) {
-		std::ifstream reader;
-		try {
-			reader.open(symbol + extension);
-		}
-		catch (std::exception& exc) {
-			print(exc.what());
-			continue;
+	// files are mapped and parsed in parallel by a worker per core at most
+	// (each takes the next file of the list), the dataset is filled in afterwards (in the order given)
+	std::vector<std::optional<matrix>> loaded(symbols.size());
+	std::vector<std::exception_ptr> errors(symbols.size());
+	std::atomic<size_t> next_file(0);
+	auto&& load_files = [&]() {
+		for (size_t i = next_file++; i < symbols.size(); i = next_file++) {
+			try {
+				loaded[i] = load_csv_rows(symbols[i] + extension, csv_delimiter);
+			}
+			catch (...) {
+				errors[i] = std::current_exception();
+			}
 		}
-		std::string line;
-		// skip the header
-		std::getline(reader, line);
-		std::deque<double> row;
-
-		while (true) {
-			std::getline(reader, line);
-			if (line.empty()) {
-				break;
+	};
+	size_t worker_count = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1U), symbols.size());
+	std::vector<std::thread> workers;
+	for (size_t worker = 1; worker < worker_count; ++worker) {
+		workers.emplace_back(load_files);
+	}
+	// the calling thread is one of the workers
+	load_files();
+	for (auto&& worker : workers) {
+		worker.join();
+	}
+	for (size_t i = 0; i < symbols.size(); ++i) {
+		SymbolId symbol = symbol_table->intern(symbols[i]);
+		try {
+			if (errors[i]) {
+				std::rethrow_exception(errors[i]);
+			}
+			auto&& rows = loaded[i];
+			if (rows) {
+				auto&& symbol_rows = dataset[symbol];
+				symbol_rows.insert(symbol_rows.end(),
+					std::make_move_iterator(rows->begin()), std::make_move_iterator(rows->end()));
+				captured_rows.erase(symbol);
 			}
 			else {
-				std::string part;
-				std::stringstream ss(line);
-				while (ss.good()) {
-					std::getline(ss, part, csv_delimiter);
-					if (part.empty()) { // first few records have incomplete records
-						break;
-					}
-					double val = convert_string_to<double>(part);
-					row.push_back(val);
-				}
-				dataset[symbol].push_back(std::move(row));
-				row = {};
+				print("Can't open ", symbols[i] + extension, "\n");
 			}
 		}
+		catch (std::exception& exc) {
+			print(exc.what(), "\n");
+		}
 		// initialize issued pairs
-		assets[symbol] = 0;
+		init_asset(symbol);
 	}
 }
 
-void Analyzer::prepare_single(const std::pair<std::string, std::deque<double>>& row) {
+void Analyzer::prepare_single(const std::pair<SymbolId, const std::deque<double>&>& row) {
 	auto&& [symbol, prev_close_prices] = get_structured_bindings(row);
+	prepare_rows(symbol, prev_close_prices, 0);
+}
+
+void Analyzer::extend(SymbolId symbol, const std::deque<double>& close_prices) {
+	prepare_rows(symbol, close_prices, dataset[symbol].size());
+}
+
+void Analyzer::restore(SymbolId symbol, const matrix& rows) {
+	dataset[symbol] = rows;
+	captured_rows.erase(symbol);
+	init_asset(symbol);
+	get_slab(symbol).signal_counters[symbol] = 0;
+}
+
+matrix Analyzer::get_rows(SymbolId symbol) const {
+	const matrix* rows = dataset.find(symbol);
+	return rows != nullptr ? *rows : matrix{};
+}
+
+bool Analyzer::resume(SymbolId symbol) {
+	ResumableState* state = resumable.find(symbol);
+	bool is_fresh = state != nullptr && !state->rows.empty()
+		&& get_unix_time_ms() - snapshot_time < 60000;
+	if (is_fresh) {
+		dataset[symbol] = std::move(state->rows);
+		captured_rows.erase(symbol);
+		ShardSlab& slab = get_slab(symbol);
+		if (!state->last_record.empty()) {
+			slab.last_records[symbol] = std::move(state->last_record);
+		}
+		slab.signal_counters[symbol] = state->signal_counter;
+		init_asset(symbol);
+	}
+	resumable.erase(symbol);
+	return is_fresh;
+}
+
+void Analyzer::prepare_rows(
+	SymbolId symbol, const std::deque<double>& prev_close_prices, size_t iteration
+) {
 	size_t rsi_period = 13;
 	size_t bb_period = 20;
-	size_t iteration = 0;
+	captured_rows.erase(symbol);
 
 	for (auto&& price : prev_close_prices) {
 		std::deque<double> cells;
@@ -783,24 +1537,32 @@ void Analyzer::prepare_single(const std::pair<std::string, std::deque<double>>&
 		dataset[symbol].push_back(cells);
 		++iteration;
 		// create record
+		init_asset(symbol);
+		get_slab(symbol).signal_counters[symbol] = 0;
+	}
+}
+
+void Analyzer::init_asset(SymbolId symbol) {
+	if (!assets.contains(symbol)) {
 		assets[symbol] = 0;
-		signal_counter_map[symbol] = 0;
 	}
 }
 
-void Analyzer::remove(const std::string& symbol) {
+void Analyzer::remove(SymbolId symbol) {
 	// force sell - if there is anything to sell
+	ShardSlab& slab = get_slab(symbol);
 	if (assets.at(symbol) > 0) {
-		double last_price = last_records.at(symbol).at(last_records.size() - 1);
+		double last_price = slab.last_records.at(symbol).back();
 		process_sell_signal(symbol, last_price);
 	}
 	dataset.erase(symbol);
+	captured_rows.erase(symbol);
 	assets.erase(symbol);
-	signal_counter_map.erase(symbol);
-	last_records.erase(symbol);
+	slab.signal_counters.erase(symbol);
+	slab.last_records.erase(symbol);
 }
 
-void Analyzer::prepare(const std::unordered_map<std::string, std::deque<double>>& data) {
+void Analyzer::prepare(const SymbolMap<std::deque<double>>& data) {
 	for (auto&& [key, values] : data) {
 		prepare_single({key, values});
 	}
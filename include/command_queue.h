@@ -0,0 +1,92 @@
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "utilities.h"
+
+/**
+ * @brief Mutations of the engine state requested by the console (add, remove, deposit)
+ * - the console thread only submits them, the thread which runs the analysis
+ * executes them between two ticks - the state has a single writer
+ * - commands report their outcome themselves once executed (asynchronous completion)
+ * - an empty queue is checked without locking (the tick path)
+ */
+class CommandQueue {
+public:
+	using Command = std::function<void()>;
+
+	CommandQueue() : mutex(), pending(), pending_count(0), next_ticket(1) { }
+	CommandQueue(const CommandQueue&) = delete;
+	CommandQueue& operator=(const CommandQueue&) = delete;
+
+	/**
+	 * @param label - shown if the command fails
+	 * @returns ticket of the command (order of the execution)
+	 */
+	size_t submit(const std::string& label, Command command);
+
+	/**
+	 * @brief Executes the submitted commands in order
+	 * - called by the thread which owns the state
+	 * @returns number of executed commands
+	 */
+	size_t drain();
+
+	/**
+	 * @returns commands waiting for the next tick
+	 */
+	size_t size() const;
+
+private:
+	struct Entry {
+		size_t ticket;
+		std::string label;
+		Command command;
+	};
+
+	std::mutex mutex;
+	std::vector<Entry> pending;
+	std::atomic<size_t> pending_count;
+	size_t next_ticket;
+};
+
+#ifndef COMMAND_QUEUE_DEFINITIONS
+
+size_t CommandQueue::submit(const std::string& label, Command command) {
+	std::lock_guard<std::mutex> guard(mutex);
+	size_t ticket = next_ticket++;
+	pending.push_back({ ticket, label, std::move(command) });
+	pending_count.store(pending.size(), std::memory_order_release);
+	return ticket;
+}
+
+size_t CommandQueue::drain() {
+	if (pending_count.load(std::memory_order_acquire) == 0) {
+		return 0;
+	}
+	std::vector<Entry> batch;
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		batch.swap(pending);
+		pending_count.store(0, std::memory_order_release);
+	}
+	// the console may submit further commands meanwhile, they wait for the next tick
+	for (auto&& entry : batch) {
+		try {
+			entry.command();
+		}
+		catch (std::exception& exc) {
+			print("Command #", entry.ticket, " (", entry.label, ") failed: ", exc.what(), "\n");
+		}
+	}
+	return batch.size();
+}
+
+size_t CommandQueue::size() const {
+	return pending_count.load(std::memory_order_acquire);
+}
+
+#endif // !COMMAND_QUEUE_DEFINITIONS
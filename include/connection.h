@@ -14,6 +14,17 @@
 #include "transaction.h"
 #include "analysis.h"
 #include "mapping.h"
+#include "scheduler.h"
+#include "pipeline.h"
+#include "latency_tracker.h"
+#include "kline_cache.h"
+#include "consolidated_feed.h"
+#include "symbol_table.h"
+#include "ticker_layout.h"
+#include "time_series.h"
+#include "executor.h"
+#include "market_view.h"
+#include "command_queue.h"
 
 using JSON_value = web::json::value;
 using JSON_value_t = web::json::value::value_type;
@@ -39,9 +50,88 @@ class BinanceApiConn;
 // since they are accessed from multiple endpoints
 // - to keep one common variable across the *Conn classes
 
-std::unordered_map<std::string, std::shared_ptr<CryptoToken>> crypto_actions;
-std::unordered_map<std::string, double> cryptocurrency_pairs;
+// - symbols are interned once, per-symbol state is indexed by their ids
+std::shared_ptr<SymbolTable> symbols = std::make_shared<SymbolTable>();
+// - the watchlist (a column per field, see TokenTable)
+TokenTable crypto_actions;
+SymbolMap<double> cryptocurrency_pairs;
 std::shared_ptr<Analyzer> analyzer;
+std::shared_ptr<RequestScheduler> scheduler;
+std::shared_ptr<ConsolidatedFeed> feed;
+std::shared_ptr<TimeSeriesStore> price_history;
+// - published by the analysis after every tick, read by the commands
+std::shared_ptr<VersionedSnapshot<MarketView>> market_view = std::make_shared<VersionedSnapshot<MarketView>>();
+// - submitted by the commands, executed by the analysis between two ticks
+std::shared_ptr<CommandQueue> commands = std::make_shared<CommandQueue>();
+// - network I/O: kline downloads, hedge and deadline timers of the requests
+std::shared_ptr<Executor> executor;
+
+/**
+ * @brief Output of the fetch stage of the tick pipeline
+ * - raw response body, JSON parsing is left to the parse stage
+ */
+struct RawResponse {
+    std::string body;
+    bool add_to_ds = false;
+    time_var requested {};
+};
+
+/**
+ * @brief Shared state of one deadline-bounded (possibly hedged) request
+ * - the first successful attempt completes the result, the others are cancelled
+ */
+struct HedgedRequestState {
+    pplx::task_completion_event<http_response> result;
+    std::vector<pplx::cancellation_token_source> attempts;
+    std::mutex mutex;
+    bool done = false;
+    size_t launched = 0;
+    size_t failed = 0;
+    std::string last_error;
+};
+
+/**
+ * @brief Kline request of the initial run which is in flight
+ */
+struct PendingDataset {
+    std::string name;
+    std::vector<Kline> cached; // klines of the symbol already in the cache
+    std::optional<pplx::task<http_response>> request;
+};
+
+/**
+ * @brief Output of the parse stage of the tick pipeline
+ * - symbols with their prices as received from the API
+ */
+struct PriceSnapshot {
+    std::vector<std::pair<SymbolId, double>> prices;
+    bool add_to_ds = false;
+    time_var requested {};
+    int64_t timestamp = 0; // Unix time in ms when the prices were received
+};
+
+/**
+ * @brief The analysis is behind - an older snapshot becomes a part of the newer one
+ * - the ticker contains all the symbols, therefore the newer prices supersede the older ones
+ * - the dataset update is kept, the latency is measured from the older request
+ */
+inline void conflate_snapshots(PriceSnapshot& newer, PriceSnapshot& older) {
+    newer.add_to_ds = newer.add_to_ds || older.add_to_ds;
+    newer.requested = older.requested;
+}
+
+/**
+ * @brief Base url of the exchange API
+ * - TTM_API_URL environment variable takes precedence (i.e. a local mock exchange)
+ * @param default_url - url of the production API
+ */
+inline std::string get_api_url(const std::string& default_url) {
+    const char* configured = std::getenv("TTM_API_URL");
+    if (configured != nullptr && *configured != '\0') {
+        return configured;
+    }
+    return default_url;
+}
 
 /**
  * @brief Parent class of all API connectors 
@@ -50,7 +140,18 @@ std::shared_ptr<Analyzer> analyzer;
 class ApiConn {
 public:
     ApiConn() {
-        analyzer = create_shared<Analyzer>();
+        // shared by all the connectors - the journal is recovered only once
+        if (!analyzer) {
+            analyzer = create_shared<Analyzer>(symbols);
+        }
+        if (!price_history) {
+            price_history = std::make_shared<TimeSeriesStore>(symbols);
+            price_history->load();
+        }
+        if (!executor) {
+            executor = std::make_shared<Executor>();
+        }
+        scheduler = std::make_shared<RequestScheduler>();
     }
     virtual ~ApiConn() { }
 
@@ -59,6 +160,13 @@ public:
     virtual void receive_current_data(bool) = 0;
     virtual void prepare_datasets(const std::vector<std::string>&) = 0;
 
+    /////////////////////////////////////////
+    // Functions required for the pipelined run
+    virtual bool submit_current_data(bool) = 0;
+    virtual void stop_pipeline() = 0;
+    virtual RingStats get_pipeline_stats() const = 0;
+    virtual AllocationStats get_tick_allocation_stats() const = 0;
+
     /**
      * @brief Checks user's entered input whether the symbol exists in the API
      * - if it does - new cryptocurrency token is created (pointer to it)
@@ -75,6 +183,17 @@ public:
     inline void show_current_values() const;
     inline void show_transactions() const;
     inline void show_indicators() const;
+    /**
+     * @brief Shows the stored price history of a symbol
+     * (low, high and mean of the last hour, day and week)
+     */
+    inline void show_price_history(const std::string&) const;
+    /**
+     * @brief Shows a page of the transaction history
+     * @param symbol - cryptocurrency or ALL
+     * @param from, to - time range (Unix time in ms, inclusive)
+     */
+    inline void show_history(const std::string& symbol, int64_t from, int64_t to, size_t page) const;
     /**
      * @brief the analyzer to increase amount of money
      * if the value is valid, otherwise an error message is 
@@ -90,6 +209,26 @@ public:
     //TODO: doc
     void add_new_crypto_token(const std::string&);
     inline bool is_valid_input(const std::string&) const;
+
+    /**
+     * @brief Feeds the scheduler with the latest prices of the watchlist
+     * @param all - whether all symbols shall be analyzed regardless of their polling interval
+     * (i.e. when the dataset is extended)
+     * @param due - filled with the watched symbols which are due to be analyzed
+     * (in the order of the watchlist, the capacity is reused across the ticks)
+     */
+    void get_due_tokens(bool all, std::vector<SymbolId>& due) const;
+
+    /**
+     * @brief Takes the best buy and sell prices of the consolidated feed over to the watchlist.
+     */
+    void set_best_quote(size_t position, SymbolId symbol, int64_t timestamp);
+
+    /**
+     * @brief Publishes a new version of the market and portfolio view
+     * - called by the thread which runs the analysis (after the tick)
+     */
+    void publish_market_view() const;
 };
 
 /**
@@ -99,7 +238,18 @@ public:
 class GenericConn final : public ApiConn {
 public:
     ~GenericConn() { }
-    GenericConn(const std::shared_ptr<BinanceApiConn>& binance) : mem_binance(binance) { }
+
+    /**
+     * @param binance - primary venue (watchlist validation, datasets, pipeline)
+     * @param venues - further Binance compatible venues, their prices
+     * are merged with the primary ones into the consolidated feed
+     */
+    GenericConn(
+        const std::shared_ptr<BinanceApiConn>& binance,
+        const std::vector<std::shared_ptr<BinanceApiConn>>& venues = {}
+    ) : mem_binance(binance), mem_venues(venues) {
+        register_venues();
+    }
 
     /**
      * @brief Transfers the responsibility to the concerned connector
@@ -113,14 +263,46 @@ public:
      */
     virtual void receive_current_data(bool shall_add) override;
 
+    /**
+     * @brief Transfers the responsibility to the concerned connector
+     * @param shall_add - Whether the received data should be included in the dataset
+     * @returns false if the previous request has not been answered yet
+     */
+    virtual bool submit_current_data(bool shall_add) override;
+
+    /**
+     * @brief Transfers the responsibility to the concerned connector
+     */
+    virtual void stop_pipeline() override;
+
+    /**
+     * @brief Waits for the downloads and request timers of the connectors
+     * (cut short, the pipeline has to be stopped already) and stops the executor
+     * - the commands they submit are queued for the final drain
+     */
+    void finish_tasks();
+
+    /**
+     * @brief Transfers the responsibility to the concerned connector
+     */
+    virtual RingStats get_pipeline_stats() const override;
+
+    /**
+     * @brief Transfers the responsibility to the concerned connector
+     */
+    virtual AllocationStats get_tick_allocation_stats() const override;
+
     /**
      * @brief Checks whether the symbol is correct according to 
      * specified conditions
      * - if yes - it transfers a request for a symbol to be added to the watchlist 
+     * - called between two ticks (command queue), the symbol is watched
+     * once its dataset is downloaded (a later tick)
      * @param symbol - cryptocurrency
-     * @returns boolean value whether the action was accomplished
+     * @param on_added - called once the symbol is watched
+     * @returns boolean value whether the symbol can be added
      */
-    bool try_add_cryptocurrency(const std::string& symbol);
+    bool try_add_cryptocurrency(const std::string& symbol, const std::function<void()>& on_added);
 
     /**
      * @brief Looks in the user's watchlist and if it exists,
@@ -130,7 +312,14 @@ public:
     bool try_remove_cryptocurrency(const std::string&);
 private:
     GenericConn() { }
+
+    /**
+     * @brief Creates the consolidated feed and registers all venues.
+     */
+    void register_venues();
+
     std::shared_ptr<BinanceApiConn> mem_binance;
+    std::vector<std::shared_ptr<BinanceApiConn>> mem_venues;
 };
 
 /**
@@ -149,10 +338,48 @@ public:
      */
     virtual void receive_current_data(bool) override;
 
+    /**
+     * @brief Non-blocking variant of receive_current_data
+     * - only the request is sent, the response is handed over
+     * to the tick pipeline (parse and analysis stages) once it arrives
+     * - at most one request is in flight, so that snapshots are analyzed in order
+     * @returns false if the previous request has not been answered yet
+     */
+    virtual bool submit_current_data(bool) override;
+
+    /**
+     * @brief Cancels requests in flight, lets the pipeline finish
+     * already received data and stops it
+     */
+    virtual void stop_pipeline() override;
+
+    /**
+     * @returns depth and latency of the ring between the ingestion (parse)
+     * and the analysis thread
+     */
+    virtual RingStats get_pipeline_stats() const override;
+
+    /**
+     * @returns heap allocations of the ticks - from the received prices to the published view
+     * (the parse stage of the pipeline is not counted, it runs on its own thread)
+     */
+    virtual AllocationStats get_tick_allocation_stats() const override { return tick_allocations; }
+
+    /**
+     * @brief Non-blocking ticker request of a secondary venue
+     * - the prices are published to the consolidated feed once received,
+     * the request is skipped if the previous one has not been answered yet
+     */
+    void submit_quotes();
+
+    const std::string& get_venue() const { return venue; }
+    void set_venue_id(size_t id) { venue_id = id; }
+
     /**
      * @brief Makes an http request to Binance API via cpprest,
      * processes received json data from the API
      * and makes a request to save the dataset
+     * - cached klines are reused, only the missing tail is requested
      */
     virtual void prepare_datasets(const std::vector<std::string>&) override;
 
@@ -162,27 +389,173 @@ public:
      * to build the dataset by itself
      */
     void prepare_datasets_gold_data(const std::vector<std::string>&);
+
+    /**
+     * @brief Adds a symbol to the watchlist (called between two ticks)
+     * - the dataset is downloaded in the background, the symbol is added
+     * by a command once it is there (the ticks are not held by the download)
+     * @param on_added - called once the symbol is watched
+     */
+    void add_symbol(const std::string& name, const std::function<void()>& on_added);
    
 private: // methods
-    BinanceApiConn() : url("https://api.binance.com") {}
+    /**
+     * @brief Downloads the dataset of a symbol being added
+     * and hands it over to the command queue.
+     */
+    Task<void> add_symbol_async(std::string name, std::function<void()> on_added);
+
+    /**
+     * @brief Kline requests of all the symbols are sent within the budget
+     * without waiting for each other, the responses are saved in the original order
+     * - a single coroutine, the analyzer is not accessed concurrently
+     */
+    Task<void> prepare_datasets_async(std::vector<std::string> fnames);
+
+    /**
+     * @brief Hedge and deadline timers of a request (the executor timer heap)
+     * - the coroutine holds no thread while the request is in flight
+     */
+    Task<void> watch_request_async(std::shared_ptr<HedgedRequestState> state,
+        std::string address, ms deadline, RequestKind kind, time_var started);
+
+    BinanceApiConn(
+        const std::string& in_venue = "Binance",
+        const std::string& in_url = get_api_url("https://api.binance.com")
+    ) : url(in_url), venue(in_venue), venue_id(0), in_flight(false) {}
+
+    /**
+     * @brief Only the primary venue accounts its requests in the scheduler
+     * (other venues have their own limits)
+     */
+    bool is_primary() const { return venue_id == 0; }
 
     template<typename T, typename ...Args>
     friend std::shared_ptr<T> create_shared(Args&& ...args);
 
     /**
-     * @brief Obscure cpprest based JSON values to a map
-     * consisting of keys as symbol, values as prices
+     * @brief Obscure cpprest based JSON values to a snapshot
+     * consisting of symbols and their prices
      */
-    void save_json_data(const JSON_value&);
+    PriceSnapshot convert_json_data(const JSON_value&);
+
+    /**
+     * @brief Saves prices of the snapshot to local memory as a map
+     */
+    void save_snapshot(const PriceSnapshot&);
+
+    /**
+     * @brief Sends a GET request which is answered, failed or cancelled
+     * within the deadline given
+     * - if the response does not come within the usual (p95) latency
+     * or the attempt fails early, a second (hedged) request is sent,
+     * whichever answers first wins
+     * - all attempts are cancelled upon stop_pipeline (i.e. withdraw command)
+     * @param address - path and query of the request
+     * @param deadline - hard upper bound of the request
+     * @param kind - to account the request weight of each attempt
+     */
+    pplx::task<http_response> request_with_deadline(
+        const std::string& address, ms deadline, RequestKind kind
+    );
+
+    /**
+     * @brief Sends a single attempt of a deadline-bounded request
+     * - nothing is sent if the request is settled or all attempts are used up
+     * - an attempt failing before the others hedges right away,
+     * the last one failing settles the request
+     */
+    void launch_attempt(const std::shared_ptr<HedgedRequestState>& state,
+        const std::string& address, ms deadline, RequestKind kind, time_var started);
+
+    /**
+     * @brief Fails the request unless it has been answered.
+     */
+    void expire_request(const std::shared_ptr<HedgedRequestState>& state);
+
+    /**
+     * @returns delay of the hedged attempt (usual p95 latency within the deadline)
+     */
+    ms get_hedge_delay(ms deadline) const;
+
+    /**
+     * @brief Parse stage of the tick pipeline
+     */
+    std::optional<PriceSnapshot> parse_response(RawResponse&);
+
+    /**
+     * @brief Analysis stage of the tick pipeline
+     */
+    void analyze_snapshot(PriceSnapshot&);
+
+    /**
+     * @brief End of a tick on the analysis thread - commands, analysis and the published view
+     * @param allocations - heap allocations of the thread when the tick started
+     */
+    void finish_tick(bool add_to_ds, uint64_t allocations);
 
     /**
      * @brief Stores the data received from the API to a map
      * which is further transfered to the analyzer
+     * - the indicator state is resumed from the cached checkpoint if it is up to date,
+     * closed klines are appended to the cache
+     * @param cached - klines of the symbol already in the cache
      * @see https://binance-docs.github.io/apidocs/spot/en/#kline-candlestick-data
      */
-    void save_dataset(const JSON_value&, const std::string&);
+    void save_dataset(const JSON_value&, const std::string&, const std::vector<Kline>& cached);
 private: // fields
     std::string url;
+    std::string venue;
+    size_t venue_id;
+    std::unique_ptr<TickPipeline<RawResponse, PriceSnapshot>> pipeline;
+    std::atomic<bool> in_flight;
+    KlineCache kline_cache;
+
+    /**
+     * @brief Symbol order of the ticker response (conversions are
+     * sequential - initial call, then the parse stage or the venue request).
+     */
+    TickerLayout ticker_layout;
+
+    /**
+     * @brief Symbols due in the current tick (kept for its capacity).
+     */
+    std::vector<SymbolId> due_tokens;
+
+    /**
+     * @brief Heap allocations of the whole tick (the analysis thread and the shards)
+     */
+    AllocationStats tick_allocations;
+
+    /**
+     * @brief Latency of successful requests (source of the hedging delay).
+     */
+    LatencyTracker latencies;
+
+    /**
+     * @brief Parent of the cancellation tokens of all requests.
+     */
+    pplx::cancellation_token_source shutdown_source;
+
+    /**
+     * @brief Deadlines of the requests - the ticker one bounds the tick latency,
+     * klines (add command, start) carry a lot more data.
+     */
+    const ms ticker_deadline = ms(3000);
+    const ms klines_deadline = ms(10000);
+
+    /**
+     * @brief Hedging delay until enough latencies are known
+     * and its bounds afterwards (p95 of the latency).
+     */
+    const ms default_hedge_delay = ms(500);
+    const ms min_hedge_delay = ms(50);
+    const size_t max_attempts = 2;
+
+    /**
+     * @brief Capacity of the queue and the ring between the pipeline stages.
+     */
+    const size_t pipeline_capacity = 2;
 };
 
 #ifndef PRINT_FUNCTIONS
@@ -195,16 +568,83 @@ inline static void print_total(double final_balance) {
     print("You ended up with ", final_balance, " USD\n");
 }
 
+inline static void print_no_market_view() {
+    print("No market data yet\n");
+}
+
+inline static void print_dataset_unavailable(const std::string& symbol) {
+    print(symbol, " was not added - its dataset could not be downloaded\n");
+}
+
 inline void ApiConn::show_transactions() const {
-    analyzer->print_transactions();
+    auto&& view = market_view->read();
+    if (!view) {
+        print_no_market_view();
+        return;
+    }
+    analyzer->print_transactions(*view);
+}
+
+inline void ApiConn::show_history(const std::string& symbol, int64_t from, int64_t to, size_t page) const {
+    std::optional<SymbolId> id;
+    if (symbol != "ALL") {
+        id = symbols->find(symbol);
+        if (!id) {
+            print("No transactions of ", symbol, "\n");
+            return;
+        }
+    }
+    analyzer->print_history(id, from, to, page);
 }
 
 inline void ApiConn::show_indicators() const {
-    analyzer->print_indicators();
+    auto&& view = market_view->read();
+    if (!view) {
+        print_no_market_view();
+        return;
+    }
+    print_indicators(*view);
+}
+
+inline void ApiConn::show_price_history(const std::string& symbol) const {
+    auto&& id = symbols->find(symbol);
+    auto&& range = id ? price_history->get_time_range(*id) : std::nullopt;
+    if (!range) {
+        print("No price history of ", symbol, "\n");
+        return;
+    }
+    print(symbol, ": ", price_history->get_point_count(*id), " prices since ",
+        get_datetime(sys_clock::time_point(ms(range->first))), "\n");
+    std::vector<std::pair<std::string, int64_t>> windows {
+        { "hour", 3600000LL }, { "day", 86400000LL }, { "week", 7 * 86400000LL }
+    };
+    for (auto&& [label, length] : windows) {
+        double low = std::numeric_limits<double>::max();
+        double high = std::numeric_limits<double>::lowest();
+        double sum = 0;
+        size_t count = 0;
+        price_history->scan(*id, range->second - length, range->second, [&](int64_t, double price) {
+            low = std::min(low, price);
+            high = std::max(high, price);
+            sum += price;
+            ++count;
+        });
+        if (count == 0) {
+            print("- last ", label, ": no prices\n");
+            continue;
+        }
+        print("- last ", label, ": low ", low, " high ", high, " mean ", sum / count, " USD\n");
+    }
+    print("Price history takes ", price_history->get_memory_usage() / 1024, " kB of memory\n");
 }
 
 inline void ApiConn::show_current_state() const {
-    analyzer->print_current(crypto_actions);
+    auto&& view = market_view->read();
+    if (!view) {
+        print_no_market_view();
+        return;
+    }
+    print_portfolio(*view);
 }
 
 inline void ApiConn::show_result() const {
@@ -213,45 +653,87 @@ inline void ApiConn::show_result() const {
 }
 
 inline void ApiConn::show_current_values() const {
-    for (auto&& [key, val] : crypto_actions) {
-        double current_value = cryptocurrency_pairs[key];
-        print("[", key, ": ", current_value, " USD]\n");
+    auto&& view = market_view->read();
+    if (!view) {
+        print_no_market_view();
+        return;
     }
+    print_quotes(*view);
 }
 
 inline void ApiConn::print_all() const {
     for (auto&& [key, val] : cryptocurrency_pairs) {
-        print(key, " : ", val, "\n");
+        print(symbols->get_name(key), " : ", val, "\n");
     }
 }
 
 inline void ApiConn::print_concrete(const std::string& symbol) const {
-    auto it = cryptocurrency_pairs.find(symbol);
-    if (it != cryptocurrency_pairs.end())
-        print(it->first, " : ", it->second, "\n");
+    auto&& id = symbols->find(symbol);
+    if (id && cryptocurrency_pairs.contains(*id))
+        print(symbol, " : ", cryptocurrency_pairs.at(*id), "\n");
 }
 #endif // !PRINT_FUNCTIONS
 
 #ifndef GENERICCONN_DEFINITIONS
 inline void GenericConn::receive_current_data(bool add_to_ds) {
+    for (auto&& venue : mem_venues) {
+        venue->submit_quotes();
+    }
     mem_binance->receive_current_data(add_to_ds);
 }
 
+inline bool GenericConn::submit_current_data(bool add_to_ds) {
+    // venues are requested independently, a slow one does not hold the others
+    for (auto&& venue : mem_venues) {
+        venue->submit_quotes();
+    }
+    return mem_binance->submit_current_data(add_to_ds);
+}
+
+inline void GenericConn::stop_pipeline() {
+    for (auto&& venue : mem_venues) {
+        venue->stop_pipeline();
+    }
+    mem_binance->stop_pipeline();
+}
+
+inline void GenericConn::finish_tasks() {
+    executor->stop();
+}
+
+inline RingStats GenericConn::get_pipeline_stats() const {
+    // secondary venues publish to the consolidated feed, only the primary one is analyzed
+    return mem_binance->get_pipeline_stats();
+}
+
+inline AllocationStats GenericConn::get_tick_allocation_stats() const {
+    return mem_binance->get_tick_allocation_stats();
+}
+
+void GenericConn::register_venues() {
+    feed = std::make_shared<ConsolidatedFeed>();
+    mem_binance->set_venue_id(feed->add_venue(mem_binance->get_venue()));
+    for (auto&& venue : mem_venues) {
+        venue->set_venue_id(feed->add_venue(venue->get_venue()));
+    }
+}
+
 bool GenericConn::try_remove_cryptocurrency(const std::string& symbol) {
-    bool is_valid_op = crypto_actions.find(symbol) != crypto_actions.end();
+    auto&& id = symbols->find(symbol);
+    bool is_valid_op = id && crypto_actions.contains(*id);
     if (is_valid_op) {
-        crypto_actions.erase(symbol);
-        analyzer->remove(symbol);
+        crypto_actions.erase(*id);
+        analyzer->remove(*id);
+        scheduler->remove(*id);
     }
     return is_valid_op;
 }
 
-bool GenericConn::try_add_cryptocurrency(const std::string& symbol) {
+bool GenericConn::try_add_cryptocurrency(const std::string& symbol, const std::function<void()>& on_added) {
     bool is_valid_op = is_valid_input(symbol)
-        && crypto_actions.find(symbol) == crypto_actions.end(); // not yet included in a watchlist
+        && !crypto_actions.contains(symbols->intern(symbol)); // not yet included in a watchlist
     if (is_valid_op) {
-        add_new_crypto_token(symbol);
-        mem_binance->prepare_datasets({ symbol });
+        mem_binance->add_symbol(symbol, on_added);
     }
     return is_valid_op;
 }
@@ -268,13 +750,16 @@ void GenericConn::prepare_datasets(const std::vector<std::string>& fnames) {
 #else
     mem_binance->prepare_datasets(fnames);
 #endif
+    // the first view - before the first tick is analyzed
+    publish_market_view();
 }
 
 #endif // !GENERICCONN_DEFINITIONS
 
 #ifndef APICONN_DEFINITIONS
 inline bool ApiConn::is_valid_input(const std::string& crypto_pair) const {
-    return cryptocurrency_pairs.find(crypto_pair) != cryptocurrency_pairs.end()
+    auto&& id = symbols->find(crypto_pair);
+    return id && cryptocurrency_pairs.contains(*id)
         && is_contained_once("USD", crypto_pair);
     // we want to support only cryptocurrency<->us dollar direction to easily determine
     // buy-sell relationship
@@ -284,17 +769,27 @@ inline bool ApiConn::is_valid_input(const std::string& crypto_pair) const {
 }
 
 void ApiConn::add_new_crypto_token(const std::string& cryptocurrency) {
-    auto&& ptr = create_shared<CryptoToken>();
-    Action default_action = Action::DEFAULT;
-    ptr->set_state(default_action);
-    ptr->set_value(cryptocurrency_pairs[cryptocurrency]);
-    crypto_actions[cryptocurrency] = std::move(ptr);
+    SymbolId id = symbols->intern(cryptocurrency);
+    size_t position = crypto_actions.insert(id, cryptocurrency_pairs[id]);
+    crypto_actions.set_state(position, Action::DEFAULT);
+    if (feed && feed->get_venue_count() > 1) {
+        // the best quote may not change for a while
+        set_best_quote(position, id, get_unix_time_ms());
+    }
     //show_current_values();
 }
 
 std::vector<std::string> ApiConn::filter_set_preferences(const std::vector<std::string>& input) {
+    std::vector<std::string> requested = input;
+    // holdings recovered from the journal stay watched (they can be sold)
+    for (auto&& held : analyzer->get_held_symbols()) {
+        if (std::find(requested.begin(), requested.end(), held) == requested.end()) {
+            print("Resuming ", held, " (held since the previous run)\n");
+            requested.push_back(held);
+        }
+    }
     std::vector<std::string> values;
-    for (auto&& cryptocurrency : input) {
+    for (auto&& cryptocurrency : requested) {
         if (is_valid_input(cryptocurrency)) {
             add_new_crypto_token(cryptocurrency);
             values.push_back(cryptocurrency);
@@ -310,30 +805,73 @@ inline void ApiConn::deposit(double value) {
     analyzer->deposit(value);
 }
 
+void ApiConn::publish_market_view() const {
+    // built aside, the readers still see the previous version meanwhile
+    // - in place of a former version (the strings and vectors keep their memory)
+    auto view = market_view->acquire();
+    view->timestamp = get_unix_time_ms();
+    auto&& watched = crypto_actions.get_symbols();
+    auto&& values = crypto_actions.get_values();
+    auto&& buy_values = crypto_actions.get_buy_values();
+    auto&& sell_values = crypto_actions.get_sell_values();
+    auto&& sources = crypto_actions.get_sources();
+    auto&& sell_sources = crypto_actions.get_sell_sources();
+    view->quotes.resize(watched.size());
+    for (size_t position = 0; position < watched.size(); ++position) {
+        auto&& quote = view->quotes[position];
+        quote.symbol = symbols->get_name(watched[position]);
+        quote.price = values[position];
+        quote.source = sources[position];
+        quote.buy_price = buy_values[position];
+        quote.sell_price = sell_values[position];
+        quote.sell_source = sell_sources[position];
+    }
+    analyzer->fill_view(*view, crypto_actions);
+    market_view->publish(std::move(view));
+}
+
+void ApiConn::set_best_quote(size_t position, SymbolId symbol, int64_t timestamp) {
+    auto&& best = feed->get_best(symbol);
+    if (best) {
+        crypto_actions.set_quote(position, best->buy, best->sell, timestamp,
+            feed->get_venue_name(best->buy_venue), feed->get_venue_name(best->sell_venue)
+        );
+    }
+}
+
+void ApiConn::get_due_tokens(bool all, std::vector<SymbolId>& due) const {
+    // a linear scan of two columns
+    auto&& watched = crypto_actions.get_symbols();
+    auto&& values = crypto_actions.get_values();
+    due.clear();
+    for (size_t position = 0; position < watched.size(); ++position) {
+        SymbolId symbol = watched[position];
+        scheduler->record_price(symbol, values[position]);
+        if (all || scheduler->is_due(symbol)) {
+            scheduler->mark_polled(symbol);
+            due.push_back(symbol);
+        }
+    }
+}
+
 #endif // !APICONN_DEFINITIONS
 
 #ifndef BINANCE_DEFINITIONS
 
 #ifndef BINANCE_API_SPECIFIC_FUNCTIONS
-inline void quotes_trim(std::string& str) {
-    str = str.substr(1, str.size() - 2);
-}
-
 /**
- * @brief Cleans up received data (price and symbol)
- * cpprest specific format serialization to std::string
+ * @brief Gets received data (price and symbol) as std::string
+ * - the string value is taken as is (no serialization and quotes trimming),
+ * symbols and prices fit into the small string buffer
  * @param object - a record from the json array 
  * @param key - symbol or price desired from the object above
- * @returns cleaned up string of demanded data
+ * @returns demanded data
  */
 std::string api_specific_object_conversion(
     const web::json::object& object, const std::string& key
 ) {
     auto&& util_key = utility::conversions::to_string_t(key);
-    auto&& serialized = object.at(util_key).serialize();
-    std::string str = utility::conversions::to_utf8string(serialized);
-    quotes_trim(str);
-    return str;
+    return utility::conversions::to_utf8string(object.at(util_key).as_string());
 }
 
 /**
@@ -345,10 +883,40 @@ std::string api_specific_object_conversion(
  */
 double api_specific_array_conversion(const web::json::array& arr, size_t index) {
     auto&& util_price = arr.at(index).as_string();
+    // exchange prices fit into the small string buffer - no allocation
     auto str_price = utility::conversions::to_utf8string(util_price);
-    double value = convert_string_to<double>(str_price);
+    double value = 0;
+    if (!parse_number(str_price, value)) {
+        throw std::invalid_argument("Malformed kline value: '" + str_price + "'");
+    }
     return value;
 }
+
+/**
+ * @brief Gets a timestamp (Unix time in ms) from a kline array
+ * @see https://binance-docs.github.io/apidocs/spot/en/#kline-candlestick-data
+ */
+int64_t api_specific_time_conversion(const web::json::array& arr, size_t index) {
+    return arr.at(index).as_number().to_int64();
+}
+
+/**
+ * @brief Hands over the request weight used in the current minute
+ * (as reported by the exchange) to the scheduler
+ * @see https://binance-docs.github.io/apidocs/spot/en/#limits
+ */
+void update_used_weight(const http_response& response) {
+    auto&& headers = response.headers();
+    auto it = headers.find(_XPLATSTR("X-MBX-USED-WEIGHT-1M"));
+    if (it != headers.end()) {
+        try {
+            scheduler->update_used_weight(
+                convert_string_to<size_t>(utility::conversions::to_utf8string(it->second))
+            );
+        }
+        catch (std::invalid_argument&) { }
+    }
+}
 #endif // !BINANCE_API_SPECIFIC_FUNCTIONS
 
 void BinanceApiConn::prepare_datasets_gold_data(const std::vector<std::string>& fnames) {
@@ -356,76 +924,481 @@ void BinanceApiConn::prepare_datasets_gold_data(const std::vector<std::string>&
 }
 
 void BinanceApiConn::prepare_datasets(const std::vector<std::string>& fnames) {
-    auto util_url = utility::conversions::to_string_t(url);
-    http_client client(util_url);
+    executor->run_sync(prepare_datasets_async(fnames));
+}
+
+void BinanceApiConn::add_symbol(const std::string& name, const std::function<void()>& on_added) {
+    if (analyzer->resume(symbols->intern(name))) {
+        print(name, ": indicators resumed from the snapshot\n");
+        add_new_crypto_token(name);
+        on_added();
+        return;
+    }
+    executor->spawn(add_symbol_async(name, on_added));
+}
+
+Task<void> BinanceApiConn::add_symbol_async(std::string name, std::function<void()> on_added) {
+    std::string address = ("/api/v3/klines?symbol=" + name + "&interval=1m");
+    std::vector<Kline> cached = kline_cache.load(name);
+    if (!cached.empty() && kline_cache.is_recent(cached.back())) {
+        // only the tail which is not cached yet
+        address += "&startTime=" + std::to_string(cached.back().open_time + 60000);
+    }
+    else {
+        cached.clear();
+    }
+    JSON_value json;
+    try {
+        co_await executor->sleep_for(scheduler->get_klines_budget_delay());
+        http_response response = co_await executor->completion_of(
+            request_with_deadline(address, klines_deadline, RequestKind::Klines)
+        );
+        update_used_weight(response);
+        if (response.status_code() == status_codes::OK) {
+            json = co_await executor->completion_of(response.extract_json());
+        }
+        else {
+            print("Can't connect right now: ",
+                convert_to_string(response.status_code()), "\n"
+            );
+        }
+    }
+    catch (std::exception& exc) {
+        print("Can't connect right now: ", exc.what(), "\n");
+    }
+    // the analyzer is touched only between two ticks
+    commands->submit("add " + name, [this, name, cached, json, on_added] {
+        if (crypto_actions.contains(symbols->intern(name))) {
+            return; // added twice meanwhile
+        }
+        // a symbol without its dataset would be analyzed without the previous rows
+        if (!json.is_array()) {
+            print_dataset_unavailable(name);
+            return;
+        }
+        try {
+            save_dataset(json, name, cached);
+        }
+        catch (std::exception& exc) {
+            print(name, ": ", exc.what(), "\n");
+            print_dataset_unavailable(name);
+            return;
+        }
+        add_new_crypto_token(name);
+        on_added();
+    });
+}
+
+Task<void> BinanceApiConn::prepare_datasets_async(std::vector<std::string> fnames) {
+    std::vector<PendingDataset> pending;
     for (auto&& name : fnames) {
+        if (analyzer->resume(symbols->intern(name))) {
+            print(name, ": indicators resumed from the snapshot\n");
+            continue;
+        }
         std::string address = ("/api/v3/klines?symbol=" + name + "&interval=1m");
-        client.request(methods::GET, utility::conversions::to_string_t(address))
+        std::vector<Kline> cached = kline_cache.load(name);
+        if (!cached.empty() && kline_cache.is_recent(cached.back())) {
+            // only the tail which is not cached yet
+            address += "&startTime=" + std::to_string(cached.back().open_time + 60000);
+        }
+        else {
+            cached.clear();
+        }
+        // the weight is recorded as the request is sent - the next delay counts with it
+        co_await executor->sleep_for(scheduler->get_klines_budget_delay());
+        pending.push_back({ name, std::move(cached), std::nullopt });
+        try {
+            pending.back().request = request_with_deadline(address, klines_deadline, RequestKind::Klines);
+        }
+        catch (std::exception& exc) {
+            print("Can't connect right now: ", exc.what(), "\n");
+        }
+    }
+    for (auto&& dataset : pending) {
+        if (!dataset.request) {
+            continue;
+        }
+        try {
+            http_response response = co_await executor->completion_of(*dataset.request);
+            update_used_weight(response);
+            JSON_value json;
+            if (response.status_code() == status_codes::OK) {
+                json = co_await executor->completion_of(response.extract_json());
+            }
+            else {
+                print("Can't connect right now: ",
+                    convert_to_string(response.status_code()), "\n"
+                );
+            }
+            save_dataset(json, dataset.name, dataset.cached);
+        }
+        catch (std::exception& exc) {
+            print("Can't connect right now: ", exc.what(), "\n");
+        }
+    }
+}
+
+void BinanceApiConn::save_dataset(
+    const JSON_value& data, const std::string& symbol, const std::vector<Kline>& cached
+) {
+    auto&& json_arr = data.as_array();
+    // According to https://binance-docs.github.io/apidocs/spot/en/#kline-candlestick-data
+    size_t open_time_index = 0;
+    size_t close_index = 4;
+    size_t close_time_index = 6;
+    int64_t now = get_unix_time_ms();
+    int64_t last_cached = cached.empty() ? 0 : cached.back().open_time;
+    std::vector<Kline> closed;
+    std::deque<double> current; // the kline of the current minute is not closed yet
+    for (auto it = json_arr.begin(); it != json_arr.end(); ++it) {
+        auto&& array_v = it->as_array();
+        Kline kline { api_specific_time_conversion(array_v, open_time_index),
+            api_specific_array_conversion(array_v, close_index) };
+        if (kline.open_time <= last_cached) {
+            continue;
+        }
+        if (api_specific_time_conversion(array_v, close_time_index) < now) {
+            closed.push_back(kline);
+        }
+        else {
+            current.push_back(kline.close);
+        }
+    }
+
+    std::deque<double> new_closes;
+    for (auto&& kline : closed) {
+        new_closes.push_back(kline.close);
+    }
+    SymbolId id = symbols->intern(symbol);
+    auto&& checkpoint = kline_cache.load_checkpoint(symbol);
+    if (!cached.empty() && checkpoint && checkpoint->open_time == last_cached) {
+        // warm restart - indicators continue where they stopped
+        analyzer->restore(id, checkpoint->rows);
+        analyzer->extend(id, new_closes);
+    }
+    else {
+        SymbolMap<std::deque<double>> values;
+        for (auto&& kline : cached) {
+            values[id].push_back(kline.close);
+        }
+        values[id].insert(values[id].end(), new_closes.begin(), new_closes.end());
+        analyzer->prepare(values);
+    }
+    if (!closed.empty()) {
+        kline_cache.store(symbol, closed, cached.empty());
+        kline_cache.save_checkpoint(symbol, { closed.back().open_time, analyzer->get_rows(id) });
+    }
+    analyzer->extend(id, current);
+}
+
+void BinanceApiConn::receive_current_data(bool add_to_ds) {
+    std::string address = "/api/v3/ticker/price";
+    try {
+        request_with_deadline(address, ticker_deadline, RequestKind::Ticker)
             .then([](const http_response& response) {
+                update_used_weight(response);
                 if (response.status_code() == status_codes::OK) {
                     return response.extract_json();
                 }
                 else {
-                    print("Can't connect right now: ",
-                        convert_to_string(response.status_code()), "\n"
-                    );
+                    print("Can't connect right now: ", std::to_string(response.status_code()), "\n");
                     return pplx::task_from_result(JSON_value());
                 }
             })
-            .then([this, name](const JSON_value& json) {
-                save_dataset(json, name);
+            .then([this](const JSON_value& json) {
+                save_snapshot(convert_json_data(json));
                 return json;
             })
             .wait();
     }
+    catch (std::exception& exc) {
+        print("Can't connect right now: ", exc.what(), "\n");
+    }
+    finish_tick(add_to_ds, thread_heap_allocations);
 }
 
-void BinanceApiConn::save_dataset(const JSON_value& data, const std::string& symbol) {
-    std::unordered_map<std::string, std::deque<double>> values;
-    auto&& json_arr = data.as_array();
-    // According to https://binance-docs.github.io/apidocs/spot/en/#kline-candlestick-data
-    size_t close_index = 4;
-    for (auto it = json_arr.begin(); it != json_arr.end(); ++it) {
-        auto&& array_v = it->as_array();
-        double price = api_specific_array_conversion(array_v, close_index);
-        values[symbol].push_back(price);
+bool BinanceApiConn::submit_current_data(bool add_to_ds) {
+    if (in_flight.exchange(true)) {
+        return false;
+    }
+    if (!pipeline) {
+        pipeline = std::make_unique<TickPipeline<RawResponse, PriceSnapshot>>(
+            [this](RawResponse& raw) { return parse_response(raw); },
+            [this](PriceSnapshot& snapshot) { analyze_snapshot(snapshot); },
+            conflate_snapshots,
+            pipeline_capacity
+        );
     }
-    analyzer->prepare(values);
+    std::string address = "/api/v3/ticker/price";
+    time_var requested = high_clock::now();
+    request_with_deadline(address, ticker_deadline, RequestKind::Ticker)
+        .then([](const http_response& response) {
+            update_used_weight(response);
+            if (response.status_code() == status_codes::OK) {
+                return response.extract_utf8string();
+            }
+            else {
+                print("Can't connect right now: ", std::to_string(response.status_code()), "\n");
+                return pplx::task_from_result(std::string());
+            }
+        })
+        .then([this, add_to_ds, requested](pplx::task<std::string> body_task) {
+            try {
+                std::string body = body_task.get();
+                if (!body.empty()) {
+                    pipeline->push({ std::move(body), add_to_ds, requested });
+                }
+            }
+            catch (std::exception& exc) {
+                print("Can't connect right now: ", exc.what(), "\n");
+            }
+            in_flight.store(false);
+        });
+    return true;
 }
 
-void BinanceApiConn::receive_current_data(bool add_to_ds) {
-    auto util_url = utility::conversions::to_string_t(url);
-    http_client client(util_url);
+void BinanceApiConn::submit_quotes() {
+    if (in_flight.exchange(true)) {
+        return;
+    }
     std::string address = "/api/v3/ticker/price";
-    client.request(methods::GET, utility::conversions::to_string_t(address))
-        .then([](const http_response& response) {
+    request_with_deadline(address, ticker_deadline, RequestKind::Ticker)
+        .then([this](const http_response& response) {
             if (response.status_code() == status_codes::OK) {
                 return response.extract_json();
             }
             else {
-                print("Can't connect right now: ", std::to_string(response.status_code()), "\n");
+                print(venue, " can't connect right now: ", std::to_string(response.status_code()), "\n");
                 return pplx::task_from_result(JSON_value());
             }
         })
-        .then([this](const JSON_value& json) {
-            save_json_data(json);
-            return json;
-        })
-        .wait();        
-        analyzer->get_analysis(crypto_actions, add_to_ds);
+        .then([this](pplx::task<JSON_value> json_task) {
+            try {
+                PriceSnapshot snapshot = convert_json_data(json_task.get());
+                feed->publish(venue_id, { snapshot.timestamp, std::move(snapshot.prices) });
+            }
+            catch (std::exception& exc) {
+                print(venue, " can't connect right now: ", exc.what(), "\n");
+            }
+            in_flight.store(false);
+        });
+}
+
+void BinanceApiConn::stop_pipeline() {
+    shutdown_source.cancel();
+    if (pipeline) {
+        pipeline->stop();
+    }
+}
+
+RingStats BinanceApiConn::get_pipeline_stats() const {
+    return pipeline ? pipeline->get_stats() : RingStats();
 }
 
-void BinanceApiConn::save_json_data(const JSON_value& data) {
+pplx::task<http_response> BinanceApiConn::request_with_deadline(
+    const std::string& address, ms deadline, RequestKind kind
+) {
+    auto state = std::make_shared<HedgedRequestState>();
+    time_var started = high_clock::now();
+    launch_attempt(state, address, deadline, kind, started);
+    executor->spawn(watch_request_async(state, address, deadline, kind, started));
+    return pplx::create_task(state->result);
+}
+
+void BinanceApiConn::launch_attempt(
+    const std::shared_ptr<HedgedRequestState>& state,
+    const std::string& address, ms deadline, RequestKind kind, time_var started
+) {
+    auto source = pplx::cancellation_token_source::create_linked_source(shutdown_source.get_token());
+    size_t attempt_index = 0;
+    {
+        std::lock_guard<std::mutex> guard(state->mutex);
+        if (state->done || state->launched >= max_attempts) {
+            return;
+        }
+        attempt_index = state->attempts.size();
+        state->attempts.push_back(source);
+        ++state->launched;
+    }
+    if (is_primary()) {
+        scheduler->record_request(kind);
+    }
+    http_client_config config;
+    config.set_timeout(deadline);
+    http_client client(utility::conversions::to_string_t(url), config);
+    client.request(methods::GET, utility::conversions::to_string_t(address), source.get_token())
+        .then([this, state, attempt_index, address, deadline, kind, started](pplx::task<http_response> attempt) {
+            bool has_failed = false;
+            {
+                std::lock_guard<std::mutex> guard(state->mutex);
+                try {
+                    http_response response = attempt.get();
+                    if (!state->done) {
+                        state->done = true;
+                        latencies.record(std::chrono::duration_cast<ms>(high_clock::now() - started));
+                        // the other attempt is not needed anymore
+                        for (size_t i = 0; i < state->attempts.size(); ++i) {
+                            if (i != attempt_index) {
+                                state->attempts[i].cancel();
+                            }
+                        }
+                        state->result.set(response);
+                    }
+                }
+                catch (pplx::task_canceled&) {
+                    ++state->failed;
+                    state->last_error = "cancelled";
+                }
+                catch (std::exception& exc) {
+                    ++state->failed;
+                    state->last_error = exc.what();
+                }
+                has_failed = !state->done && state->failed == state->launched;
+            }
+            if (!has_failed) {
+                return;
+            }
+            // hedge right after an early failure, the request has failed if nothing is left to send
+            launch_attempt(state, address, deadline, kind, started);
+            bool is_exhausted = false;
+            {
+                std::lock_guard<std::mutex> guard(state->mutex);
+                is_exhausted = state->failed == state->launched;
+            }
+            if (is_exhausted) {
+                expire_request(state);
+            }
+        });
+}
+
+void BinanceApiConn::expire_request(const std::shared_ptr<HedgedRequestState>& state) {
+    std::lock_guard<std::mutex> guard(state->mutex);
+    if (state->done) {
+        return;
+    }
+    state->done = true;
+    bool has_failed = state->failed == state->launched;
+    for (auto&& source : state->attempts) {
+        source.cancel();
+    }
+    state->result.set_exception(std::runtime_error(
+        has_failed ? "request failed (" + state->last_error + ")" : "request deadline exceeded"
+    ));
+}
+
+ms BinanceApiConn::get_hedge_delay(ms deadline) const {
+    return std::clamp(
+        latencies.get_percentile(0.95, default_hedge_delay), min_hedge_delay, deadline / 2
+    );
+}
+
+Task<void> BinanceApiConn::watch_request_async(
+    std::shared_ptr<HedgedRequestState> state,
+    std::string address, ms deadline, RequestKind kind, time_var started
+) {
+    co_await executor->sleep_for(started + get_hedge_delay(deadline) - high_clock::now());
+    // a settled request or used up attempts send nothing, nor does a shutdown
+    if (!executor->is_stopping()) {
+        launch_attempt(state, address, deadline, kind, started);
+    }
+    // the shutdown expires the request right away
+    co_await executor->sleep_for(started + deadline - high_clock::now());
+    expire_request(state);
+}
+
+std::optional<PriceSnapshot> BinanceApiConn::parse_response(RawResponse& raw) {
+    try {
+        auto&& json = JSON_value::parse(utility::conversions::to_string_t(raw.body));
+        PriceSnapshot snapshot = convert_json_data(json);
+        snapshot.add_to_ds = raw.add_to_ds;
+        snapshot.requested = raw.requested;
+        return snapshot;
+    }
+    catch (std::exception& exc) {
+        print("Malformed response: ", exc.what(), "\n");
+        return std::nullopt;
+    }
+}
+
+void BinanceApiConn::analyze_snapshot(PriceSnapshot& snapshot) {
+    uint64_t allocations = thread_heap_allocations;
+    save_snapshot(snapshot);
+    finish_tick(snapshot.add_to_ds, allocations);
+#ifdef DEBUG
+    auto&& latency = std::chrono::duration_cast<ms>(high_clock::now() - snapshot.requested);
+    print("Tick latency (request to decision): ", latency.count(), " ms\n");
+#endif // !DEBUG
+}
+
+void BinanceApiConn::finish_tick(bool add_to_ds, uint64_t allocations) {
+    // the tick boundary - the state has no other writer
+    commands->drain();
+    get_due_tokens(add_to_ds, due_tokens);
+    analyzer->get_analysis(crypto_actions, due_tokens, add_to_ds);
+    publish_market_view();
+    // the shards count their own allocations
+    tick_allocations.add_tick(thread_heap_allocations - allocations + analyzer->get_allocation_stats().last_tick_shards);
+}
+
+PriceSnapshot BinanceApiConn::convert_json_data(const JSON_value& data) {
+    PriceSnapshot snapshot;
+    snapshot.timestamp = get_unix_time_ms();
     auto&& json_arr = data.as_array();
-    for (auto it = json_arr.begin(); it != json_arr.end(); ++it) {
+    snapshot.prices.reserve(json_arr.size());
+    size_t malformed = 0;
+    size_t position = 0;
+    for (auto it = json_arr.begin(); it != json_arr.end(); ++it, ++position) {
         auto&& object = it->as_object();
         const std::string& symbol = api_specific_object_conversion(object, "symbol");
         const std::string& price = api_specific_object_conversion(object, "price");
-        double converted_price = convert_string_to<double>(price);
-        cryptocurrency_pairs[symbol] = converted_price;
-        if (crypto_actions.find(symbol) != crypto_actions.end()) {
-            crypto_actions[symbol]->set_value(converted_price);
+        double value = 0;
+        if (!parse_number(price, value)) {
+            // one malformed quote shall not discard the whole tick
+            ++malformed;
+            continue;
+        }
+        snapshot.prices.emplace_back(ticker_layout.resolve(position, symbol, *symbols), value);
+    }
+    [[maybe_unused]] size_t relearned = ticker_layout.finish(position);
+    if (malformed > 0) {
+        print(venue, ": skipped ", malformed, " malformed prices\n");
+    }
+#ifdef DEBUG
+    if (relearned > 0) {
+        print(venue, ": ticker layout relearned at ", relearned, " positions\n");
+    }
+#endif // !DEBUG
+    return snapshot;
+}
+
+void BinanceApiConn::save_snapshot(const PriceSnapshot& snapshot) {
+    if (feed->get_venue_count() == 1) {
+        // the only venue - nothing to merge
+        for (auto&& [symbol, price] : snapshot.prices) {
+            cryptocurrency_pairs[symbol] = price;
+            size_t position = crypto_actions.find(symbol);
+            if (position != TokenTable::npos) {
+                crypto_actions.set_quote(position, price, snapshot.timestamp, venue);
+            }
+        }
+    }
+    else {
+        for (auto&& [symbol, price] : snapshot.prices) {
+            cryptocurrency_pairs[symbol] = price;
+        }
+        feed->publish(venue_id, { snapshot.timestamp, snapshot.prices });
+        feed->merge();
+        // only the symbols whose best quote has moved
+        for (SymbolId symbol : feed->get_changed()) {
+            size_t position = crypto_actions.find(symbol);
+            if (position != TokenTable::npos) {
+                set_best_quote(position, symbol, snapshot.timestamp);
+            }
         }
     }
+    // tick history of the watchlist - the quotes this tick has updated
+    price_history->append_tick(snapshot.timestamp, crypto_actions.get_symbols(),
+        crypto_actions.get_values(), crypto_actions.get_updates());
 }
 #endif // !BINANCE_DEFINITIONS
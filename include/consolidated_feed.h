@@ -0,0 +1,267 @@
+#pragma once
+#include <deque>
+#include <queue>
+#include <mutex>
+#include <limits>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+
+#include "utilities.h"
+#include "symbol_table.h"
+
+/**
+ * @brief Prices of one venue as received at the given time
+ * - once published, only the prices which changed since the previous update
+ * of the venue are kept (an update without prices still keeps the venue fresh)
+ */
+struct VenueUpdate {
+	int64_t timestamp = 0; // Unix time in ms
+	std::vector<std::pair<SymbolId, double>> prices;
+};
+
+/**
+ * @brief The best fresh prices of a symbol across the venues
+ * - buy: the lowest price, the venue where buying is the cheapest
+ * - sell: the highest price, the venue where selling pays the most
+ */
+struct BestQuote {
+	double buy = 0;
+	size_t buy_venue = 0;
+	double sell = 0;
+	size_t sell_venue = 0;
+
+	bool operator==(const BestQuote&) const = default;
+};
+
+/**
+ * @brief Consolidated market state of several exchange venues
+ * - venues publish their updates independently (each from its own request),
+ * therefore a slow venue never delays the others
+ * - pending updates are k-way merged by their timestamps
+ * and applied in order to one normalized market state
+ * - the work is proportional to the changed prices: a venue drops its unchanged
+ * prices while publishing (on its own thread) and the best quotes are kept
+ * per symbol, recomputed only when a price of the symbol changes
+ * (or when a venue goes stale or fresh again)
+ */
+class ConsolidatedFeed {
+public:
+	ConsolidatedFeed() { }
+	ConsolidatedFeed(const ConsolidatedFeed&) = delete;
+	ConsolidatedFeed& operator=(const ConsolidatedFeed&) = delete;
+
+	/**
+	 * @returns id of the newly registered venue
+	 */
+	size_t add_venue(const std::string& name);
+
+	/**
+	 * @brief Queues an update of a venue (thread safe)
+	 * - a venue publishes from one thread at a time, all venues are added beforehand
+	 */
+	void publish(size_t venue, VenueUpdate update);
+
+	/**
+	 * @brief Applies all pending updates in timestamp order
+	 * @returns number of applied updates
+	 */
+	size_t merge();
+
+	/**
+	 * @returns symbols whose best quote has changed by the latest merge
+	 */
+	const std::vector<SymbolId>& get_changed() const { return changed; }
+
+	/**
+	 * @returns the best prices of the symbol among venues
+	 * whose latest update is not older than max_age
+	 */
+	std::optional<BestQuote> get_best(SymbolId symbol) const;
+
+	const std::string& get_venue_name(size_t venue) const;
+	size_t get_venue_count() const;
+
+private:
+	struct SymbolQuotes {
+		std::vector<double> prices; // by venue, 0 - not quoted
+		std::optional<BestQuote> best;
+		bool is_dirty = false;
+	};
+
+	void apply(size_t venue, const VenueUpdate& update);
+	void mark_dirty(SymbolId symbol, SymbolQuotes& symbol_quotes);
+
+	/**
+	 * @brief Symbols of the venues which went stale or fresh again are marked dirty.
+	 */
+	void refresh_venues();
+	bool is_fresh(size_t venue) const;
+
+	/**
+	 * @brief Venues whose latest update is older than this are not considered for the best prices.
+	 */
+	const int64_t max_age = 60000;
+
+	std::vector<std::string> venue_names;
+	std::vector<std::deque<VenueUpdate>> pending;
+	mutable std::mutex pending_mutex;
+	std::vector<SymbolMap<double>> published; // latest prices of each venue (touched by its publisher only)
+	SymbolMap<SymbolQuotes> quotes;
+	std::vector<int64_t> venue_timestamps;
+	std::vector<char> venue_fresh;
+	std::vector<SymbolId> dirty; // prices changed, the best quote is to be recomputed
+	std::vector<SymbolId> changed;
+	int64_t latest_timestamp = 0;
+};
+
+#ifndef CONSOLIDATED_FEED_DEFINITIONS
+
+size_t ConsolidatedFeed::add_venue(const std::string& name) {
+	std::lock_guard<std::mutex> guard(pending_mutex);
+	venue_names.push_back(name);
+	pending.emplace_back();
+	published.emplace_back();
+	venue_timestamps.push_back(0);
+	venue_fresh.push_back(false);
+	return venue_names.size() - 1;
+}
+
+const std::string& ConsolidatedFeed::get_venue_name(size_t venue) const {
+	return venue_names.at(venue);
+}
+
+size_t ConsolidatedFeed::get_venue_count() const {
+	return venue_names.size();
+}
+
+void ConsolidatedFeed::publish(size_t venue, VenueUpdate update) {
+	// most prices do not move between two updates - they are dropped here
+	// rather than compared on the merging thread
+	auto&& latest = published.at(venue);
+	auto&& prices = update.prices;
+	size_t kept = 0;
+	for (auto&& [symbol, price] : prices) {
+		double* previous = latest.find(symbol);
+		if (previous == nullptr || *previous != price) {
+			latest[symbol] = price;
+			prices[kept++] = { symbol, price };
+		}
+	}
+	prices.resize(kept);
+	std::lock_guard<std::mutex> guard(pending_mutex);
+	pending[venue].push_back(std::move(update));
+}
+
+size_t ConsolidatedFeed::merge() {
+	std::vector<std::deque<VenueUpdate>> batches;
+	{
+		std::lock_guard<std::mutex> guard(pending_mutex);
+		batches.resize(pending.size());
+		for (size_t venue = 0; venue < pending.size(); ++venue) {
+			batches[venue].swap(pending[venue]);
+		}
+	}
+	// k-way merge - each venue's updates are already in order,
+	// the heap keeps the head of each venue (timestamp, venue)
+	using head = std::pair<int64_t, size_t>;
+	std::priority_queue<head, std::vector<head>, std::greater<head>> heads;
+	for (size_t venue = 0; venue < batches.size(); ++venue) {
+		if (!batches[venue].empty()) {
+			heads.emplace(batches[venue].front().timestamp, venue);
+		}
+	}
+	changed.clear();
+	size_t applied = 0;
+	while (!heads.empty()) {
+		size_t venue = heads.top().second;
+		heads.pop();
+		apply(venue, batches[venue].front());
+		batches[venue].pop_front();
+		++applied;
+		if (!batches[venue].empty()) {
+			heads.emplace(batches[venue].front().timestamp, venue);
+		}
+	}
+	refresh_venues();
+	for (SymbolId symbol : dirty) {
+		SymbolQuotes& symbol_quotes = quotes.at(symbol);
+		symbol_quotes.is_dirty = false;
+		std::optional<BestQuote> best;
+		for (size_t venue = 0; venue < symbol_quotes.prices.size(); ++venue) {
+			double price = symbol_quotes.prices[venue];
+			if (price == 0 || !venue_fresh[venue]) {
+				continue;
+			}
+			if (!best) {
+				best = BestQuote{ price, venue, price, venue };
+				continue;
+			}
+			if (price < best->buy) {
+				best->buy = price;
+				best->buy_venue = venue;
+			}
+			if (price > best->sell) {
+				best->sell = price;
+				best->sell_venue = venue;
+			}
+		}
+		if (best != symbol_quotes.best) {
+			symbol_quotes.best = best;
+			changed.push_back(symbol);
+		}
+	}
+	dirty.clear();
+	return applied;
+}
+
+void ConsolidatedFeed::apply(size_t venue, const VenueUpdate& update) {
+	for (auto&& [symbol, price] : update.prices) {
+		SymbolQuotes& symbol_quotes = quotes[symbol];
+		if (symbol_quotes.prices.size() < venue_names.size()) {
+			symbol_quotes.prices.resize(venue_names.size(), 0);
+		}
+		symbol_quotes.prices[venue] = price;
+		mark_dirty(symbol, symbol_quotes);
+	}
+	venue_timestamps[venue] = std::max(venue_timestamps[venue], update.timestamp);
+	latest_timestamp = std::max(latest_timestamp, update.timestamp);
+}
+
+void ConsolidatedFeed::mark_dirty(SymbolId symbol, SymbolQuotes& symbol_quotes) {
+	if (!symbol_quotes.is_dirty) {
+		symbol_quotes.is_dirty = true;
+		dirty.push_back(symbol);
+	}
+}
+
+bool ConsolidatedFeed::is_fresh(size_t venue) const {
+	return venue_timestamps[venue] > 0 && latest_timestamp - venue_timestamps[venue] <= max_age;
+}
+
+void ConsolidatedFeed::refresh_venues() {
+	for (size_t venue = 0; venue < venue_names.size(); ++venue) {
+		bool fresh = is_fresh(venue);
+		if (fresh == (bool)venue_fresh[venue]) {
+			continue;
+		}
+		// rare - a venue has stopped (or resumed) answering, all its quotes count differently now
+		venue_fresh[venue] = fresh;
+		for (auto&& [symbol, symbol_quotes] : quotes) {
+			if (venue < symbol_quotes.prices.size() && symbol_quotes.prices[venue] != 0) {
+				mark_dirty(symbol, symbol_quotes);
+			}
+		}
+	}
+}
+
+std::optional<BestQuote> ConsolidatedFeed::get_best(SymbolId symbol) const {
+	const SymbolQuotes* found = quotes.find(symbol);
+	if (found == nullptr) {
+		return std::nullopt;
+	}
+	return found->best;
+}
+
+#endif // !CONSOLIDATED_FEED_DEFINITIONS
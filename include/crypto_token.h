@@ -1,39 +1,205 @@
 #pragma once
+#include <limits>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+
+#include "symbol_table.h"
 
 enum class Action { DEFAULT, BUY, SELL, HOLD };
 
 /**
- * @brief used as a data class to hold information
- * about a particular cryptocurrency
+ * @brief Prices of a watched symbol (USD)
+ * - value: the reference price of the indicators (the mid price of the venues)
+ * - buy, sell: the prices a trade is made at (the same as value with a single venue)
+ */
+struct TokenQuote {
+	double value = 0;
+	double buy = 0;
+	double sell = 0;
+};
+
+/**
+ * @brief State of the watched cryptocurrencies (structure of arrays)
+ * - every field is a column of its own, a position holds one symbol in all of them,
+ * scanning the watchlist reads the needed columns only (i.e. the values)
+ * - the symbol id is the stable handle, its position is resolved by array indexing
+ * - erasing moves the last symbol to the freed position (as in SymbolMap),
+ * positions are therefore valid until the next erase
+ * - with several venues a symbol is bought at the cheapest one and sold at the one
+ * paying the most, the indicators see the mid price of the two
  */
-class CryptoToken {
+class TokenTable {
 public:
-	void set_state(const Action& action);
-	void set_value(double v);
-	Action get_state() const;
-	double get_value() const;
+	static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+	/**
+	 * @brief Adds the symbol to the watchlist (a watched symbol is left untouched)
+	 * @returns position of the symbol
+	 */
+	size_t insert(SymbolId id, double value);
+
+	/**
+	 * @returns false if the symbol is not watched
+	 */
+	bool erase(SymbolId id);
+
+	/**
+	 * @returns position of the symbol, npos if it is not watched
+	 */
+	size_t find(SymbolId id) const;
+	bool contains(SymbolId id) const;
+
+	size_t size() const { return symbols.size(); }
+	bool empty() const { return symbols.empty(); }
+
+	// columns - indexed by positions
+	const std::vector<SymbolId>& get_symbols() const { return symbols; }
+	const std::vector<double>& get_values() const { return values; }
+	const std::vector<double>& get_buy_values() const { return buy_values; }
+	const std::vector<double>& get_sell_values() const { return sell_values; }
+	const std::vector<Action>& get_states() const { return states; }
+	const std::vector<int64_t>& get_updates() const { return updates; }
+	const std::vector<std::string>& get_sources() const { return sources; }
+	const std::vector<std::string>& get_sell_sources() const { return sell_sources; }
+
+	/**
+	 * @throws std::out_of_range if the symbol is not watched
+	 */
+	double get_value(SymbolId id) const;
+	TokenQuote get_quote(SymbolId id) const;
+
+	/**
+	 * @brief Latest quote of the symbol at a position (a single venue)
+	 * @param timestamp - Unix time in ms
+	 * @param source - venue which quoted the value
+	 */
+	void set_quote(size_t position, double value, int64_t timestamp, const std::string& source);
+
+	/**
+	 * @brief Latest quote of the symbol at a position (the best one of several venues)
+	 * @param buy_source - venue of the lowest price
+	 * @param sell_source - venue of the highest price
+	 */
+	void set_quote(size_t position, double buy, double sell, int64_t timestamp,
+		const std::string& buy_source, const std::string& sell_source);
+	void set_state(size_t position, Action action);
+
 private:
-	template<typename T, typename ...Args>
-	friend std::shared_ptr<T> create_shared(Args&& ...args);
+	/**
+	 * @throws std::out_of_range if the symbol is not watched
+	 */
+	size_t at(SymbolId id) const;
 
-	CryptoToken()
-		: state(Action::DEFAULT), value(0) {}
-	Action state;
-	double value;
+	std::vector<SymbolId> symbols;
+	std::vector<double> values; // USD, mid price of buy and sell
+	std::vector<double> buy_values; // USD
+	std::vector<double> sell_values; // USD
+	std::vector<Action> states;
+	std::vector<int64_t> updates; // Unix time in ms of the latest quote
+	std::vector<std::string> sources; // venue which quoted the buy value (empty for the only one)
+	std::vector<std::string> sell_sources; // venue which quoted the sell value
+	std::vector<size_t> positions; // indexed by SymbolId
 };
 
-double CryptoToken::get_value() const {
-	return value;
+#ifndef TOKEN_TABLE_DEFINITIONS
+
+size_t TokenTable::insert(SymbolId id, double value) {
+	if (contains(id)) {
+		return positions[id];
+	}
+	if (id >= positions.size()) {
+		positions.resize((size_t)id + 1, npos);
+	}
+	positions[id] = symbols.size();
+	symbols.push_back(id);
+	values.push_back(value);
+	buy_values.push_back(value);
+	sell_values.push_back(value);
+	states.push_back(Action::DEFAULT);
+	updates.push_back(0);
+	sources.emplace_back();
+	sell_sources.emplace_back();
+	return positions[id];
+}
+
+bool TokenTable::erase(SymbolId id) {
+	if (!contains(id)) {
+		return false;
+	}
+	size_t position = positions[id];
+	size_t last = symbols.size() - 1;
+	if (position != last) {
+		symbols[position] = symbols[last];
+		values[position] = values[last];
+		buy_values[position] = buy_values[last];
+		sell_values[position] = sell_values[last];
+		states[position] = states[last];
+		updates[position] = updates[last];
+		sources[position] = std::move(sources[last]);
+		sell_sources[position] = std::move(sell_sources[last]);
+		positions[symbols[position]] = position;
+	}
+	symbols.pop_back();
+	values.pop_back();
+	buy_values.pop_back();
+	sell_values.pop_back();
+	states.pop_back();
+	updates.pop_back();
+	sources.pop_back();
+	sell_sources.pop_back();
+	positions[id] = npos;
+	return true;
+}
+
+size_t TokenTable::find(SymbolId id) const {
+	return id < positions.size() ? positions[id] : npos;
+}
+
+bool TokenTable::contains(SymbolId id) const {
+	return find(id) != npos;
+}
+
+size_t TokenTable::at(SymbolId id) const {
+	size_t position = find(id);
+	if (position == npos) {
+		throw std::out_of_range("Unwatched symbol id: " + std::to_string(id));
+	}
+	return position;
+}
+
+double TokenTable::get_value(SymbolId id) const {
+	return values[at(id)];
+}
+
+TokenQuote TokenTable::get_quote(SymbolId id) const {
+	size_t position = at(id);
+	return { values[position], buy_values[position], sell_values[position] };
+}
+
+void TokenTable::set_quote(size_t position, double value, int64_t timestamp, const std::string& source) {
+	set_quote(position, value, value, timestamp, source, source);
 }
 
-Action CryptoToken::get_state() const {
-	return state;
+void TokenTable::set_quote(size_t position, double buy, double sell, int64_t timestamp,
+	const std::string& buy_source, const std::string& sell_source
+) {
+	values[position] = (buy + sell) / 2;
+	buy_values[position] = buy;
+	sell_values[position] = sell;
+	updates[position] = timestamp;
+	// the same venue quotes most of the ticks - nothing to copy then
+	if (sources[position] != buy_source) {
+		sources[position] = buy_source;
+	}
+	if (sell_sources[position] != sell_source) {
+		sell_sources[position] = sell_source;
+	}
 }
 
-void CryptoToken::set_state(const Action& act) {
-	state = act;
+void TokenTable::set_state(size_t position, Action action) {
+	states[position] = action;
 }
 
-void CryptoToken::set_value(double val) {
-	value = val;
-}
\ No newline at end of file
+#endif // !TOKEN_TABLE_DEFINITIONS
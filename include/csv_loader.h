@@ -0,0 +1,168 @@
+#pragma once
+#include <deque>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <optional>
+#include <string_view>
+
+#ifdef _WIN32
+	// no mapping on Windows - the file is read into memory at once
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+#include "utilities.h"
+
+/**
+ * @brief Read-only view of a whole file
+ * - memory mapped (POSIX), the content is read by the kernel on demand
+ * and the parser tokenizes it in place without copying lines
+ * - read into a buffer at once on Windows
+ */
+class MappedFile {
+public:
+	MappedFile(const std::string& path);
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	/**
+	 * @returns whether the file could be opened (an empty file is fine)
+	 */
+	bool is_open() const;
+
+	std::string_view get_data() const;
+
+private:
+	bool opened;
+	const char* data;
+	size_t size;
+#ifdef _WIN32
+	std::string buffer;
+#endif
+};
+
+#ifndef MAPPED_FILE_DEFINITIONS
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path)
+	: opened(false), data(nullptr), size(0) {
+	std::ifstream reader(path, std::ios::binary);
+	if (reader) {
+		std::ostringstream content;
+		content << reader.rdbuf();
+		buffer = content.str();
+		data = buffer.data();
+		size = buffer.size();
+		opened = true;
+	}
+}
+
+MappedFile::~MappedFile() { }
+
+#else
+
+MappedFile::MappedFile(const std::string& path)
+	: opened(false), data(nullptr), size(0) {
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return;
+	}
+	struct stat info {};
+	if (::fstat(fd, &info) == 0) {
+		opened = true;
+		size = (size_t)info.st_size;
+		if (size > 0) {
+			void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapped == MAP_FAILED) {
+				opened = false;
+				size = 0;
+			}
+			else {
+				// the file is read once from the beginning to the end
+				::madvise(mapped, size, MADV_SEQUENTIAL);
+				data = static_cast<const char*>(mapped);
+			}
+		}
+	}
+	// the mapping stays valid without the descriptor
+	::close(fd);
+}
+
+MappedFile::~MappedFile() {
+	if (data != nullptr) {
+		::munmap(const_cast<char*>(data), size);
+	}
+}
+
+#endif // !_WIN32
+
+bool MappedFile::is_open() const {
+	return opened;
+}
+
+std::string_view MappedFile::get_data() const {
+	return std::string_view(data, size);
+}
+
+#endif // !MAPPED_FILE_DEFINITIONS
+
+#ifndef CSV_LOADING
+
+/**
+ * @brief Parses rows of numbers from a csv file (the header is skipped)
+ * - reading stops at the first empty line, a row ends at its first empty cell
+ * (first few records are incomplete)
+ * @param path - csv file
+ * @param delimiter - cell delimiter
+ * @returns rows of the file or nothing if the file can't be opened
+ */
+std::optional<std::deque<std::deque<double>>> load_csv_rows(const std::string& path, char delimiter) {
+	MappedFile file(path);
+	if (!file.is_open()) {
+		return std::nullopt;
+	}
+	std::deque<std::deque<double>> rows;
+	std::string_view rest = file.get_data();
+	bool is_header = true;
+	while (!rest.empty()) {
+		size_t line_end = rest.find('\n');
+		std::string_view line = rest.substr(0, line_end);
+		rest = line_end == std::string_view::npos ? std::string_view() : rest.substr(line_end + 1);
+		if (!line.empty() && line.back() == '\r') {
+			line.remove_suffix(1);
+		}
+		if (is_header) {
+			is_header = false;
+			continue;
+		}
+		if (line.empty()) {
+			break;
+		}
+		std::deque<double> row;
+		while (!line.empty()) {
+			size_t delimiter_pos = line.find(delimiter);
+			std::string_view part = line.substr(0, delimiter_pos);
+			line = delimiter_pos == std::string_view::npos
+				? std::string_view() : line.substr(delimiter_pos + 1);
+			double val = 0;
+			if (part.empty()) {
+				break;
+			}
+			if (!parse_number(part, val)) {
+				print("Malformed value '", part, "' in ", path, "\n");
+				break;
+			}
+			row.push_back(val);
+		}
+		rows.push_back(std::move(row));
+	}
+	return rows;
+}
+
+#endif // !CSV_LOADING
@@ -44,7 +44,8 @@ void DataHandler::download_initial_values_py(const std::vector<std::string>& cry
 void DataHandler::download_initial_values(const std::vector<std::string>& user_input) {
 	std::vector<std::string> relevant_pairs;
 	for (auto&& crypto_pair : user_input) {
-		if (cryptocurrency_pairs.find(crypto_pair) != cryptocurrency_pairs.end()) {
+		auto&& id = symbols->find(crypto_pair);
+		if (id && cryptocurrency_pairs.contains(*id)) {
 			relevant_pairs.push_back(crypto_pair);
 		}
 	}
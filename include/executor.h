@@ -0,0 +1,394 @@
+#pragma once
+#include <queue>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <optional>
+#include <coroutine>
+#include <stdexcept>
+#include <exception>
+#include <type_traits>
+#include <condition_variable>
+
+#include "thread_tuning.h"
+
+/**
+ * @brief Result and continuation of a coroutine task.
+ */
+struct TaskPromiseBase {
+	std::coroutine_handle<> continuation = std::noop_coroutine();
+	std::exception_ptr exception;
+
+	/**
+	 * @brief Resumes the awaiting coroutine (symmetric transfer, no stack growth).
+	 */
+	struct FinalAwaiter {
+		bool await_ready() noexcept { return false; }
+		template <typename Promise>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+			return handle.promise().continuation;
+		}
+		void await_resume() noexcept { }
+	};
+
+	std::suspend_always initial_suspend() noexcept { return {}; }
+	FinalAwaiter final_suspend() noexcept { return {}; }
+	void unhandled_exception() { exception = std::current_exception(); }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+	std::optional<T> value;
+	void return_value(T in_value) { value = std::move(in_value); }
+	T get() {
+		if (exception) {
+			std::rethrow_exception(exception);
+		}
+		return std::move(*value);
+	}
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+	void return_void() { }
+	void get() {
+		if (exception) {
+			std::rethrow_exception(exception);
+		}
+	}
+};
+
+/**
+ * @brief Lazily started coroutine - it runs once it is awaited
+ * (or handed over to Executor::run_sync) and resumes the awaiting one when done
+ * @tparam T - result (exceptions are rethrown to the awaiting coroutine)
+ */
+template <typename T = void>
+class Task {
+public:
+	struct promise_type : TaskPromise<T> {
+		Task get_return_object() {
+			return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+	};
+
+	Task(Task&& other) noexcept : coroutine(std::exchange(other.coroutine, {})) { }
+	Task(const Task&) = delete;
+	Task& operator=(const Task&) = delete;
+	~Task() {
+		if (coroutine) {
+			coroutine.destroy();
+		}
+	}
+
+	bool await_ready() const noexcept { return false; }
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+		coroutine.promise().continuation = awaiting;
+		return coroutine;
+	}
+	T await_resume() { return coroutine.promise().get(); }
+
+private:
+	explicit Task(std::coroutine_handle<promise_type> in_coroutine) : coroutine(in_coroutine) { }
+
+	std::coroutine_handle<promise_type> coroutine;
+};
+
+/**
+ * @brief Small thread pool which runs coroutines
+ * - used for the network I/O (kline downloads, hedge and deadline timers of the requests),
+ * the tick pipeline, the journal writers and the console keep their own threads
+ * (pinned, a tick never waits behind a download or an fsync)
+ * - a coroutine waiting for a timer or an asynchronous operation
+ * does not hold a thread, many of them share the few workers
+ * - timers are kept in a heap, the workers sleep until the earliest one
+ * - stop() finishes the spawned tasks before the workers leave: their timers fire
+ * right away (is_stopping() tells them to cut short) and the asynchronous operations
+ * they wait for are waited for, nothing resumes a coroutine on a destroyed executor
+ */
+class Executor {
+public:
+	using steady_clock = std::chrono::steady_clock;
+
+	Executor(size_t thread_count = 2);
+	Executor(const Executor&) = delete;
+	Executor& operator=(const Executor&) = delete;
+	~Executor();
+
+	/**
+	 * @brief Waits for the spawned tasks and stops the workers (idempotent)
+	 * - must not be called from a worker
+	 * - tasks spawned afterwards are dropped
+	 */
+	void stop();
+
+	/**
+	 * @returns whether the executor is being stopped (a task shall cut its work short)
+	 */
+	bool is_stopping() const { return stopping.load(std::memory_order_acquire); }
+
+	/**
+	 * @brief Resumes the coroutine on one of the workers.
+	 */
+	void post(std::coroutine_handle<> handle);
+
+	/**
+	 * @brief Resumes the coroutine on one of the workers at the given time.
+	 */
+	void post_at(steady_clock::time_point time, std::coroutine_handle<> handle);
+
+	/**
+	 * @brief co_await schedule() - continues on a worker.
+	 */
+	auto schedule() {
+		struct Awaiter {
+			Executor& executor;
+			bool await_ready() const noexcept { return false; }
+			void await_suspend(std::coroutine_handle<> handle) { executor.post(handle); }
+			void await_resume() const noexcept { }
+		};
+		return Awaiter{ *this };
+	}
+
+	/**
+	 * @brief co_await sleep_for(duration) - continues on a worker after the duration
+	 * (without suspension if it is not positive or the executor is being stopped).
+	 */
+	template <typename Duration>
+	auto sleep_for(const Duration& duration) {
+		struct Awaiter {
+			Executor& executor;
+			steady_clock::time_point time;
+			bool await_ready() const noexcept { return time <= steady_clock::now() || executor.is_stopping(); }
+			void await_suspend(std::coroutine_handle<> handle) { executor.post_at(time, handle); }
+			void await_resume() const noexcept { }
+		};
+		return Awaiter{ *this, steady_clock::now() + std::chrono::duration_cast<steady_clock::duration>(duration) };
+	}
+
+	/**
+	 * @brief co_await completion_of(task) - continues on a worker once
+	 * an asynchronous task (i.e. pplx::task) is done, its result is returned
+	 * - the awaiting task keeps the executor running (see stop),
+	 * the callback therefore always finds it
+	 * @tparam Continuable - provides then(callback(Continuable)), is_done() and get()
+	 */
+	template <typename Continuable>
+	auto completion_of(Continuable task) {
+		struct Awaiter {
+			Executor& executor;
+			Continuable task;
+			bool await_ready() const { return task.is_done(); }
+			void await_suspend(std::coroutine_handle<> handle) {
+				Executor* target = &executor;
+				task.then([target, handle](Continuable) { target->post(handle); });
+			}
+			auto await_resume() { return task.get(); }
+		};
+		return Awaiter{ *this, std::move(task) };
+	}
+
+	/**
+	 * @brief Runs the task on the workers and blocks the caller until it is done
+	 * - a bridge for the synchronous callers
+	 */
+	template <typename T>
+	T run_sync(Task<T> task);
+
+	/**
+	 * @brief Runs the task on the workers without waiting for it
+	 * - the task handles its errors itself (an escaped exception is dropped)
+	 */
+	void spawn(Task<void> task);
+
+private:
+	/**
+	 * @brief Coroutine which starts right away and frees itself when done.
+	 */
+	struct Detached {
+		struct promise_type {
+			Detached get_return_object() { return {}; }
+			std::suspend_never initial_suspend() noexcept { return {}; }
+			std::suspend_never final_suspend() noexcept { return {}; }
+			void return_void() { }
+			void unhandled_exception() { std::terminate(); }
+		};
+	};
+
+	template <typename T>
+	Detached drive(Task<T> task, std::promise<T> done);
+	Detached drive(Task<void> task);
+
+	/**
+	 * @returns false if the executor has stopped (the task is not started)
+	 */
+	bool start_task();
+	void finish_task();
+
+	void run();
+
+	struct Timer {
+		steady_clock::time_point time;
+		std::coroutine_handle<> handle;
+		bool operator>(const Timer& other) const { return time > other.time; }
+	};
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable idle;
+	std::deque<std::coroutine_handle<>> ready;
+	std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+	bool running;
+	std::atomic<bool> stopping;
+	size_t active; // tasks spawned or run and not finished yet
+	std::vector<std::thread> workers;
+};
+
+#ifndef EXECUTOR_DEFINITIONS
+
+Executor::Executor(size_t thread_count) : running(true), stopping(false), active(0) {
+	for (size_t i = 0; i < std::max<size_t>(thread_count, 1); ++i) {
+		workers.emplace_back(&Executor::run, this);
+	}
+}
+
+Executor::~Executor() {
+	stop();
+}
+
+void Executor::stop() {
+	std::unique_lock<std::mutex> lock(mutex);
+	if (!running) {
+		return;
+	}
+	stopping.store(true, std::memory_order_release);
+	// sleeping tasks are woken up right away
+	while (!timers.empty()) {
+		ready.push_back(timers.top().handle);
+		timers.pop();
+	}
+	wake.notify_all();
+	idle.wait(lock, [this] { return active == 0; });
+	running = false;
+	wake.notify_all();
+	lock.unlock();
+	for (auto&& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+}
+
+void Executor::post(std::coroutine_handle<> handle) {
+	// notified under the lock - a completion callback (a foreign thread)
+	// does not touch the executor once its task may have finished
+	std::lock_guard<std::mutex> guard(mutex);
+	ready.push_back(handle);
+	wake.notify_one();
+}
+
+void Executor::post_at(steady_clock::time_point time, std::coroutine_handle<> handle) {
+	std::lock_guard<std::mutex> guard(mutex);
+	if (stopping.load(std::memory_order_relaxed)) {
+		ready.push_back(handle);
+	}
+	else {
+		timers.push({ time, handle });
+	}
+	// the earliest timer may have changed
+	wake.notify_one();
+}
+
+bool Executor::start_task() {
+	std::lock_guard<std::mutex> guard(mutex);
+	if (!running) {
+		return false;
+	}
+	++active;
+	return true;
+}
+
+void Executor::finish_task() {
+	std::lock_guard<std::mutex> guard(mutex);
+	--active;
+	idle.notify_all();
+}
+
+void Executor::run() {
+	ThreadTuning tuning("executor", "executor");
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		steady_clock::time_point now = steady_clock::now();
+		while (!timers.empty() && timers.top().time <= now) {
+			ready.push_back(timers.top().handle);
+			timers.pop();
+		}
+		if (!ready.empty()) {
+			std::coroutine_handle<> handle = ready.front();
+			ready.pop_front();
+			lock.unlock();
+			handle.resume();
+			lock.lock();
+			continue;
+		}
+		if (!running) {
+			break;
+		}
+		if (timers.empty()) {
+			wake.wait(lock);
+		}
+		else {
+			wake.wait_until(lock, timers.top().time);
+		}
+	}
+}
+
+template <typename T>
+Executor::Detached Executor::drive(Task<T> task, std::promise<T> done) {
+	co_await schedule();
+	try {
+		if constexpr (std::is_void_v<T>) {
+			co_await task;
+			done.set_value();
+		}
+		else {
+			done.set_value(co_await task);
+		}
+	}
+	catch (...) {
+		done.set_exception(std::current_exception());
+	}
+	finish_task();
+}
+
+Executor::Detached Executor::drive(Task<void> task) {
+	co_await schedule();
+	try {
+		co_await task;
+	}
+	catch (...) { }
+	finish_task();
+}
+
+void Executor::spawn(Task<void> task) {
+	if (start_task()) {
+		drive(std::move(task));
+	}
+}
+
+template <typename T>
+T Executor::run_sync(Task<T> task) {
+	if (!start_task()) {
+		throw std::runtime_error("the executor has stopped");
+	}
+	std::promise<T> done;
+	std::future<T> result = done.get_future();
+	drive(std::move(task), std::move(done));
+	return result.get();
+}
+
+#endif // !EXECUTOR_DEFINITIONS
@@ -0,0 +1,290 @@
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <cerrno>
+#include <cstdlib>
+#include <condition_variable>
+
+#ifdef _WIN32
+	#include <io.h>
+	#include <cstdio>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#include "utilities.h"
+#include "thread_tuning.h"
+
+/**
+ * @brief When the journal is forced to the disk (fsync)
+ * - None: left to the operating system
+ * - Interval: at most once per interval (if anything has been written)
+ * - EveryN: after every N rows
+ */
+enum class FsyncPolicy { None, Interval, EveryN };
+
+struct JournalConfig {
+	FsyncPolicy policy = FsyncPolicy::Interval;
+	ms fsync_interval = ms(1000);
+	size_t fsync_every = 100;
+
+	/**
+	 * @brief Longest time a row waits in the queue
+	 * (a batch is written as soon as the writer is woken up).
+	 */
+	ms flush_interval = ms(100);
+};
+
+/**
+ * @brief Journal configuration of the environment
+ * - TTM_JOURNAL_FSYNC: none, interval=<ms> or every=<rows>
+ */
+JournalConfig get_journal_config() {
+	JournalConfig config;
+	const char* configured = std::getenv("TTM_JOURNAL_FSYNC");
+	if (configured == nullptr || *configured == '\0') {
+		return config;
+	}
+	std::string value = configured;
+	try {
+		if (value == "none") {
+			config.policy = FsyncPolicy::None;
+		}
+		else if (is_prefix("interval=", value)) {
+			config.policy = FsyncPolicy::Interval;
+			config.fsync_interval = ms(convert_string_to<long long>(value.substr(9)));
+		}
+		else if (is_prefix("every=", value)) {
+			config.policy = FsyncPolicy::EveryN;
+			config.fsync_every = std::max<size_t>(1, convert_string_to<size_t>(value.substr(6)));
+		}
+		else {
+			print("Unknown TTM_JOURNAL_FSYNC value '", value, "'\n");
+		}
+	}
+	catch (std::invalid_argument& exc) {
+		print("TTM_JOURNAL_FSYNC: ", exc.what(), "\n");
+	}
+	return config;
+}
+
+/**
+ * @brief Appends rows to a file on a background thread
+ * - append() only links the row into a lock-free queue,
+ * the caller never waits for the disk
+ * - the writer takes the whole queue at once and writes it
+ * with a single write call (batch), then syncs according to the policy
+ * - rows still queued are written upon destruction
+ */
+class JournalWriter {
+public:
+	/**
+	 * @param path - the file is opened for appending
+	 */
+	JournalWriter(const std::string& path, const JournalConfig& in_config = JournalConfig());
+	JournalWriter(const JournalWriter&) = delete;
+	JournalWriter& operator=(const JournalWriter&) = delete;
+	~JournalWriter();
+
+	/**
+	 * @brief Queues a row (thread safe, lock-free)
+	 */
+	void append(std::string row);
+
+	/**
+	 * @returns number of rows which have not been written yet
+	 */
+	size_t get_queue_depth() const;
+
+	/**
+	 * @brief Writes the queued rows and stops the writer.
+	 */
+	void stop();
+
+private:
+	struct Node {
+		std::string row;
+		Node* next;
+	};
+
+	void run();
+	void write_batch(Node* batch);
+	void sync();
+	bool write_all(const std::string& buffer);
+
+	JournalConfig config;
+	std::atomic<Node*> head;
+	std::atomic<size_t> depth;
+	std::atomic<bool> running;
+	size_t unsynced;
+	time_var last_sync;
+	std::mutex wake_mutex; // used by the writer only (producers do not lock)
+	std::condition_variable wake;
+	std::thread worker;
+#ifdef _WIN32
+	std::FILE* file;
+#else
+	int fd;
+#endif
+};
+
+#ifndef JOURNAL_WRITER_DEFINITIONS
+
+JournalWriter::JournalWriter(const std::string& path, const JournalConfig& in_config)
+	: config(in_config), head(nullptr), depth(0), running(true),
+	unsynced(0), last_sync(high_clock::now()) {
+#ifdef _WIN32
+	file = std::fopen(path.c_str(), "ab");
+	if (file == nullptr) {
+#else
+	fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+	if (fd < 0) {
+#endif
+		print("Can't open the journal ", path, "\n");
+	}
+	worker = std::thread(&JournalWriter::run, this);
+}
+
+JournalWriter::~JournalWriter() {
+	stop();
+	// rows appended after the writer has been stopped
+	Node* rest = head.exchange(nullptr, std::memory_order_acquire);
+	if (rest != nullptr) {
+		write_batch(rest);
+	}
+#ifdef _WIN32
+	if (file != nullptr) {
+		std::fclose(file);
+	}
+#else
+	if (fd >= 0) {
+		::close(fd);
+	}
+#endif
+}
+
+void JournalWriter::append(std::string row) {
+	Node* node = new Node{ std::move(row), head.load(std::memory_order_relaxed) };
+	while (!head.compare_exchange_weak(node->next, node,
+		std::memory_order_release, std::memory_order_relaxed)) { }
+	depth.fetch_add(1, std::memory_order_relaxed);
+	// a lost wakeup delays the batch by the flush interval at most
+	wake.notify_one();
+}
+
+size_t JournalWriter::get_queue_depth() const {
+	return depth.load(std::memory_order_relaxed);
+}
+
+void JournalWriter::stop() {
+	if (!running.exchange(false)) {
+		return;
+	}
+	wake.notify_one();
+	if (worker.joinable()) {
+		worker.join();
+	}
+}
+
+void JournalWriter::run() {
+	ThreadTuning tuning("journal", "journal");
+	while (true) {
+		bool is_running = running.load();
+		// the whole queue at once - no other consumer, therefore no ABA
+		Node* batch = head.exchange(nullptr, std::memory_order_acquire);
+		if (batch != nullptr) {
+			write_batch(batch);
+		}
+		bool is_interval_due = config.policy == FsyncPolicy::Interval && unsynced > 0
+			&& high_clock::now() - last_sync >= config.fsync_interval;
+		if (is_interval_due) {
+			sync();
+		}
+		if (!is_running && batch == nullptr) {
+			break;
+		}
+		if (batch == nullptr) {
+			std::unique_lock<std::mutex> lock(wake_mutex);
+			wake.wait_for(lock, config.flush_interval);
+		}
+	}
+	if (config.policy != FsyncPolicy::None && unsynced > 0) {
+		sync();
+	}
+}
+
+void JournalWriter::write_batch(Node* batch) {
+	// the queue is a stack - reverse it to keep the order of the rows
+	Node* ordered = nullptr;
+	size_t count = 0;
+	size_t length = 0;
+	while (batch != nullptr) {
+		Node* next = batch->next;
+		batch->next = ordered;
+		ordered = batch;
+		batch = next;
+		++count;
+		length += ordered->row.size();
+	}
+	std::string buffer;
+	buffer.reserve(length);
+	while (ordered != nullptr) {
+		buffer += ordered->row;
+		Node* next = ordered->next;
+		delete ordered;
+		ordered = next;
+	}
+	if (!write_all(buffer)) {
+		print("Can't write ", count, " journal rows\n");
+	}
+	depth.fetch_sub(count, std::memory_order_relaxed);
+	unsynced += count;
+	if (config.policy == FsyncPolicy::EveryN && unsynced >= config.fsync_every) {
+		sync();
+	}
+}
+
+bool JournalWriter::write_all(const std::string& buffer) {
+#ifdef _WIN32
+	if (file == nullptr) {
+		return false;
+	}
+	bool written = std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+	return std::fflush(file) == 0 && written;
+#else
+	if (fd < 0) {
+		return false;
+	}
+	size_t offset = 0;
+	while (offset < buffer.size()) { // a single call unless interrupted
+		ssize_t written = ::write(fd, buffer.data() + offset, buffer.size() - offset);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		offset += (size_t)written;
+	}
+	return true;
+#endif
+}
+
+void JournalWriter::sync() {
+#ifdef _WIN32
+	if (file != nullptr) {
+		_commit(_fileno(file));
+	}
+#else
+	if (fd >= 0) {
+		::fsync(fd);
+	}
+#endif
+	unsynced = 0;
+	last_sync = high_clock::now();
+}
+
+#endif // !JOURNAL_WRITER_DEFINITIONS
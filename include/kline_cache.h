@@ -0,0 +1,211 @@
+#pragma once
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <filesystem>
+
+#include "utilities.h"
+
+namespace fs = std::filesystem;
+
+/**
+ * @brief Closed 1-minute kline - only the values the bot works with
+ */
+struct Kline {
+	int64_t open_time;
+	double close;
+};
+
+/**
+ * @brief Indicator state of a symbol after the kline with the given open time
+ * - dataset rows (RSI, BB lower band, BB upper band, close)
+ */
+struct KlineCheckpoint {
+	int64_t open_time = 0;
+	std::deque<std::deque<double>> rows;
+};
+
+/**
+ * @brief Persistent per-symbol cache of closed klines
+ * - <dir>/<symbol>.klines - append-only binary records (open time, close)
+ * - <dir>/<symbol>.checkpoint - dataset rows computed up to the last cached kline
+ * - upon a restart only the missing tail is requested (startTime)
+ * and the indicator state is resumed from the checkpoint
+ */
+class KlineCache {
+public:
+	KlineCache(const std::string& in_dir = "cache", size_t in_capacity = 500)
+		: dir(in_dir), capacity(in_capacity) { }
+
+	/**
+	 * @returns last (at most capacity) cached klines of a symbol, oldest first
+	 */
+	std::vector<Kline> load(const std::string& symbol) const;
+
+	/**
+	 * @brief Appends freshly closed klines to the cache
+	 * - the file is compacted once it holds twice the capacity
+	 * @param replace - whether the cached klines are out of date
+	 * and shall be dropped first
+	 */
+	void store(const std::string& symbol, const std::vector<Kline>& klines, bool replace);
+
+	std::optional<KlineCheckpoint> load_checkpoint(const std::string& symbol) const;
+	void save_checkpoint(const std::string& symbol, const KlineCheckpoint& checkpoint);
+
+	/**
+	 * @returns whether the cached klines can be extended by a single request
+	 * (the gap is shorter than the capacity)
+	 */
+	bool is_recent(const Kline& kline) const;
+
+private:
+	std::string get_path(const std::string& symbol, const std::string& extension) const;
+	std::vector<Kline> read_all(const std::string& symbol) const;
+	void write_all(const std::string& symbol, const std::vector<Kline>& klines);
+
+	/**
+	 * @brief Identification of the cache files (magic, version)
+	 */
+	const uint32_t klines_magic = 0x4B4D5454; // "TTMK"
+	const uint32_t checkpoint_magic = 0x434D5454; // "TTMC"
+
+	std::string dir;
+	size_t capacity;
+};
+
+#ifndef KLINE_CACHE_DEFINITIONS
+
+template <typename T>
+inline static void write_binary(std::ostream& os, const T& value) {
+	os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+inline static bool read_binary(std::istream& is, T& value) {
+	return (bool)is.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+std::string KlineCache::get_path(const std::string& symbol, const std::string& extension) const {
+	return (fs::path(dir) / (symbol + extension)).string();
+}
+
+bool KlineCache::is_recent(const Kline& kline) const {
+	return get_unix_time_ms() - kline.open_time < (int64_t)capacity * 60000;
+}
+
+std::vector<Kline> KlineCache::read_all(const std::string& symbol) const {
+	std::vector<Kline> klines;
+	std::ifstream reader(get_path(symbol, ".klines"), std::ios::binary);
+	uint32_t magic = 0;
+	if (!reader || !read_binary(reader, magic) || magic != klines_magic) {
+		return klines;
+	}
+	Kline kline {};
+	// a torn record at the end (crash during append) is ignored
+	while (read_binary(reader, kline.open_time) && read_binary(reader, kline.close)) {
+		klines.push_back(kline);
+	}
+	return klines;
+}
+
+std::vector<Kline> KlineCache::load(const std::string& symbol) const {
+	std::vector<Kline> klines = read_all(symbol);
+	if (klines.size() > capacity) {
+		klines.erase(klines.begin(), klines.end() - capacity);
+	}
+	return klines;
+}
+
+void KlineCache::write_all(const std::string& symbol, const std::vector<Kline>& klines) {
+	std::string path = get_path(symbol, ".klines");
+	std::string tmp_path = path + ".tmp";
+	{
+		std::ofstream writer(tmp_path, std::ios::binary | std::ios::trunc);
+		write_binary(writer, klines_magic);
+		for (auto&& kline : klines) {
+			write_binary(writer, kline.open_time);
+			write_binary(writer, kline.close);
+		}
+	}
+	fs::rename(tmp_path, path);
+}
+
+void KlineCache::store(const std::string& symbol, const std::vector<Kline>& klines, bool replace) {
+	try {
+		fs::create_directories(dir);
+		std::string path = get_path(symbol, ".klines");
+		if (replace || !fs::exists(path)) {
+			write_all(symbol, klines);
+			return;
+		}
+		{
+			std::ofstream writer(path, std::ios::binary | std::ios::app);
+			for (auto&& kline : klines) {
+				write_binary(writer, kline.open_time);
+				write_binary(writer, kline.close);
+			}
+		}
+		std::vector<Kline> all = read_all(symbol);
+		if (all.size() > 2 * capacity) {
+			all.erase(all.begin(), all.end() - capacity);
+			write_all(symbol, all);
+		}
+	}
+	catch (std::exception& exc) {
+		print(exc.what(), "\n");
+	}
+}
+
+std::optional<KlineCheckpoint> KlineCache::load_checkpoint(const std::string& symbol) const {
+	std::ifstream reader(get_path(symbol, ".checkpoint"), std::ios::binary);
+	uint32_t magic = 0;
+	uint32_t row_count = 0;
+	uint32_t column_count = 0;
+	KlineCheckpoint checkpoint;
+	if (!reader || !read_binary(reader, magic) || magic != checkpoint_magic
+		|| !read_binary(reader, checkpoint.open_time)
+		|| !read_binary(reader, row_count) || !read_binary(reader, column_count)) {
+		return std::nullopt;
+	}
+	for (uint32_t i = 0; i < row_count; ++i) {
+		std::deque<double> row(column_count);
+		for (auto&& cell : row) {
+			if (!read_binary(reader, cell)) {
+				return std::nullopt;
+			}
+		}
+		checkpoint.rows.push_back(std::move(row));
+	}
+	return checkpoint;
+}
+
+void KlineCache::save_checkpoint(const std::string& symbol, const KlineCheckpoint& checkpoint) {
+	try {
+		fs::create_directories(dir);
+		std::string path = get_path(symbol, ".checkpoint");
+		std::string tmp_path = path + ".tmp";
+		{
+			std::ofstream writer(tmp_path, std::ios::binary | std::ios::trunc);
+			uint32_t column_count = checkpoint.rows.empty() ? 0 : (uint32_t)checkpoint.rows.front().size();
+			write_binary(writer, checkpoint_magic);
+			write_binary(writer, checkpoint.open_time);
+			write_binary(writer, (uint32_t)checkpoint.rows.size());
+			write_binary(writer, column_count);
+			for (auto&& row : checkpoint.rows) {
+				for (size_t i = 0; i < column_count; ++i) {
+					write_binary(writer, i < row.size() ? row[i] : 0.0);
+				}
+			}
+		}
+		// the previous checkpoint stays valid until the new one is complete
+		fs::rename(tmp_path, path);
+	}
+	catch (std::exception& exc) {
+		print(exc.what(), "\n");
+	}
+}
+
+#endif // !KLINE_CACHE_DEFINITIONS
@@ -0,0 +1,75 @@
+#pragma once
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+#include "utilities.h"
+
+/**
+ * @brief Keeps a window of recently observed latencies
+ * - used to derive percentiles (i.e. p95 of request latency
+ * after which a hedged request is sent)
+ */
+class LatencyTracker {
+public:
+	LatencyTracker(size_t in_capacity = 128)
+		: capacity(in_capacity), next(0) { }
+
+	/**
+	 * @brief Adds a sample, the oldest one is overwritten once the window is full
+	 */
+	void record(ms latency);
+
+	/**
+	 * @param percentile - in the interval (0, 1]
+	 * @param fallback - returned until there are enough samples
+	 */
+	ms get_percentile(double percentile, ms fallback) const;
+
+	size_t size() const;
+
+private:
+	/**
+	 * @brief Minimal number of samples for a percentile to be meaningful.
+	 */
+	const size_t min_samples = 20;
+
+	size_t capacity;
+	size_t next;
+	std::vector<ms> samples;
+	mutable std::mutex mutex;
+};
+
+#ifndef LATENCY_TRACKER_DEFINITIONS
+
+void LatencyTracker::record(ms latency) {
+	std::lock_guard<std::mutex> guard(mutex);
+	if (samples.size() < capacity) {
+		samples.push_back(latency);
+	}
+	else {
+		samples[next] = latency;
+	}
+	next = (next + 1) % capacity;
+}
+
+ms LatencyTracker::get_percentile(double percentile, ms fallback) const {
+	std::vector<ms> sorted;
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		if (samples.size() < min_samples) {
+			return fallback;
+		}
+		sorted = samples;
+	}
+	size_t index = std::min(sorted.size() - 1, (size_t)(percentile * (double)sorted.size()));
+	std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+	return sorted[index];
+}
+
+size_t LatencyTracker::size() const {
+	std::lock_guard<std::mutex> guard(mutex);
+	return samples.size();
+}
+
+#endif // !LATENCY_TRACKER_DEFINITIONS
@@ -0,0 +1,181 @@
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "utilities.h"
+#include "transaction.h"
+
+/**
+ * @brief Price of a watched symbol as seen by the analysis
+ */
+struct QuoteView {
+	std::string symbol;
+	double price = 0; // mid price of buy and sell
+	std::string source; // venue which quoted the buy price (empty for the only one)
+	double buy_price = 0;
+	double sell_price = 0;
+	std::string sell_source;
+};
+
+/**
+ * @brief Latest indicators of a watched symbol
+ */
+struct IndicatorView {
+	std::string symbol;
+	double rsi = 0;
+	double lower_band = 0;
+	double upper_band = 0;
+	double price = 0;
+};
+
+/**
+ * @brief Consistent view of the market and the portfolio after a tick
+ * - immutable once published, a reader may keep it as long as it wants
+ */
+struct MarketView {
+	uint64_t version = 0; // assigned on publishing, increases with every view
+	int64_t timestamp = 0; // Unix time in ms
+	std::vector<QuoteView> quotes;
+	std::vector<std::pair<std::string, double>> assets;
+	std::vector<IndicatorView> indicators; // ordered by symbols
+	std::vector<std::shared_ptr<Transaction>> transactions; // recent ones, oldest first
+	double estimated_withdrawal = 0; // USD
+};
+
+/**
+ * @brief The latest published version of a state (read-copy-update)
+ * - the writer builds a new version aside and swaps it in with a single atomic store,
+ * readers atomically take a reference to the current one
+ * - a version is freed once its last reader drops it, readers never wait for
+ * the writer and the writer never waits for the readers
+ * - the latest few versions are kept for the writer, a version no reader holds anymore
+ * is built again in place (its memory is reused, a tick does not allocate the view)
+ */
+template <typename T>
+class VersionedSnapshot {
+public:
+	VersionedSnapshot() : current(), next_version(1) { }
+	VersionedSnapshot(const VersionedSnapshot&) = delete;
+	VersionedSnapshot& operator=(const VersionedSnapshot&) = delete;
+
+	/**
+	 * @returns state to build the next version in - a former version which is not current
+	 * and has no reader (its contents are stale, the writer overwrites them), otherwise a new one
+	 */
+	std::shared_ptr<T> acquire();
+
+	/**
+	 * @brief Sets the version of the state and makes it visible to the readers.
+	 */
+	void publish(std::shared_ptr<T> state);
+
+	/**
+	 * @returns the latest version (null if nothing has been published yet)
+	 */
+	std::shared_ptr<const T> read() const;
+
+private:
+	// writers are serialized among themselves (versions are published in order)
+	std::mutex publish_mutex;
+#ifdef __cpp_lib_atomic_shared_ptr
+	std::atomic<std::shared_ptr<const T>> current;
+#else
+	std::shared_ptr<const T> current; // accessed via std::atomic_load/store only
+#endif // !__cpp_lib_atomic_shared_ptr
+	uint64_t next_version;
+	std::vector<std::shared_ptr<T>> recycled; // published versions kept for acquire
+	static constexpr size_t max_recycled = 4;
+};
+
+#ifndef VERSIONED_SNAPSHOT_DEFINITIONS
+
+template <typename T>
+std::shared_ptr<T> VersionedSnapshot<T>::acquire() {
+	std::lock_guard<std::mutex> guard(publish_mutex);
+	for (auto&& state : recycled) {
+		// only kept here - the readers drop their references, nobody takes a new one
+		if (state.use_count() == 1) {
+			// the reads of the last reader happen before the writes of the next version
+			std::atomic_thread_fence(std::memory_order_acquire);
+			return state;
+		}
+	}
+	return std::make_shared<T>();
+}
+
+template <typename T>
+void VersionedSnapshot<T>::publish(std::shared_ptr<T> state) {
+	std::lock_guard<std::mutex> guard(publish_mutex);
+	state->version = next_version++;
+	bool is_recycled = std::find(recycled.begin(), recycled.end(), state) != recycled.end();
+	if (!is_recycled && recycled.size() < max_recycled) {
+		recycled.push_back(state);
+	}
+#ifdef __cpp_lib_atomic_shared_ptr
+	current.store(std::move(state), std::memory_order_release);
+#else
+	std::atomic_store_explicit(&current, std::shared_ptr<const T>(std::move(state)), std::memory_order_release);
+#endif // !__cpp_lib_atomic_shared_ptr
+}
+
+template <typename T>
+std::shared_ptr<const T> VersionedSnapshot<T>::read() const {
+#ifdef __cpp_lib_atomic_shared_ptr
+	return current.load(std::memory_order_acquire);
+#else
+	return std::atomic_load_explicit(&current, std::memory_order_acquire);
+#endif // !__cpp_lib_atomic_shared_ptr
+}
+
+#endif // !VERSIONED_SNAPSHOT_DEFINITIONS
+
+#ifndef MARKET_VIEW_PRINT_FUNCTIONS
+
+inline static void print_view_age(const MarketView& view) {
+	print("(as of ", get_datetime(sys_clock::time_point(ms(view.timestamp))), ", version ", view.version, ")\n");
+}
+
+inline static void print_portfolio(const MarketView& view) {
+	for (auto&& [symbol, amount] : view.assets) {
+		print("[", symbol, " : ", amount, "]\n");
+	}
+	print("Estimated withdrawal: ", view.estimated_withdrawal, " USD\n");
+	print_view_age(view);
+}
+
+inline static void print_quotes(const MarketView& view) {
+	for (auto&& quote : view.quotes) {
+		if (quote.source.empty()) {
+			print("[", quote.symbol, ": ", quote.price, " USD]\n");
+		}
+		else if (quote.source == quote.sell_source) {
+			print("[", quote.symbol, ": ", quote.price, " USD @ ", quote.source, "]\n");
+		}
+		else {
+			print("[", quote.symbol, ": buy ", quote.buy_price, " USD @ ", quote.source,
+				", sell ", quote.sell_price, " USD @ ", quote.sell_source, "]\n");
+		}
+	}
+	print_view_age(view);
+}
+
+inline static void print_indicators(const MarketView& view) {
+	print("Indicators at ", get_datetime(sys_clock::time_point(ms(view.timestamp))), "\n");
+	print("RSI = Relative Strength Index \n");
+	print("BB = Bollinger Bands\n\n");
+	for (auto&& indicator : view.indicators) {
+		print("[ --- ", indicator.symbol, " --- ]\n");
+		print("- RSI: ", indicator.rsi, " % \n");
+		print("- BB: Lowerband: ", indicator.lower_band, " USD",
+			", Upperband: ", indicator.upper_band, " USD\n"
+		);
+		print("- Current value: ", indicator.price, " USD\n\n");
+	}
+}
+
+#endif // !MARKET_VIEW_PRINT_FUNCTIONS
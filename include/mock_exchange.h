@@ -0,0 +1,359 @@
+#pragma once
+
+/** Cpprest cross-platform pitfall */
+#define _TURN_OFF_PLATFORM_STRING
+#include <cpprest/json.h>
+#include <cpprest/http_listener.h>
+
+#include <cmath>
+#include <map>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <functional>
+
+#include "utilities.h"
+
+using namespace web::http;
+using namespace web::http::experimental::listener;
+
+/**
+ * Mock exchange header
+ * @brief A local stand-in for the Binance REST API
+ * - serves the subset of endpoints used by the connectors
+ *   (/api/v3/ticker/price, /api/v3/klines)
+ * - prices are either synthetic (deterministic per symbol and minute)
+ *   or seeded from a recorded ticker response
+ * - latency, error rate and number of symbols are configurable so that
+ *   the bot can be run and measured without an internet connection
+ * @see https://binance-docs.github.io/apidocs/spot/en/#symbol-price-ticker
+ * @see https://binance-docs.github.io/apidocs/spot/en/#kline-candlestick-data
+ */
+
+/**
+ * @brief Settings of the mock exchange (filled from the commandline)
+ */
+struct MockConfig {
+    std::string host = "http://127.0.0.1";
+    unsigned short port = 8080;
+    size_t symbol_count = 500;
+    ms latency = ms(0);
+    ms latency_jitter = ms(0);
+    double error_rate = 0; // percentage of requests answered with an error
+    size_t weight_limit = 1200; // request weight per minute window
+    std::string ticker_file; // optional recorded /api/v3/ticker/price response
+    double price_scale = 1; // multiplies all prices (venues quoting apart)
+};
+
+class MockExchange {
+public:
+    MockExchange(const MockConfig& in_config)
+        : config(in_config), generator(std::random_device{}()),
+        served(0), failed(0) {
+        prepare_symbols();
+    }
+    MockExchange(const MockExchange&) = delete;
+    MockExchange& operator=(const MockExchange&) = delete;
+
+    /**
+     * @brief Starts listening on the configured address
+     * - requests are served on the cpprest thread pool
+     */
+    void open();
+
+    /**
+     * @brief Stops the listener and prints the request statistics
+     */
+    void close();
+
+    /**
+     * @returns Base url which is supposed to be handed over to the bot (TTM_API_URL)
+     */
+    std::string get_url() const;
+
+private: // methods
+    /**
+     * @brief Fills the symbol universe - either from the recorded
+     * ticker file or synthetically (well-known pairs first)
+     */
+    void prepare_symbols();
+
+    void handle_get(const http_request& request);
+    void reply_ticker(const http_request& request, size_t used_weight) const;
+    void reply_klines(const http_request& request, size_t used_weight,
+        const std::map<utility::string_t, utility::string_t>& query) const;
+
+    /**
+     * @brief Replies with the used weight header the way Binance does
+     * @see https://binance-docs.github.io/apidocs/spot/en/#limits
+     */
+    void reply_json(const http_request& request, status_code code,
+        const std::string& body, size_t used_weight) const;
+
+    /**
+     * @brief Accounts request weight in the current minute window
+     * @returns weight used in the window including the request
+     */
+    size_t spend_weight(size_t weight);
+
+    /**
+     * @brief Simulates network latency and failures
+     * @returns whether the request shall be answered with an error
+     */
+    bool simulate_conditions();
+
+    /**
+     * @brief Deterministic price of a symbol in a given minute
+     * - the same minute always yields the same close price, therefore
+     *   klines and ticker stay consistent across requests
+     */
+    double get_price(size_t symbol_index, long long minute) const;
+
+private: // fields
+    MockConfig config;
+    std::vector<std::string> symbols;
+    std::vector<double> base_prices;
+    std::unordered_map<std::string, size_t> symbol_indices;
+    std::unique_ptr<http_listener> listener;
+    std::mt19937 generator;
+    std::mutex generator_mutex;
+    std::mutex weight_mutex;
+    long long weight_minute = 0;
+    size_t used_weight = 0;
+    std::atomic<size_t> served;
+    std::atomic<size_t> failed;
+};
+
+#ifndef MOCK_HELPERS
+
+inline static long long get_minute_since_epoch() {
+    auto&& since_epoch = sys_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::minutes>(since_epoch).count();
+}
+
+inline static std::string to_price_string(double price) {
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(8) << price;
+    return os.str();
+}
+
+/**
+ * @brief Cheap integer hash (splitmix64) used to derive per-minute noise
+ */
+inline static unsigned long long mix_bits(unsigned long long value) {
+    value += 0x9e3779b97f4a7c15ULL;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+#endif // !MOCK_HELPERS
+
+#ifndef MOCK_DEFINITIONS
+
+void MockExchange::prepare_symbols() {
+    if (!config.ticker_file.empty()) {
+        std::ifstream reader(config.ticker_file);
+        std::stringstream buffer;
+        buffer << reader.rdbuf();
+        auto&& json = web::json::value::parse(utility::conversions::to_string_t(buffer.str()));
+        for (auto&& record : json.as_array()) {
+            auto&& object = record.as_object();
+            symbols.push_back(utility::conversions::to_utf8string(object.at(_XPLATSTR("symbol")).as_string()));
+            base_prices.push_back(convert_string_to<double>(
+                utility::conversions::to_utf8string(object.at(_XPLATSTR("price")).as_string())
+            ));
+        }
+    }
+    else {
+        // well-known pairs come first, so that the usual watchlists work out of the box
+        std::vector<std::pair<std::string, double>> known = {
+            {"BTCUSDT", 43000}, {"ETHUSDT", 2300}, {"SOLUSDT", 95}, {"ADAUSDT", 0.55},
+            {"BNBUSDT", 310}, {"XRPUSDT", 0.62}, {"DOGEUSDT", 0.09}, {"DOTUSDT", 7.1}
+        };
+        for (size_t i = 0; i < config.symbol_count; ++i) {
+            if (i < known.size()) {
+                symbols.push_back(known[i].first);
+                base_prices.push_back(known[i].second);
+            }
+            else {
+                symbols.push_back("SYM" + std::to_string(i) + "USDT");
+                base_prices.push_back(1.0 + (double)(mix_bits(i) % 100000) / 100.0);
+            }
+        }
+    }
+    for (size_t i = 0; i < symbols.size(); ++i) {
+        symbol_indices[symbols[i]] = i;
+    }
+}
+
+double MockExchange::get_price(size_t symbol_index, long long minute) const {
+    // slow wave + per-minute noise around the base price
+    double phase = (double)minute / 37.0 + (double)symbol_index;
+    double noise = (double)(mix_bits(symbol_index * 1000003ULL + (unsigned long long)minute) % 2001) / 1000.0 - 1.0;
+    return config.price_scale * base_prices[symbol_index] * (1.0 + 0.01 * std::sin(phase) + 0.002 * noise);
+}
+
+bool MockExchange::simulate_conditions() {
+    ms delay = config.latency;
+    bool shall_fail = false;
+    {
+        std::lock_guard<std::mutex> guard(generator_mutex);
+        if (config.latency_jitter.count() > 0) {
+            std::uniform_int_distribution<long long> jitter(0, config.latency_jitter.count());
+            delay += ms(jitter(generator));
+        }
+        std::uniform_real_distribution<double> chance(0, 100);
+        shall_fail = chance(generator) < config.error_rate;
+    }
+    if (delay.count() > 0) {
+        std::this_thread::sleep_for(delay);
+    }
+    return shall_fail;
+}
+
+void MockExchange::open() {
+    auto&& address = utility::conversions::to_string_t(get_url());
+    listener = std::make_unique<http_listener>(address);
+    listener->support(methods::GET, std::bind(&MockExchange::handle_get, this, std::placeholders::_1));
+    listener->open().wait();
+    print("Mock exchange listening on ", get_url(), " (", symbols.size(), " symbols)\n");
+}
+
+void MockExchange::close() {
+    if (listener) {
+        listener->close().wait();
+    }
+    print("Served ", served.load(), " requests (", failed.load(), " simulated failures)\n");
+}
+
+std::string MockExchange::get_url() const {
+    return config.host + ":" + std::to_string(config.port);
+}
+
+void MockExchange::handle_get(const http_request& request) {
+    ++served;
+    auto&& path = utility::conversions::to_utf8string(request.relative_uri().path());
+    auto&& query = web::uri::split_query(request.relative_uri().query());
+    bool is_ticker = path == "/api/v3/ticker/price";
+    bool is_klines = path == "/api/v3/klines";
+    // a failed request is weighted as well - the scheduler keeps reading the header
+    size_t used = spend_weight(is_ticker ? 4 : is_klines ? 2 : 1);
+    if (simulate_conditions()) {
+        ++failed;
+        // alternate between the two errors the real exchange tends to answer with
+        auto code = failed.load() % 2 ? status_codes::ServiceUnavailable : status_codes::TooManyRequests;
+        reply_json(request, code, "{\"code\":-1003,\"msg\":\"Simulated failure\"}", used);
+        return;
+    }
+    if (used > config.weight_limit) {
+        ++failed;
+        reply_json(request, status_codes::TooManyRequests,
+            "{\"code\":-1003,\"msg\":\"Too much request weight used.\"}", used);
+    }
+    else if (is_ticker) {
+        reply_ticker(request, used);
+    }
+    else if (is_klines) {
+        reply_klines(request, used, query);
+    }
+    else {
+        request.reply(status_codes::NotFound);
+    }
+}
+
+size_t MockExchange::spend_weight(size_t weight) {
+    std::lock_guard<std::mutex> guard(weight_mutex);
+    long long minute = get_minute_since_epoch();
+    if (minute != weight_minute) {
+        weight_minute = minute;
+        used_weight = 0;
+    }
+    used_weight += weight;
+    return used_weight;
+}
+
+void MockExchange::reply_json(
+    const http_request& request, status_code code,
+    const std::string& body, size_t used
+) const {
+    http_response response(code);
+    response.headers().add(_XPLATSTR("X-MBX-USED-WEIGHT-1M"), utility::conversions::to_string_t(std::to_string(used)));
+    response.set_body(utility::conversions::to_string_t(body), _XPLATSTR("application/json"));
+    request.reply(response);
+}
+
+void MockExchange::reply_ticker(const http_request& request, size_t used) const {
+    long long minute = get_minute_since_epoch();
+    std::string body = "[";
+    for (size_t i = 0; i < symbols.size(); ++i) {
+        if (i != 0) {
+            body += ',';
+        }
+        body += "{\"symbol\":\"" + symbols[i] + "\",\"price\":\"" + to_price_string(get_price(i, minute)) + "\"}";
+    }
+    body += ']';
+    reply_json(request, status_codes::OK, body, used);
+}
+
+void MockExchange::reply_klines(
+    const http_request& request, size_t used,
+    const std::map<utility::string_t, utility::string_t>& query
+) const {
+    auto&& symbol_it = query.find(_XPLATSTR("symbol"));
+    if (symbol_it == query.end()) {
+        reply_json(request, status_codes::BadRequest,
+            "{\"code\":-1102,\"msg\":\"Mandatory parameter 'symbol' was not sent.\"}", used);
+        return;
+    }
+    auto&& index_it = symbol_indices.find(utility::conversions::to_utf8string(symbol_it->second));
+    if (index_it == symbol_indices.end()) {
+        reply_json(request, status_codes::BadRequest, "{\"code\":-1121,\"msg\":\"Invalid symbol.\"}", used);
+        return;
+    }
+    // Binance defaults: 500 records, at most 1000
+    long long limit = 500;
+    long long current_minute = get_minute_since_epoch();
+    long long first_minute = 0;
+    std::string parameter = "limit";
+    try {
+        auto&& limit_it = query.find(_XPLATSTR("limit"));
+        if (limit_it != query.end()) {
+            limit = std::min(1000LL, convert_string_to<long long>(utility::conversions::to_utf8string(limit_it->second)));
+        }
+        first_minute = current_minute - limit + 1;
+        parameter = "startTime";
+        auto&& start_it = query.find(_XPLATSTR("startTime"));
+        if (start_it != query.end()) {
+            long long start_ms = convert_string_to<long long>(utility::conversions::to_utf8string(start_it->second));
+            first_minute = (start_ms + 59999) / 60000;
+        }
+    }
+    catch (std::invalid_argument&) {
+        reply_json(request, status_codes::BadRequest,
+            "{\"code\":-1100,\"msg\":\"Illegal characters found in parameter '" + parameter + "'.\"}", used);
+        return;
+    }
+    long long last_minute = std::min(current_minute, first_minute + limit - 1);
+    size_t index = index_it->second;
+    std::string body = "[";
+    for (long long minute = first_minute; minute <= last_minute; ++minute) {
+        if (minute != first_minute) {
+            body += ',';
+        }
+        double open = get_price(index, minute - 1);
+        double close = get_price(index, minute);
+        std::string open_time = std::to_string(minute * 60000);
+        std::string close_time = std::to_string(minute * 60000 + 59999);
+        // [open time, open, high, low, close, volume, close time, quote volume, trades, ...]
+        body += "[" + open_time + ",\"" + to_price_string(open) + "\",\""
+            + to_price_string(std::max(open, close)) + "\",\""
+            + to_price_string(std::min(open, close)) + "\",\""
+            + to_price_string(close) + "\",\"0\"," + close_time + ",\"0\",0,\"0\",\"0\",\"0\"]";
+    }
+    body += ']';
+    reply_json(request, status_codes::OK, body, used);
+}
+
+#endif // !MOCK_DEFINITIONS
@@ -0,0 +1,259 @@
+#pragma once
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <optional>
+#include <functional>
+#include <condition_variable>
+
+#include "utilities.h"
+#include "spsc_ring.h"
+#include "thread_tuning.h"
+
+/**
+ * @brief A blocking queue with a fixed capacity
+ * - producers wait while the queue is full (backpressure)
+ * - consumers wait while the queue is empty
+ * - after close() the remaining items are still handed out,
+ * afterwards pop() returns an empty optional
+ */
+template <typename T>
+class BoundedQueue {
+public:
+	BoundedQueue(size_t in_capacity)
+		: capacity(in_capacity), closed(false) { }
+	BoundedQueue(const BoundedQueue&) = delete;
+	BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+	/**
+	 * @returns false if the queue has been closed in the meantime
+	 */
+	bool push(T item);
+	std::optional<T> pop();
+
+	/**
+	 * @returns an empty optional also if nothing came within the timeout
+	 */
+	std::optional<T> pop_for(std::chrono::microseconds timeout);
+	void close();
+	size_t size() const;
+	bool is_drained() const;
+
+private:
+	size_t capacity;
+	bool closed;
+	std::deque<T> items;
+	mutable std::mutex mutex;
+	std::condition_variable not_full;
+	std::condition_variable not_empty;
+};
+
+/**
+ * @brief Tick processing split into stages running concurrently
+ * - fetch (asynchronous network request, done by the caller) -> parse -> analyze
+ * - each stage has its own thread, therefore the next request may be in flight
+ * while the previous response is being parsed and analyzed
+ * - fetch and parse are connected via a bounded (blocking) queue,
+ * parse and analyze via a lock-free ring - ingestion is never blocked by the analysis,
+ * an item which does not fit is conflated with the next one
+ * @tparam Raw - output of the fetch stage
+ * @tparam Parsed - output of the parse stage
+ */
+template <typename Raw, typename Parsed>
+class TickPipeline {
+public:
+	TickPipeline(
+		const std::function<std::optional<Parsed>(Raw&)>& in_parse,
+		const std::function<void(Parsed&)>& in_analyze,
+		const std::function<void(Parsed& newer, Parsed& older)>& in_conflate,
+		size_t capacity
+	) : parse(in_parse), analyze(in_analyze), conflate(in_conflate),
+		raw_queue(capacity), parsed_ring(capacity) {
+		parse_thread = std::thread(&TickPipeline::run_parse, this);
+		analyze_thread = std::thread(&TickPipeline::run_analyze, this);
+	}
+	TickPipeline(const TickPipeline&) = delete;
+	TickPipeline& operator=(const TickPipeline&) = delete;
+	~TickPipeline() {
+		stop();
+	}
+
+	/**
+	 * @brief Hands over a fetched response to the parse stage
+	 */
+	bool push(Raw raw) {
+		return raw_queue.push(std::move(raw));
+	}
+
+	/**
+	 * @brief Lets the stages process what has been already fetched
+	 * and joins their threads
+	 */
+	void stop();
+
+	/**
+	 * @brief Depth and latency of the ring between the parse and the analysis.
+	 */
+	RingStats get_stats() const {
+		RingStats stats = parsed_ring.get_stats();
+		stats.conflated = conflated.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+private:
+	void run_parse();
+	void run_analyze();
+
+	/**
+	 * @brief Hands over the parsed item, if the ring is full
+	 * it is kept aside (conflated with a previously kept one)
+	 */
+	void publish(std::optional<Parsed>& pending, Parsed& parsed);
+
+	/**
+	 * @brief How often a kept item is offered to the ring again.
+	 */
+	const std::chrono::microseconds retry_interval = std::chrono::microseconds(1000);
+
+	std::function<std::optional<Parsed>(Raw&)> parse;
+	std::function<void(Parsed&)> analyze;
+	std::function<void(Parsed&, Parsed&)> conflate;
+	BoundedQueue<Raw> raw_queue;
+	SpscRing<Parsed> parsed_ring;
+	std::atomic<size_t> conflated = 0;
+	std::thread parse_thread;
+	std::thread analyze_thread;
+};
+
+#ifndef BOUNDED_QUEUE_DEFINITIONS
+
+template <typename T>
+bool BoundedQueue<T>::push(T item) {
+	std::unique_lock<std::mutex> lock(mutex);
+	not_full.wait(lock, [&] { return closed || items.size() < capacity; });
+	if (closed) {
+		return false;
+	}
+	items.push_back(std::move(item));
+	not_empty.notify_one();
+	return true;
+}
+
+template <typename T>
+std::optional<T> BoundedQueue<T>::pop() {
+	std::unique_lock<std::mutex> lock(mutex);
+	not_empty.wait(lock, [&] { return closed || !items.empty(); });
+	if (items.empty()) {
+		return std::nullopt;
+	}
+	T item = std::move(items.front());
+	items.pop_front();
+	not_full.notify_one();
+	return item;
+}
+
+template <typename T>
+std::optional<T> BoundedQueue<T>::pop_for(std::chrono::microseconds timeout) {
+	std::unique_lock<std::mutex> lock(mutex);
+	not_empty.wait_for(lock, timeout, [&] { return closed || !items.empty(); });
+	if (items.empty()) {
+		return std::nullopt;
+	}
+	T item = std::move(items.front());
+	items.pop_front();
+	not_full.notify_one();
+	return item;
+}
+
+template <typename T>
+bool BoundedQueue<T>::is_drained() const {
+	std::unique_lock<std::mutex> lock(mutex);
+	return closed && items.empty();
+}
+
+template <typename T>
+void BoundedQueue<T>::close() {
+	std::unique_lock<std::mutex> lock(mutex);
+	closed = true;
+	not_full.notify_all();
+	not_empty.notify_all();
+}
+
+template <typename T>
+size_t BoundedQueue<T>::size() const {
+	std::unique_lock<std::mutex> lock(mutex);
+	return items.size();
+}
+
+#endif // !BOUNDED_QUEUE_DEFINITIONS
+
+#ifndef TICK_PIPELINE_DEFINITIONS
+
+template <typename Raw, typename Parsed>
+void TickPipeline<Raw, Parsed>::publish(std::optional<Parsed>& pending, Parsed& parsed) {
+	if (pending) {
+		// the kept item is older - it goes first or becomes a part of this one
+		if (parsed_ring.try_push(*pending)) {
+			pending.reset();
+		}
+		else {
+			conflate(parsed, *pending);
+			conflated.fetch_add(1, std::memory_order_relaxed);
+			pending = std::move(parsed);
+			return;
+		}
+	}
+	if (!parsed_ring.try_push(parsed)) {
+		pending = std::move(parsed);
+	}
+}
+
+template <typename Raw, typename Parsed>
+void TickPipeline<Raw, Parsed>::run_parse() {
+	ThreadTuning tuning("ingest", "parse");
+	std::optional<Parsed> pending;
+	while (!raw_queue.is_drained()) {
+		// the kept item waits for a free slot, not for the next response
+		auto&& raw = pending ? raw_queue.pop_for(retry_interval) : raw_queue.pop();
+		if (pending && parsed_ring.try_push(*pending)) {
+			pending.reset();
+		}
+		if (!raw) {
+			continue;
+		}
+		auto&& parsed = parse(*raw);
+		if (parsed) {
+			publish(pending, *parsed);
+		}
+	}
+	// the analysis is still running, the kept item gets its slot
+	while (pending && !parsed_ring.try_push(*pending)) {
+		std::this_thread::sleep_for(retry_interval);
+	}
+	// nothing more is going to be parsed
+	parsed_ring.close();
+}
+
+template <typename Raw, typename Parsed>
+void TickPipeline<Raw, Parsed>::run_analyze() {
+	// the analysis thread runs shard 0 (the first core of the role)
+	ThreadTuning tuning("analysis", "analysis", 0);
+	while (auto&& parsed = parsed_ring.pop()) {
+		analyze(*parsed);
+	}
+}
+
+template <typename Raw, typename Parsed>
+void TickPipeline<Raw, Parsed>::stop() {
+	raw_queue.close();
+	if (parse_thread.joinable()) {
+		parse_thread.join();
+	}
+	if (analyze_thread.joinable()) {
+		analyze_thread.join();
+	}
+}
+
+#endif // !TICK_PIPELINE_DEFINITIONS
@@ -0,0 +1,146 @@
+#pragma once
+#include <array>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <filesystem>
+
+#include "utilities.h"
+
+/**
+ * @brief Framing of the append-only binary files (trade journal, price history)
+ * - record: payload size (4 B), CRC-32 of the payload (4 B), payload
+ * - a torn or corrupted tail (crash during a write) is detected by the checksum
+ */
+
+/**
+ * @brief CRC-32 (IEEE 802.3) of a buffer.
+ */
+uint32_t get_crc32(const char* data, size_t size) {
+	static const std::array<uint32_t, 256> table = [] {
+		std::array<uint32_t, 256> result {};
+		for (uint32_t i = 0; i < 256; ++i) {
+			uint32_t crc = i;
+			for (int bit = 0; bit < 8; ++bit) {
+				crc = (crc & 1) ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+			}
+			result[i] = crc;
+		}
+		return result;
+	}();
+	uint32_t crc = 0xFFFFFFFF;
+	for (size_t i = 0; i < size; ++i) {
+		crc = table[(crc ^ (uint8_t)data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return crc ^ 0xFFFFFFFF;
+}
+
+#ifndef RECORD_LOG_DEFINITIONS
+
+template <typename T>
+inline static void append_binary(std::string& out, const T& value) {
+	out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+inline static bool take_binary(const std::string& in, size_t& offset, T& value) {
+	if (offset + sizeof(T) > in.size()) {
+		return false;
+	}
+	std::memcpy(&value, in.data() + offset, sizeof(T));
+	offset += sizeof(T);
+	return true;
+}
+
+inline static void append_name(std::string& out, const std::string& name) {
+	append_binary(out, (uint16_t)name.size());
+	out += name;
+}
+
+inline static bool take_name(const std::string& in, size_t& offset, std::string& name) {
+	uint16_t size = 0;
+	if (!take_binary(in, offset, size) || offset + size > in.size()) {
+		return false;
+	}
+	name = in.substr(offset, size);
+	offset += size;
+	return true;
+}
+
+/**
+ * @brief Reads a section count - every item takes at least one byte,
+ * a bigger count is a corrupted one
+ */
+inline static bool take_count(const std::string& in, size_t& offset, uint32_t& count) {
+	return take_binary(in, offset, count) && count <= in.size() - offset;
+}
+
+/**
+ * @returns the payload framed as a record (size, checksum, payload)
+ */
+std::string frame_record(const std::string& payload) {
+	std::string record;
+	record.reserve(2 * sizeof(uint32_t) + payload.size());
+	append_binary(record, (uint32_t)payload.size());
+	append_binary(record, get_crc32(payload.data(), payload.size()));
+	record += payload;
+	return record;
+}
+
+/**
+ * @brief Reads records of a file until the first torn or corrupted one
+ * @param max_payload - anything bigger is a corrupted size
+ * @param apply - called with the payload and the offset right after the record,
+ * returns false if the payload can't be decoded (reading stops)
+ * @param from_offset - a record boundary within the file, the records before it
+ * are neither read nor checked
+ * @returns offset after the last valid record
+ */
+uint64_t read_records(
+	const std::string& path, uint32_t max_payload,
+	const std::function<bool(const std::string&, uint64_t)>& apply,
+	uint64_t from_offset = 0
+) {
+	std::ifstream reader(path, std::ios::binary);
+	if (!reader || !reader.seekg((std::streamoff)from_offset)) {
+		return 0;
+	}
+	uint64_t offset = from_offset;
+	uint32_t size = 0;
+	uint32_t crc = 0;
+	std::string payload;
+	while (reader.read(reinterpret_cast<char*>(&size), sizeof(size))
+		&& reader.read(reinterpret_cast<char*>(&crc), sizeof(crc))
+		&& size <= max_payload) {
+		payload.resize(size);
+		if (!reader.read(payload.data(), size) || get_crc32(payload.data(), size) != crc) {
+			break;
+		}
+		uint64_t next = offset + 2 * sizeof(uint32_t) + size;
+		if (!apply(payload, next)) {
+			break;
+		}
+		offset = next;
+	}
+	return offset;
+}
+
+/**
+ * @brief Cuts off everything after the last valid record
+ * (records appended after a torn one would never be read).
+ */
+void drop_torn_tail(const std::string& path, uint64_t valid_end) {
+	try {
+		if (std::filesystem::exists(path) && std::filesystem::file_size(path) > valid_end) {
+			print("File ", path, ": dropping a torn tail after ", valid_end, " B\n");
+			std::filesystem::resize_file(path, valid_end);
+		}
+	}
+	catch (std::exception& exc) {
+		print(exc.what(), "\n");
+	}
+}
+
+#endif // !RECORD_LOG_DEFINITIONS
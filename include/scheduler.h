@@ -0,0 +1,255 @@
+#pragma once
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <string>
+#include <algorithm>
+
+#include "utilities.h"
+#include "symbol_table.h"
+
+/**
+ * @brief Kinds of requests the bot issues against the exchange API
+ * with their request weight
+ * @see https://binance-docs.github.io/apidocs/spot/en/#limits
+ */
+enum class RequestKind { Ticker, Klines };
+
+/**
+ * @brief Keeps the bot within the request weight budget of the exchange
+ * - the used weight is taken from the response headers (X-MBX-USED-WEIGHT-1M)
+ *   and estimated locally when the header is missing
+ * - the budget of a minute window is split between ticker and kline calls
+ *   (kline calls happen only upon add command or at the start)
+ * - each watched symbol gets its own polling interval derived from its volatility,
+ *   the next tick comes when the most urgent symbol is due
+ *   (as long as the budget allows it)
+ */
+class RequestScheduler {
+public:
+	RequestScheduler()
+		: mutex(), window_minute(0), used_weight(0), klines_weight(0) { }
+
+	/**
+	 * @brief Accounts a request which is about to be sent
+	 */
+	void record_request(RequestKind kind);
+
+	/**
+	 * @brief Updates the used weight according to the exchange
+	 * @param used - value of the used weight header (for the current minute window)
+	 */
+	void update_used_weight(size_t used);
+
+	/**
+	 * @returns time until there is a budget for a kline request (0 if there is one)
+	 * - kline requests may come in bursts (e.g. a long watchlist at the start),
+	 * the callers wait on a timer of the executor
+	 */
+	ms get_klines_budget_delay();
+
+	/**
+	 * @brief Updates volatility estimation of a watched symbol
+	 * @param symbol - cryptocurrency
+	 * @param price - latest exchange rate
+	 */
+	void record_price(SymbolId symbol, double price);
+
+	/**
+	 * @returns whether the symbol shall be analyzed (its polling interval elapsed)
+	 */
+	bool is_due(SymbolId symbol) const;
+
+	/**
+	 * @brief Plans the next poll of an analyzed symbol.
+	 */
+	void mark_polled(SymbolId symbol);
+
+	/**
+	 * @brief Forgets a symbol which is no longer watched
+	 */
+	void remove(SymbolId symbol);
+
+	/**
+	 * @returns Delay until the next ticker request
+	 * - the most urgent watched symbol sets the pace,
+	 *   the remaining ticker budget of the window sets the limit
+	 */
+	ms next_delay();
+
+private: // methods
+	/**
+	 * @brief Starts a new minute window if needed
+	 */
+	void refresh_window(const sys_clock::time_point& now);
+	ms get_interval(SymbolId symbol) const;
+	static size_t get_weight(RequestKind kind);
+
+private: // fields
+	/**
+	 * @brief Request weight per minute window (IP based)
+	 * - kept at the historical (conservative) value of Binance
+	 */
+	const size_t weight_limit = 1200;
+
+	/**
+	 * @brief Share of the limit which can be spent in total
+	 * - the rest is left to other clients behind the same IP
+	 */
+	const double usable_share = 0.8;
+
+	/**
+	 * @brief Share of the usable budget reserved for kline requests.
+	 */
+	const double klines_share = 0.25;
+
+	/**
+	 * @brief Polling interval bounds, the base interval is used
+	 * until the volatility of a symbol is known
+	 */
+	const ms min_interval = ms(1000);
+	const ms base_interval = ms(10000);
+	const ms max_interval = ms(60000);
+
+	/**
+	 * @brief Desired relative price move between two polls
+	 * - the interval T follows from sigma * sqrt(T) = target_move
+	 */
+	const double target_move = 0.0003;
+
+	/**
+	 * @brief Smoothing factor of the volatility estimation (EWMA).
+	 */
+	const double smoothing = 0.2;
+
+	struct SymbolPace {
+		double last_price = 0;
+		sys_clock::time_point last_seen {};
+		sys_clock::time_point next_due {};
+		double volatility = 0; // per sqrt(second), 0 until known
+	};
+
+	mutable std::mutex mutex;
+	long long window_minute;
+	size_t used_weight;
+	size_t klines_weight;
+	SymbolMap<SymbolPace> paces;
+};
+
+#ifndef SCHEDULER_DEFINITIONS
+
+size_t RequestScheduler::get_weight(RequestKind kind) {
+	// /api/v3/ticker/price without a symbol: 4
+	// /api/v3/klines with the default limit (500): 2
+	return kind == RequestKind::Ticker ? 4 : 2;
+}
+
+void RequestScheduler::refresh_window(const sys_clock::time_point& now) {
+	long long minute = std::chrono::duration_cast<std::chrono::minutes>(now.time_since_epoch()).count();
+	if (minute != window_minute) {
+		window_minute = minute;
+		used_weight = 0;
+		klines_weight = 0;
+	}
+}
+
+void RequestScheduler::record_request(RequestKind kind) {
+	std::lock_guard<std::mutex> guard(mutex);
+	refresh_window(sys_clock::now());
+	used_weight += get_weight(kind);
+	if (kind == RequestKind::Klines) {
+		klines_weight += get_weight(kind);
+	}
+}
+
+void RequestScheduler::update_used_weight(size_t used) {
+	std::lock_guard<std::mutex> guard(mutex);
+	refresh_window(sys_clock::now());
+	// the exchange knows better (other clients, requests in flight)
+	used_weight = std::max(used_weight, used);
+}
+
+ms RequestScheduler::get_klines_budget_delay() {
+	sys_clock::time_point now = sys_clock::now();
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		refresh_window(now);
+		double usable = weight_limit * usable_share;
+		if (used_weight + get_weight(RequestKind::Klines) <= usable
+			&& klines_weight + get_weight(RequestKind::Klines) <= usable * klines_share) {
+			return ms(0);
+		}
+	}
+	auto&& next_window = std::chrono::ceil<std::chrono::minutes>(now);
+	// at least a millisecond - the window is refreshed only after it starts
+	return std::max(ms(1), std::chrono::ceil<ms>(next_window - now));
+}
+
+void RequestScheduler::record_price(SymbolId symbol, double price) {
+	std::lock_guard<std::mutex> guard(mutex);
+	sys_clock::time_point now = sys_clock::now();
+	SymbolPace& pace = paces[symbol];
+	if (pace.last_price > 0 && price > 0) {
+		double elapsed = std::chrono::duration<double>(now - pace.last_seen).count();
+		if (elapsed > 0) {
+			double sample = std::abs(price - pace.last_price) / pace.last_price / std::sqrt(elapsed);
+			pace.volatility = pace.volatility == 0
+				? sample : smoothing * sample + (1 - smoothing) * pace.volatility;
+		}
+	}
+	pace.last_price = price;
+	pace.last_seen = now;
+}
+
+ms RequestScheduler::get_interval(SymbolId symbol) const {
+	const SymbolPace* pace = paces.find(symbol);
+	if (pace == nullptr || pace->volatility == 0) {
+		return base_interval;
+	}
+	double ratio = target_move / pace->volatility;
+	auto&& interval = ms((long long)(ratio * ratio * 1000));
+	return std::clamp(interval, min_interval, max_interval);
+}
+
+bool RequestScheduler::is_due(SymbolId symbol) const {
+	std::lock_guard<std::mutex> guard(mutex);
+	const SymbolPace* pace = paces.find(symbol);
+	return pace == nullptr || sys_clock::now() >= pace->next_due;
+}
+
+void RequestScheduler::mark_polled(SymbolId symbol) {
+	std::lock_guard<std::mutex> guard(mutex);
+	paces[symbol].next_due = sys_clock::now() + get_interval(symbol);
+}
+
+void RequestScheduler::remove(SymbolId symbol) {
+	std::lock_guard<std::mutex> guard(mutex);
+	paces.erase(symbol);
+}
+
+ms RequestScheduler::next_delay() {
+	std::lock_guard<std::mutex> guard(mutex);
+	sys_clock::time_point now = sys_clock::now();
+	refresh_window(now);
+
+	// pace given by the most urgent symbol
+	ms desired = paces.empty() ? base_interval : max_interval;
+	for (auto&& [symbol, pace] : paces) {
+		auto&& until_due = std::chrono::duration_cast<ms>(pace.next_due - now);
+		desired = std::min(desired, until_due);
+	}
+	desired = std::clamp(desired, min_interval, max_interval);
+
+	// limit given by the ticker budget left in the current window
+	// - unspent kline budget stays reserved for add commands
+	double usable = weight_limit * usable_share;
+	double klines_reserve = std::max(0.0, usable * klines_share - klines_weight);
+	double ticker_left = usable - klines_reserve - used_weight;
+	auto&& window_end = std::chrono::ceil<std::chrono::minutes>(now + ms(1));
+	ms window_left = std::chrono::duration_cast<ms>(window_end - now);
+	ms::rep calls_left = ticker_left > 0 ? (ms::rep)(ticker_left / get_weight(RequestKind::Ticker)) : 0;
+	ms budget_limit = calls_left > 0 ? window_left / calls_left : window_left;
+	return std::max(desired, budget_limit);
+}
+
+#endif // !SCHEDULER_DEFINITIONS
@@ -0,0 +1,150 @@
+#pragma once
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+#include "utilities.h"
+#include "thread_tuning.h"
+
+/**
+ * @brief Number of analysis shards of the environment
+ * - TTM_SHARDS: number of shards (default 1 - the analysis runs on a single thread),
+ * "auto" takes one shard per core
+ */
+size_t get_shard_count() {
+	const char* configured = std::getenv("TTM_SHARDS");
+	if (configured == nullptr || *configured == '\0') {
+		return 1;
+	}
+	if (std::string(configured) == "auto") {
+		return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	}
+	try {
+		return std::max<size_t>(convert_string_to<size_t>(configured), 1);
+	}
+	catch (std::invalid_argument& exc) {
+		print("TTM_SHARDS: ", exc.what(), "\n");
+		return 1;
+	}
+}
+
+/**
+ * @brief Long-lived workers, one per shard
+ * - run() hands the same job to every shard and returns once all of them are done
+ * (the calling thread runs shard 0 itself)
+ * - a shard always runs on the same thread pinned to a core of its own (TTM_AFFINITY_ANALYSIS),
+ * its state stays in the caches of that core
+ */
+class ShardPool {
+public:
+	ShardPool(size_t in_shard_count);
+	ShardPool(const ShardPool&) = delete;
+	ShardPool& operator=(const ShardPool&) = delete;
+	~ShardPool();
+
+	size_t get_shard_count() const { return shard_count; }
+
+	/**
+	 * @param job - called with the index of the shard
+	 * @throws the first exception thrown by a shard (after all of them are done)
+	 */
+	void run(const std::function<void(size_t)>& job);
+
+private:
+	void work(size_t shard);
+
+	/**
+	 * @brief Runs the job of a shard and keeps its failure.
+	 */
+	void run_shard(const std::function<void(size_t)>& job, size_t shard);
+
+	size_t shard_count;
+	std::mutex mutex;
+	std::condition_variable start;
+	std::condition_variable done;
+	const std::function<void(size_t)>* current_job = nullptr;
+	uint64_t generation = 0; // increased with every job
+	size_t remaining = 0; // shards still running the current job
+	std::exception_ptr failure;
+	bool running = true;
+	std::vector<std::thread> workers;
+};
+
+#ifndef SHARD_POOL_DEFINITIONS
+
+ShardPool::ShardPool(size_t in_shard_count) : shard_count(std::max<size_t>(in_shard_count, 1)) {
+	for (size_t shard = 1; shard < shard_count; ++shard) {
+		workers.emplace_back(&ShardPool::work, this, shard);
+	}
+}
+
+ShardPool::~ShardPool() {
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		running = false;
+	}
+	start.notify_all();
+	for (auto&& worker : workers) {
+		worker.join();
+	}
+}
+
+void ShardPool::run_shard(const std::function<void(size_t)>& job, size_t shard) {
+	try {
+		job(shard);
+	}
+	catch (...) {
+		std::lock_guard<std::mutex> guard(mutex);
+		if (!failure) {
+			failure = std::current_exception();
+		}
+	}
+}
+
+void ShardPool::run(const std::function<void(size_t)>& job) {
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		current_job = &job;
+		remaining = shard_count - 1;
+		failure = nullptr;
+		++generation;
+	}
+	start.notify_all();
+	run_shard(job, 0);
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this] { return remaining == 0; });
+	current_job = nullptr;
+	if (failure) {
+		std::rethrow_exception(failure);
+	}
+}
+
+void ShardPool::work(size_t shard) {
+	// one core per shard - shard 0 is the analysis thread on the first core of the list
+	ThreadTuning tuning("analysis", "shard " + std::to_string(shard), shard);
+	uint64_t seen = 0;
+	while (true) {
+		const std::function<void(size_t)>* job = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			start.wait(lock, [&] { return !running || generation != seen; });
+			if (!running) {
+				return;
+			}
+			seen = generation;
+			job = current_job;
+		}
+		run_shard(*job, shard);
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			--remaining;
+		}
+		done.notify_one();
+	}
+}
+
+#endif // !SHARD_POOL_DEFINITIONS
@@ -0,0 +1,196 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <algorithm>
+
+/**
+ * @brief Observable state of a ring
+ */
+struct RingStats {
+	size_t capacity = 0;
+	size_t pushed = 0;
+	size_t popped = 0;
+	size_t rejected = 0; // pushes which found the ring full
+	size_t conflated = 0; // rejected items merged into a newer one (by the producer)
+	size_t depth = 0; // items waiting right now
+	size_t max_depth = 0;
+	std::chrono::microseconds mean_latency = std::chrono::microseconds(0); // push to pop
+	std::chrono::microseconds max_latency = std::chrono::microseconds(0);
+};
+
+/**
+ * @brief Bounded lock-free ring of a single producer and a single consumer
+ * - push never blocks (the producer decides what to do with a rejected item),
+ * pop blocks while the ring is empty
+ * - positions of the producer and the consumer are on separate cache lines,
+ * each side keeps a cached copy of the other one's position (no false sharing,
+ * the other line is read only when the ring seems full/empty)
+ * - close() is called by the producer, the remaining items are still handed out,
+ * afterwards pop() returns an empty optional
+ */
+template <typename T>
+class SpscRing {
+public:
+	/**
+	 * @param in_capacity - rounded up to a power of two
+	 */
+	SpscRing(size_t in_capacity);
+	SpscRing(const SpscRing&) = delete;
+	SpscRing& operator=(const SpscRing&) = delete;
+
+	/**
+	 * @brief Producer side
+	 * @returns false if the ring is full or closed (the item is left untouched)
+	 */
+	bool try_push(T& item);
+
+	/**
+	 * @brief Producer side - no more items are going to be pushed
+	 */
+	void close();
+
+	/**
+	 * @brief Consumer side
+	 */
+	std::optional<T> pop();
+
+	/**
+	 * @brief May be called from any thread.
+	 */
+	RingStats get_stats() const;
+
+private:
+	using steady_clock = std::chrono::steady_clock;
+
+	// std::hardware_destructive_interference_size is not stable across compilers
+	static constexpr size_t cache_line = 64;
+	// the producer's position carries the closed flag (the producer is its only writer)
+	static constexpr size_t closed_flag = size_t(1) << (sizeof(size_t) * 8 - 1);
+
+	struct Slot {
+		T item {};
+		steady_clock::time_point pushed;
+	};
+
+	static size_t round_up(size_t value);
+
+	std::vector<Slot> slots;
+	size_t mask;
+
+	// producer's line
+	alignas(cache_line) std::atomic<size_t> tail;
+	size_t cached_head;
+	std::atomic<size_t> pushed;
+	std::atomic<size_t> rejected;
+	std::atomic<size_t> max_depth;
+
+	// consumer's line
+	alignas(cache_line) std::atomic<size_t> head;
+	size_t cached_tail;
+	std::atomic<int64_t> total_latency; // us
+	std::atomic<int64_t> max_latency; // us
+
+	// nothing else shares the consumer's line
+	alignas(cache_line) char padding = 0;
+};
+
+#ifndef SPSC_RING_DEFINITIONS
+
+template <typename T>
+size_t SpscRing<T>::round_up(size_t value) {
+	size_t result = 1;
+	while (result < value) {
+		result <<= 1;
+	}
+	return result;
+}
+
+template <typename T>
+SpscRing<T>::SpscRing(size_t in_capacity)
+	: slots(round_up(std::max<size_t>(in_capacity, 1))), mask(slots.size() - 1),
+	tail(0), cached_head(0), pushed(0), rejected(0), max_depth(0),
+	head(0), cached_tail(0), total_latency(0), max_latency(0) { }
+
+template <typename T>
+bool SpscRing<T>::try_push(T& item) {
+	size_t position = tail.load(std::memory_order_relaxed);
+	if (position & closed_flag) {
+		return false;
+	}
+	if (position - cached_head == slots.size()) {
+		cached_head = head.load(std::memory_order_acquire);
+		if (position - cached_head == slots.size()) {
+			rejected.store(rejected.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			return false;
+		}
+	}
+	Slot& slot = slots[position & mask];
+	slot.item = std::move(item);
+	slot.pushed = steady_clock::now();
+	tail.store(position + 1, std::memory_order_release);
+	tail.notify_one();
+	pushed.store(pushed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	size_t depth = position + 1 - cached_head;
+	if (depth > max_depth.load(std::memory_order_relaxed)) {
+		max_depth.store(depth, std::memory_order_relaxed);
+	}
+	return true;
+}
+
+template <typename T>
+void SpscRing<T>::close() {
+	tail.store(tail.load(std::memory_order_relaxed) | closed_flag, std::memory_order_release);
+	tail.notify_all();
+}
+
+template <typename T>
+std::optional<T> SpscRing<T>::pop() {
+	size_t position = head.load(std::memory_order_relaxed);
+	while ((cached_tail & ~closed_flag) == position) {
+		cached_tail = tail.load(std::memory_order_acquire);
+		if ((cached_tail & ~closed_flag) != position) {
+			break;
+		}
+		if (cached_tail & closed_flag) {
+			return std::nullopt;
+		}
+		// sleeps until the producer moves (or closes the ring)
+		tail.wait(cached_tail, std::memory_order_acquire);
+	}
+	Slot& slot = slots[position & mask];
+	T item = std::move(slot.item);
+	int64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(
+		steady_clock::now() - slot.pushed
+	).count();
+	head.store(position + 1, std::memory_order_release);
+	total_latency.store(total_latency.load(std::memory_order_relaxed) + latency, std::memory_order_relaxed);
+	if (latency > max_latency.load(std::memory_order_relaxed)) {
+		max_latency.store(latency, std::memory_order_relaxed);
+	}
+	return item;
+}
+
+template <typename T>
+RingStats SpscRing<T>::get_stats() const {
+	RingStats stats;
+	stats.capacity = slots.size();
+	size_t popped = head.load(std::memory_order_acquire);
+	size_t position = tail.load(std::memory_order_acquire) & ~closed_flag;
+	stats.pushed = pushed.load(std::memory_order_relaxed);
+	stats.popped = popped;
+	stats.rejected = rejected.load(std::memory_order_relaxed);
+	stats.depth = position >= popped ? position - popped : 0;
+	stats.max_depth = max_depth.load(std::memory_order_relaxed);
+	if (popped > 0) {
+		stats.mean_latency = std::chrono::microseconds(
+			total_latency.load(std::memory_order_relaxed) / (int64_t)popped
+		);
+	}
+	stats.max_latency = std::chrono::microseconds(max_latency.load(std::memory_order_relaxed));
+	return stats;
+}
+
+#endif // !SPSC_RING_DEFINITIONS
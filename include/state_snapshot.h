@@ -0,0 +1,347 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <array>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <optional>
+#include <condition_variable>
+
+#include "utilities.h"
+#include "record_log.h"
+#include "thread_tuning.h"
+
+/**
+ * @brief State of the analyzer at a point of the journal
+ * - symbols are kept by their names (ids are assigned anew by every run)
+ */
+struct AnalyzerState {
+	struct TransactionRecord {
+		std::string symbol;
+		std::string action;
+		double amount = 0;
+		double xrate = 0;
+		std::string datetime;
+	};
+
+	int64_t timestamp = 0; // Unix time in ms
+	uint64_t journal_offset = 0; // journal records before it are reflected in the state
+	std::vector<std::pair<std::string, double>> assets;
+	std::vector<std::pair<std::string, uint64_t>> signal_counters;
+	std::vector<std::pair<std::string, std::deque<double>>> last_records;
+	// rows of a symbol are shared with the analyzer until they change (never modified in place)
+	std::vector<std::pair<std::string, std::shared_ptr<const std::deque<std::deque<double>>>>> dataset;
+	std::vector<TransactionRecord> transactions; // oldest first
+};
+
+/**
+ * @brief Snapshot interval of the environment
+ * - TTM_SNAPSHOT_INTERVAL: seconds between two snapshots (default 60, 0 turns them off)
+ */
+ms get_snapshot_interval() {
+	const char* configured = std::getenv("TTM_SNAPSHOT_INTERVAL");
+	if (configured == nullptr || *configured == '\0') {
+		return ms(60000);
+	}
+	try {
+		return ms(1000 * convert_string_to<long long>(configured));
+	}
+	catch (std::invalid_argument& exc) {
+		print("TTM_SNAPSHOT_INTERVAL: ", exc.what(), "\n");
+		return ms(60000);
+	}
+}
+
+/**
+ * @brief Writes snapshots of the analyzer state on a background thread
+ * - submit() moves the captured state into the pending slot, the writer takes it
+ * and encodes it while the analysis goes on (a newer state replaces a pending one
+ * which has not been written yet)
+ * - the captured state is not free: names, counters and last records are copied,
+ * the dataset rows are shared blocks copied only for the symbols changed since
+ * the previous capture
+ * - two slot files <path>.0 and <path>.1 are written alternately,
+ * a snapshot torn by a crash leaves the other slot intact
+ * - slot: magic, sequence number, payload size, CRC-32 of the payload, payload
+ */
+class SnapshotWriter {
+public:
+	SnapshotWriter(const std::string& in_path);
+	SnapshotWriter(const SnapshotWriter&) = delete;
+	SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+	~SnapshotWriter();
+
+	/**
+	 * @returns the newest valid snapshot of the slots (if any)
+	 */
+	std::optional<AnalyzerState> load_latest();
+
+	/**
+	 * @brief Hands the state over to the writer (the caller does not wait for the disk)
+	 */
+	void submit(AnalyzerState&& state);
+
+	/**
+	 * @brief Writes the pending state and stops the writer.
+	 */
+	void stop();
+
+private:
+	void run();
+	void write(const AnalyzerState& state);
+	std::optional<AnalyzerState> read_slot(size_t slot, uint64_t& sequence) const;
+	std::string get_slot_path(size_t slot) const;
+
+	static std::string encode(const AnalyzerState& state);
+	static bool decode(const std::string& payload, AnalyzerState& state);
+
+	const uint32_t snapshot_magic = 0x53545454; // "TTTS"
+
+	std::string path;
+	uint64_t sequence; // of the last written snapshot
+	AnalyzerState pending;
+	AnalyzerState writing;
+	bool has_pending;
+	bool running;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::thread worker;
+};
+
+#ifndef STATE_SNAPSHOT_DEFINITIONS
+
+inline static void append_row(std::string& out, const std::deque<double>& row) {
+	append_binary(out, (uint32_t)row.size());
+	for (double cell : row) {
+		append_binary(out, cell);
+	}
+}
+
+inline static bool take_row(const std::string& in, size_t& offset, std::deque<double>& row) {
+	uint32_t size = 0;
+	if (!take_binary(in, offset, size) || offset + (size_t)size * sizeof(double) > in.size()) {
+		return false;
+	}
+	row.resize(size);
+	for (auto&& cell : row) {
+		take_binary(in, offset, cell);
+	}
+	return true;
+}
+
+SnapshotWriter::SnapshotWriter(const std::string& in_path)
+	: path(in_path), sequence(0), has_pending(false), running(true) {
+	worker = std::thread(&SnapshotWriter::run, this);
+}
+
+SnapshotWriter::~SnapshotWriter() {
+	stop();
+}
+
+std::string SnapshotWriter::get_slot_path(size_t slot) const {
+	return path + "." + std::to_string(slot);
+}
+
+std::string SnapshotWriter::encode(const AnalyzerState& state) {
+	std::string payload;
+	append_binary(payload, state.timestamp);
+	append_binary(payload, state.journal_offset);
+	append_binary(payload, (uint32_t)state.assets.size());
+	for (auto&& [name, amount] : state.assets) {
+		append_name(payload, name);
+		append_binary(payload, amount);
+	}
+	append_binary(payload, (uint32_t)state.signal_counters.size());
+	for (auto&& [name, counter] : state.signal_counters) {
+		append_name(payload, name);
+		append_binary(payload, counter);
+	}
+	append_binary(payload, (uint32_t)state.last_records.size());
+	for (auto&& [name, record] : state.last_records) {
+		append_name(payload, name);
+		append_row(payload, record);
+	}
+	append_binary(payload, (uint32_t)state.dataset.size());
+	for (auto&& [name, rows] : state.dataset) {
+		append_name(payload, name);
+		append_binary(payload, (uint32_t)rows->size());
+		for (auto&& row : *rows) {
+			append_row(payload, row);
+		}
+	}
+	append_binary(payload, (uint32_t)state.transactions.size());
+	for (auto&& transaction : state.transactions) {
+		append_name(payload, transaction.symbol);
+		append_name(payload, transaction.action);
+		append_binary(payload, transaction.amount);
+		append_binary(payload, transaction.xrate);
+		append_name(payload, transaction.datetime);
+	}
+	return payload;
+}
+
+bool SnapshotWriter::decode(const std::string& payload, AnalyzerState& state) {
+	size_t offset = 0;
+	uint32_t count = 0;
+	if (!take_binary(payload, offset, state.timestamp)
+		|| !take_binary(payload, offset, state.journal_offset)
+		|| !take_count(payload, offset, count)) {
+		return false;
+	}
+	state.assets.resize(count);
+	for (auto&& [name, amount] : state.assets) {
+		if (!take_name(payload, offset, name) || !take_binary(payload, offset, amount)) {
+			return false;
+		}
+	}
+	if (!take_count(payload, offset, count)) {
+		return false;
+	}
+	state.signal_counters.resize(count);
+	for (auto&& [name, counter] : state.signal_counters) {
+		if (!take_name(payload, offset, name) || !take_binary(payload, offset, counter)) {
+			return false;
+		}
+	}
+	if (!take_count(payload, offset, count)) {
+		return false;
+	}
+	state.last_records.resize(count);
+	for (auto&& [name, record] : state.last_records) {
+		if (!take_name(payload, offset, name) || !take_row(payload, offset, record)) {
+			return false;
+		}
+	}
+	if (!take_count(payload, offset, count)) {
+		return false;
+	}
+	state.dataset.resize(count);
+	for (auto&& [name, rows] : state.dataset) {
+		uint32_t row_count = 0;
+		if (!take_name(payload, offset, name) || !take_count(payload, offset, row_count)) {
+			return false;
+		}
+		auto decoded = std::make_shared<std::deque<std::deque<double>>>(row_count);
+		for (auto&& row : *decoded) {
+			if (!take_row(payload, offset, row)) {
+				return false;
+			}
+		}
+		rows = std::move(decoded);
+	}
+	if (!take_count(payload, offset, count)) {
+		return false;
+	}
+	state.transactions.resize(count);
+	for (auto&& transaction : state.transactions) {
+		if (!take_name(payload, offset, transaction.symbol)
+			|| !take_name(payload, offset, transaction.action)
+			|| !take_binary(payload, offset, transaction.amount)
+			|| !take_binary(payload, offset, transaction.xrate)
+			|| !take_name(payload, offset, transaction.datetime)) {
+			return false;
+		}
+	}
+	return offset == payload.size();
+}
+
+std::optional<AnalyzerState> SnapshotWriter::read_slot(size_t slot, uint64_t& slot_sequence) const {
+	std::ifstream reader(get_slot_path(slot), std::ios::binary);
+	uint32_t magic = 0;
+	uint32_t size = 0;
+	uint32_t crc = 0;
+	bool has_header = reader
+		&& reader.read(reinterpret_cast<char*>(&magic), sizeof(magic)) && magic == snapshot_magic
+		&& reader.read(reinterpret_cast<char*>(&slot_sequence), sizeof(slot_sequence))
+		&& reader.read(reinterpret_cast<char*>(&size), sizeof(size))
+		&& reader.read(reinterpret_cast<char*>(&crc), sizeof(crc));
+	if (!has_header) {
+		return std::nullopt;
+	}
+	std::string payload(size, '\0');
+	AnalyzerState state;
+	if (!reader.read(payload.data(), size) || get_crc32(payload.data(), size) != crc
+		|| !decode(payload, state)) {
+		return std::nullopt;
+	}
+	return state;
+}
+
+std::optional<AnalyzerState> SnapshotWriter::load_latest() {
+	std::optional<AnalyzerState> latest;
+	for (size_t slot = 0; slot < 2; ++slot) {
+		uint64_t slot_sequence = 0;
+		auto&& state = read_slot(slot, slot_sequence);
+		if (state && (!latest || slot_sequence > sequence)) {
+			latest = std::move(state);
+			sequence = slot_sequence;
+		}
+	}
+	return latest;
+}
+
+void SnapshotWriter::submit(AnalyzerState&& state) {
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		std::swap(pending, state);
+		has_pending = true;
+	}
+	wake.notify_one();
+}
+
+void SnapshotWriter::stop() {
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		if (!running) {
+			return;
+		}
+		running = false;
+	}
+	wake.notify_one();
+	if (worker.joinable()) {
+		worker.join();
+	}
+}
+
+void SnapshotWriter::run() {
+	ThreadTuning tuning("journal", "snapshot");
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		wake.wait(lock, [this] { return has_pending || !running; });
+		if (!has_pending) {
+			break;
+		}
+		std::swap(pending, writing);
+		has_pending = false;
+		lock.unlock();
+		write(writing);
+		lock.lock();
+	}
+}
+
+void SnapshotWriter::write(const AnalyzerState& state) {
+	std::string payload = encode(state);
+	uint64_t next_sequence = sequence + 1;
+	// the slot of the previous snapshot is left intact
+	std::ofstream writer(get_slot_path(next_sequence % 2), std::ios::binary | std::ios::trunc);
+	uint32_t size = (uint32_t)payload.size();
+	uint32_t crc = get_crc32(payload.data(), payload.size());
+	writer.write(reinterpret_cast<const char*>(&snapshot_magic), sizeof(snapshot_magic));
+	writer.write(reinterpret_cast<const char*>(&next_sequence), sizeof(next_sequence));
+	writer.write(reinterpret_cast<const char*>(&size), sizeof(size));
+	writer.write(reinterpret_cast<const char*>(&crc), sizeof(crc));
+	writer.write(payload.data(), payload.size());
+	writer.flush();
+	if (!writer) {
+		print("Can't write the snapshot ", get_slot_path(next_sequence % 2), "\n");
+		return;
+	}
+	sequence = next_sequence;
+}
+
+#endif // !STATE_SNAPSHOT_DEFINITIONS
@@ -1,4 +1,5 @@
 #pragma once
+#include <span>
 
 /**
  * @brief A class which encapsulates calculations
@@ -7,19 +8,19 @@
 class StatsCalc {
 public:
 	// inline formulae
-	inline double get_moving_average(const std::vector<double>&) const;
+	inline double get_moving_average(std::span<const double>) const;
 	inline double get_exp_moving_average(double, double, size_t) const;
 	inline double get_rel_strength_index(double, double) const;
 
 	/**
 	 * @brief Calculates moving average on absolute values of input values.
 	 */
-	double get_moving_average_abs(const std::deque<double>&, bool) const;
+	double get_moving_average_abs(std::span<const double>, bool) const;
 
 	/**
 	 * @brief Calculates standard deviation
 	 */
-	double get_standard_deviation(const std::vector<double>&, double) const;
+	double get_standard_deviation(std::span<const double>, double) const;
 private:
 	StatsCalc() { }
 };
@@ -31,7 +32,7 @@ inline double StatsCalc::get_rel_strength_index(
 }
 
 inline double StatsCalc::get_moving_average(
-	const std::vector<double>& values
+	std::span<const double> values
 ) const {
 	if (values.empty()) {
 		return 0;
@@ -40,25 +41,29 @@ inline double StatsCalc::get_moving_average(
 }
 
 double StatsCalc::get_moving_average_abs(
-	const std::deque<double>& values, bool is_positive
+	std::span<const double> values, bool is_positive
 ) const {
-	std::vector<double> new_values;
+	if (values.empty()) {
+		return 0;
+	}
+	// summed in place (in the same order) - no copy of the values
+	double sum = 0.0;
 	for (auto&& val : values) {
 		if ((is_positive && val < 0) || (!is_positive && val > 0)) {
-			new_values.push_back(0);
+			sum += 0;
 		}
 		else if (val < 0) {
-			new_values.push_back(-1.0 * val);
+			sum += -1.0 * val;
 		}
 		else {
-			new_values.push_back(val);
+			sum += val;
 		}
 	}
-	return get_moving_average(new_values);
+	return sum / (double)values.size();
 }
 
 double StatsCalc::get_standard_deviation(
-	const std::vector<double>& values, double mean
+	std::span<const double> values, double mean
 ) const {
 	if (values.empty()) {
 		return 0;
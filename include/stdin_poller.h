@@ -0,0 +1,183 @@
+#pragma once
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TTM_STDIN_POLL
+#endif
+
+#ifdef TTM_STDIN_POLL
+
+#include <string>
+#include <iostream>
+#include <functional>
+#include <csignal>
+#include <cerrno>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "utilities.h"
+
+/**
+ * @brief Standard input as an event source of the main thread (POSIX)
+ * - poll() on fd 0 and on the read end of a self-pipe,
+ * complete lines are handed over right away (no reader thread)
+ * - the self-pipe wakes the loop up from anywhere (i.e. SIGINT/SIGTERM handler),
+ * a closed stdin is not polled anymore, the loop then waits for a wake-up only
+ * - fd 0 is left blocking (it may be shared with the shell),
+ * a single read() after POLLIN does not block
+ */
+class StdinPoller {
+public:
+	/**
+	 * @param handle_signals - SIGINT and SIGTERM wake the loop up instead of killing the process
+	 */
+	StdinPoller(bool handle_signals = true);
+	StdinPoller(const StdinPoller&) = delete;
+	StdinPoller& operator=(const StdinPoller&) = delete;
+	~StdinPoller();
+
+	/**
+	 * @brief Waits for the input and hands over the complete lines
+	 * @param on_line - returns false if the loop shall end (i.e. withdraw)
+	 * @returns false if the loop shall end (on_line said so or a wake-up came)
+	 */
+	bool poll_once(const std::function<bool(const std::string&)>& on_line);
+
+	/**
+	 * @brief Ends the loop - async-signal-safe.
+	 */
+	void wake();
+
+private:
+	static void on_signal(int);
+
+	/**
+	 * @brief Lines already buffered by std::cin (i.e. the watchlist was read by getline)
+	 * would never be seen by poll()
+	 * - requires std::ios::sync_with_stdio(false) before the first input
+	 */
+	void take_cin_buffer();
+
+	/**
+	 * @returns false if on_line ended the loop
+	 */
+	bool dispatch_lines(const std::function<bool(const std::string&)>& on_line);
+
+	// the signal handler needs a static target
+	static inline volatile std::sig_atomic_t signal_fd = -1;
+
+	int wake_pipe[2] = { -1, -1 };
+	bool is_stdin_open = true;
+	bool handle_signals;
+	std::string buffer;
+	struct sigaction previous_int {};
+	struct sigaction previous_term {};
+};
+
+#ifndef STDIN_POLLER_DEFINITIONS
+
+StdinPoller::StdinPoller(bool in_handle_signals) : handle_signals(in_handle_signals) {
+	if (pipe(wake_pipe) != 0) {
+		throw std::runtime_error("Can't create the wake-up pipe");
+	}
+	for (int fd : wake_pipe) {
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	}
+	if (handle_signals) {
+		signal_fd = wake_pipe[1];
+		struct sigaction action {};
+		action.sa_handler = &StdinPoller::on_signal;
+		sigemptyset(&action.sa_mask);
+		sigaction(SIGINT, &action, &previous_int);
+		sigaction(SIGTERM, &action, &previous_term);
+	}
+	take_cin_buffer();
+}
+
+StdinPoller::~StdinPoller() {
+	if (handle_signals) {
+		sigaction(SIGINT, &previous_int, nullptr);
+		sigaction(SIGTERM, &previous_term, nullptr);
+		signal_fd = -1;
+	}
+	close(wake_pipe[0]);
+	close(wake_pipe[1]);
+}
+
+void StdinPoller::on_signal(int) {
+	if (signal_fd >= 0) {
+		char byte = 1;
+		[[maybe_unused]] ssize_t written = write(signal_fd, &byte, 1);
+	}
+}
+
+void StdinPoller::wake() {
+	char byte = 1;
+	[[maybe_unused]] ssize_t written = write(wake_pipe[1], &byte, 1);
+}
+
+void StdinPoller::take_cin_buffer() {
+	std::streamsize available = std::cin.rdbuf()->in_avail();
+	if (available > 0) {
+		std::string pending((size_t)available, '\0');
+		std::cin.rdbuf()->sgetn(pending.data(), available);
+		buffer += pending;
+	}
+}
+
+bool StdinPoller::dispatch_lines(const std::function<bool(const std::string&)>& on_line) {
+	size_t start = 0;
+	for (size_t end = buffer.find('\n'); end != std::string::npos; end = buffer.find('\n', start)) {
+		std::string line = buffer.substr(start, end - start);
+		start = end + 1;
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+		if (!on_line(line)) {
+			buffer.erase(0, start);
+			return false;
+		}
+	}
+	buffer.erase(0, start);
+	return true;
+}
+
+bool StdinPoller::poll_once(const std::function<bool(const std::string&)>& on_line) {
+	if (!dispatch_lines(on_line)) {
+		return false;
+	}
+	pollfd fds[2] = {
+		{ wake_pipe[0], POLLIN, 0 },
+		{ STDIN_FILENO, POLLIN, 0 }
+	};
+	int ready = poll(fds, is_stdin_open ? 2 : 1, -1);
+	if (ready < 0) {
+		// a handled signal interrupts the call, its byte is in the pipe
+		return errno == EINTR;
+	}
+	if (fds[0].revents & POLLIN) {
+		return false;
+	}
+	if (is_stdin_open && (fds[1].revents & (POLLIN | POLLHUP | POLLERR))) {
+		char chunk[4096];
+		ssize_t count = read(STDIN_FILENO, chunk, sizeof(chunk));
+		if (count > 0) {
+			buffer.append(chunk, (size_t)count);
+			return dispatch_lines(on_line);
+		}
+		if (count == 0 || errno != EINTR) {
+			// the last line does not need to end with a newline
+			is_stdin_open = false;
+			if (!buffer.empty()) {
+				buffer += '\n';
+				return dispatch_lines(on_line);
+			}
+		}
+	}
+	return true;
+}
+
+#endif // !STDIN_POLLER_DEFINITIONS
+
+#endif // !TTM_STDIN_POLL
@@ -0,0 +1,264 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <limits>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * @brief Dense integer identification of a symbol (i.e. BTCUSDT)
+ * - assigned when the symbol is seen for the first time,
+ * ids are never reused, therefore they may index per-symbol vectors
+ */
+using SymbolId = uint32_t;
+
+/**
+ * @brief Symbol interning table
+ * - strings are needed only at the I/O edges (API responses,
+ * user input, files, console), the rest of the bot works with ids
+ * - thread safe (symbols are interned by the parse stage
+ * and looked up by the commands)
+ */
+class SymbolTable {
+public:
+	SymbolTable() { }
+	SymbolTable(const SymbolTable&) = delete;
+	SymbolTable& operator=(const SymbolTable&) = delete;
+
+	/**
+	 * @returns id of the symbol, a new one if the symbol has not been seen yet
+	 */
+	SymbolId intern(std::string_view symbol);
+
+	/**
+	 * @returns id of an already interned symbol
+	 */
+	std::optional<SymbolId> find(std::string_view symbol) const;
+
+	/**
+	 * @returns symbol of the id - the reference stays valid
+	 * (interned names are never moved)
+	 */
+	const std::string& get_name(SymbolId id) const;
+
+	size_t size() const;
+
+private:
+	mutable std::shared_mutex mutex;
+	std::deque<std::string> names;
+	std::unordered_map<std::string_view, SymbolId> ids;
+};
+
+/**
+ * @brief Per-symbol state indexed by SymbolId
+ * - lookups are plain array indexing (id -> position),
+ * values are kept densely for iteration (sparse set)
+ * - erasing moves the last value to the freed position,
+ * iteration order is therefore not stable across erase
+ * @tparam T - state of one symbol
+ */
+template <typename T>
+class SymbolMap {
+public:
+	/**
+	 * @brief Iterates over (id, value) pairs.
+	 */
+	template <typename Map, typename Value>
+	class basic_iterator {
+	public:
+		basic_iterator(Map* in_map, size_t in_index)
+			: map(in_map), index(in_index) { }
+		std::pair<SymbolId, Value&> operator*() const {
+			return { map->keys[index], map->values[index] };
+		}
+		basic_iterator& operator++() {
+			++index;
+			return *this;
+		}
+		bool operator==(const basic_iterator& other) const {
+			return index == other.index;
+		}
+		bool operator!=(const basic_iterator& other) const {
+			return index != other.index;
+		}
+	private:
+		Map* map;
+		size_t index;
+	};
+	using iterator = basic_iterator<SymbolMap, T>;
+	using const_iterator = basic_iterator<const SymbolMap, const T>;
+
+	/**
+	 * @returns value of the symbol, a default constructed one is inserted if missing
+	 */
+	T& operator[](SymbolId id);
+
+	/**
+	 * @throws std::out_of_range if the symbol has no value
+	 */
+	T& at(SymbolId id);
+	const T& at(SymbolId id) const;
+
+	/**
+	 * @returns nullptr if the symbol has no value
+	 */
+	T* find(SymbolId id);
+	const T* find(SymbolId id) const;
+
+	bool contains(SymbolId id) const;
+
+	/**
+	 * @returns false if the symbol had no value
+	 */
+	bool erase(SymbolId id);
+
+	void clear();
+	size_t size() const;
+	bool empty() const;
+
+	iterator begin() { return iterator(this, 0); }
+	iterator end() { return iterator(this, values.size()); }
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, values.size()); }
+
+private:
+	static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+	std::vector<T> values;
+	std::vector<SymbolId> keys; // keys[i] is the symbol of values[i]
+	std::vector<size_t> positions; // indexed by SymbolId
+};
+
+#ifndef SYMBOL_TABLE_DEFINITIONS
+
+SymbolId SymbolTable::intern(std::string_view symbol) {
+	{
+		std::shared_lock<std::shared_mutex> lock(mutex);
+		auto it = ids.find(symbol);
+		if (it != ids.end()) {
+			return it->second;
+		}
+	}
+	std::unique_lock<std::shared_mutex> lock(mutex);
+	auto it = ids.find(symbol);
+	if (it != ids.end()) { // interned in the meantime
+		return it->second;
+	}
+	SymbolId id = (SymbolId)names.size();
+	names.emplace_back(symbol);
+	// the key views the stored name (deque elements are never moved)
+	ids.emplace(names.back(), id);
+	return id;
+}
+
+std::optional<SymbolId> SymbolTable::find(std::string_view symbol) const {
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	auto it = ids.find(symbol);
+	if (it == ids.end()) {
+		return std::nullopt;
+	}
+	return it->second;
+}
+
+const std::string& SymbolTable::get_name(SymbolId id) const {
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	return names.at(id);
+}
+
+size_t SymbolTable::size() const {
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	return names.size();
+}
+
+#endif // !SYMBOL_TABLE_DEFINITIONS
+
+#ifndef SYMBOL_MAP_DEFINITIONS
+
+template <typename T>
+T& SymbolMap<T>::operator[](SymbolId id) {
+	if (id >= positions.size()) {
+		positions.resize((size_t)id + 1, npos);
+	}
+	if (positions[id] == npos) {
+		positions[id] = values.size();
+		values.emplace_back();
+		keys.push_back(id);
+	}
+	return values[positions[id]];
+}
+
+template <typename T>
+T& SymbolMap<T>::at(SymbolId id) {
+	T* value = find(id);
+	if (value == nullptr) {
+		throw std::out_of_range("Unknown symbol id: " + std::to_string(id));
+	}
+	return *value;
+}
+
+template <typename T>
+const T& SymbolMap<T>::at(SymbolId id) const {
+	const T* value = find(id);
+	if (value == nullptr) {
+		throw std::out_of_range("Unknown symbol id: " + std::to_string(id));
+	}
+	return *value;
+}
+
+template <typename T>
+T* SymbolMap<T>::find(SymbolId id) {
+	return contains(id) ? &values[positions[id]] : nullptr;
+}
+
+template <typename T>
+const T* SymbolMap<T>::find(SymbolId id) const {
+	return contains(id) ? &values[positions[id]] : nullptr;
+}
+
+template <typename T>
+bool SymbolMap<T>::contains(SymbolId id) const {
+	return id < positions.size() && positions[id] != npos;
+}
+
+template <typename T>
+bool SymbolMap<T>::erase(SymbolId id) {
+	if (!contains(id)) {
+		return false;
+	}
+	size_t position = positions[id];
+	size_t last = values.size() - 1;
+	if (position != last) {
+		values[position] = std::move(values[last]);
+		keys[position] = keys[last];
+		positions[keys[position]] = position;
+	}
+	values.pop_back();
+	keys.pop_back();
+	positions[id] = npos;
+	return true;
+}
+
+template <typename T>
+void SymbolMap<T>::clear() {
+	values.clear();
+	keys.clear();
+	positions.clear();
+}
+
+template <typename T>
+size_t SymbolMap<T>::size() const {
+	return values.size();
+}
+
+template <typename T>
+bool SymbolMap<T>::empty() const {
+	return values.empty();
+}
+
+#endif // !SYMBOL_MAP_DEFINITIONS
@@ -0,0 +1,334 @@
+#pragma once
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#ifdef __linux__
+#define TTM_THREAD_TUNING
+#include <cstring>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#endif // !__linux__
+
+#include "utilities.h"
+
+/**
+ * @brief Placement of the threads of a role
+ * - TTM_AFFINITY_<ROLE>: cores the threads may run on (e.g. 2 or 0,2-3)
+ * - TTM_PRIORITY_<ROLE>: SCHED_FIFO priority 1-99 (requires CAP_SYS_NICE)
+ * - roles: INGEST (tick timer, parser), ANALYSIS (analysis, shards),
+ * JOURNAL (journal and snapshot writers), EXECUTOR (downloads), CONSOLE (input)
+ */
+struct ThreadPlacement {
+	std::vector<int> cpus; // empty - any core
+	int fifo_priority = 0; // 0 - the default scheduler
+};
+
+/**
+ * @brief CPU time and context switches of an engine thread
+ */
+struct ThreadUsage {
+	std::string role;
+	std::string name;
+	std::string placement; // as applied
+	std::chrono::microseconds cpu_time = std::chrono::microseconds(0); // user + system
+	long voluntary_switches = -1; // -1 if unknown
+	long involuntary_switches = -1;
+	bool is_running = true;
+};
+
+/**
+ * @brief Registers the calling thread for its lifetime and applies the placement of its role
+ * - affinity and priorities are applied on Linux only, elsewhere the threads are just listed
+ * - the usage of a finished thread is taken by the thread itself (RUSAGE_THREAD) upon leaving
+ */
+class ThreadTuning {
+public:
+	ThreadTuning(const std::string& role, const std::string& name);
+
+	/**
+	 * @brief A member of a role which spreads over the cores (i.e. the analysis shards)
+	 * - pinned to a single core of the role, the member-th one (wrapping around the list)
+	 */
+	ThreadTuning(const std::string& role, const std::string& name, size_t member);
+	ThreadTuning(const ThreadTuning&) = delete;
+	ThreadTuning& operator=(const ThreadTuning&) = delete;
+	~ThreadTuning();
+
+private:
+	void register_thread(const std::string& role, const std::string& name, const ThreadPlacement& placement);
+
+	size_t slot;
+};
+
+/**
+ * @returns usage of every thread registered so far (in the order of their start)
+ */
+std::vector<ThreadUsage> get_thread_usage();
+
+#ifndef THREAD_TUNING_DEFINITIONS
+
+/**
+ * @brief Registered threads - a thread keeps its slot, finished ones stay listed
+ */
+struct ThreadRegistry {
+	struct Entry {
+		ThreadUsage usage;
+		long tid = -1;
+	};
+
+	std::mutex mutex;
+	std::vector<Entry> entries;
+	std::vector<std::string> warned_roles; // a failing placement is reported once per role
+};
+
+inline static ThreadRegistry& get_thread_registry() {
+	// never destroyed - threads of the globals (i.e. the journal writer) leave after main
+	static auto* registry = new ThreadRegistry;
+	return *registry;
+}
+
+inline static std::string to_env_role(const std::string& role) {
+	std::string result = role;
+	std::transform(result.begin(), result.end(), result.begin(),
+		[](unsigned char c) { return (char)std::toupper(c); }
+	);
+	return result;
+}
+
+/**
+ * @param configured - comma separated cores or ranges, e.g. 0,2-3
+ * @throws std::invalid_argument on a malformed list
+ */
+std::vector<int> parse_cpu_list(const std::string& configured) {
+	std::vector<int> cpus;
+	for (auto&& token : tokenize(configured, ',')) {
+		size_t dash = token.find('-');
+		int first = convert_string_to<int>(token.substr(0, dash));
+		int last = dash == std::string::npos ? first : convert_string_to<int>(token.substr(dash + 1));
+		if (first < 0 || last < first) {
+			throw std::invalid_argument("invalid core range " + token);
+		}
+		for (int cpu = first; cpu <= last; ++cpu) {
+			cpus.push_back(cpu);
+		}
+	}
+	return cpus;
+}
+
+ThreadPlacement get_thread_placement(const std::string& role) {
+	ThreadPlacement placement;
+	std::string env_role = to_env_role(role);
+	std::string affinity_key = "TTM_AFFINITY_" + env_role;
+	std::string priority_key = "TTM_PRIORITY_" + env_role;
+	const char* affinity = std::getenv(affinity_key.c_str());
+	const char* priority = std::getenv(priority_key.c_str());
+	try {
+		if (affinity != nullptr && *affinity != '\0') {
+			placement.cpus = parse_cpu_list(affinity);
+		}
+		if (priority != nullptr && *priority != '\0') {
+			placement.fifo_priority = std::clamp(convert_string_to<int>(priority), 0, 99);
+		}
+	}
+	catch (std::invalid_argument& exc) {
+		print(affinity_key, "/", priority_key, ": ", exc.what(), "\n");
+	}
+	return placement;
+}
+
+/**
+ * @returns placement of the role narrowed to the member-th core of its list
+ */
+ThreadPlacement get_member_placement(const std::string& role, size_t member) {
+	ThreadPlacement placement = get_thread_placement(role);
+	if (!placement.cpus.empty()) {
+		placement.cpus = { placement.cpus[member % placement.cpus.size()] };
+	}
+	return placement;
+}
+
+/**
+ * @brief Pins the calling thread and sets its scheduler
+ * @returns description of what has been applied, failures are added to errors
+ */
+std::string apply_thread_placement(const ThreadPlacement& placement, std::string& errors) {
+	std::string applied;
+#ifdef TTM_THREAD_TUNING
+	if (!placement.cpus.empty()) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		std::string cores;
+		for (int cpu : placement.cpus) {
+			CPU_SET(cpu, &set);
+			if (!cores.empty()) {
+				cores += ',';
+			}
+			cores += std::to_string(cpu);
+		}
+		int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+		if (result == 0) {
+			applied += "cores " + cores;
+		}
+		else {
+			errors += "affinity: " + std::string(std::strerror(result)) + " ";
+		}
+	}
+	if (placement.fifo_priority > 0) {
+		sched_param param {};
+		param.sched_priority = placement.fifo_priority;
+		int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		if (result == 0) {
+			if (!applied.empty()) {
+				applied += ", ";
+			}
+			applied += "fifo " + std::to_string(placement.fifo_priority);
+		}
+		else {
+			errors += "SCHED_FIFO: " + std::string(std::strerror(result)) + " ";
+		}
+	}
+#else
+	if (!placement.cpus.empty() || placement.fifo_priority > 0) {
+		errors += "not supported on this platform ";
+	}
+#endif // !TTM_THREAD_TUNING
+	return applied.empty() ? "default" : applied;
+}
+
+#ifdef TTM_THREAD_TUNING
+
+/**
+ * @brief Usage of a running thread of this process (any thread may ask)
+ */
+void read_task_usage(long tid, ThreadUsage& usage) {
+	std::string task = "/proc/self/task/" + std::to_string(tid);
+	std::ifstream stat_file(task + "/stat");
+	std::string stat;
+	if (std::getline(stat_file, stat)) {
+		// the name in the parentheses may contain spaces - fields are counted after it
+		std::istringstream fields(stat.substr(stat.rfind(')') + 2));
+		std::string field;
+		long long utime = 0;
+		long long stime = 0;
+		// state is the 3rd field, utime the 14th, stime the 15th
+		for (int index = 3; index <= 15 && fields >> field; ++index) {
+			if (index == 14) {
+				utime = std::stoll(field);
+			}
+			else if (index == 15) {
+				stime = std::stoll(field);
+			}
+		}
+		long long ticks_per_second = sysconf(_SC_CLK_TCK);
+		usage.cpu_time = std::chrono::microseconds((utime + stime) * 1'000'000 / ticks_per_second);
+	}
+	std::ifstream status_file(task + "/status");
+	std::string line;
+	while (std::getline(status_file, line)) {
+		if (line.rfind("voluntary_ctxt_switches:", 0) == 0) {
+			usage.voluntary_switches = std::stol(line.substr(line.find(':') + 1));
+		}
+		else if (line.rfind("nonvoluntary_ctxt_switches:", 0) == 0) {
+			usage.involuntary_switches = std::stol(line.substr(line.find(':') + 1));
+		}
+	}
+}
+
+/**
+ * @brief Usage of the calling thread
+ */
+void read_own_usage(ThreadUsage& usage) {
+	rusage own {};
+	if (getrusage(RUSAGE_THREAD, &own) == 0) {
+		usage.cpu_time = std::chrono::seconds(own.ru_utime.tv_sec + own.ru_stime.tv_sec)
+			+ std::chrono::microseconds(own.ru_utime.tv_usec + own.ru_stime.tv_usec);
+		usage.voluntary_switches = own.ru_nvcsw;
+		usage.involuntary_switches = own.ru_nivcsw;
+	}
+}
+
+#endif // !TTM_THREAD_TUNING
+
+ThreadTuning::ThreadTuning(const std::string& role, const std::string& name) {
+	register_thread(role, name, get_thread_placement(role));
+}
+
+ThreadTuning::ThreadTuning(const std::string& role, const std::string& name, size_t member) {
+	register_thread(role, name, get_member_placement(role, member));
+}
+
+void ThreadTuning::register_thread(const std::string& role, const std::string& name, const ThreadPlacement& placement) {
+	std::string errors;
+	std::string applied = apply_thread_placement(placement, errors);
+	auto&& registry = get_thread_registry();
+	std::lock_guard<std::mutex> guard(registry.mutex);
+	slot = registry.entries.size();
+	ThreadRegistry::Entry entry;
+	entry.usage.role = role;
+	entry.usage.name = name;
+	entry.usage.placement = applied;
+#ifdef TTM_THREAD_TUNING
+	entry.tid = (long)syscall(SYS_gettid);
+#endif // !TTM_THREAD_TUNING
+	registry.entries.push_back(std::move(entry));
+	auto&& warned = registry.warned_roles;
+	if (!errors.empty() && std::find(warned.begin(), warned.end(), role) == warned.end()) {
+		warned.push_back(role);
+		print("Placement of the ", role, " threads failed: ", errors, "\n");
+	}
+}
+
+ThreadTuning::~ThreadTuning() {
+	auto&& registry = get_thread_registry();
+	std::lock_guard<std::mutex> guard(registry.mutex);
+	auto&& usage = registry.entries.at(slot).usage;
+#ifdef TTM_THREAD_TUNING
+	read_own_usage(usage);
+#endif // !TTM_THREAD_TUNING
+	usage.is_running = false;
+}
+
+std::vector<ThreadUsage> get_thread_usage() {
+	auto&& registry = get_thread_registry();
+	std::lock_guard<std::mutex> guard(registry.mutex);
+	std::vector<ThreadUsage> result;
+	result.reserve(registry.entries.size());
+	for (auto&& entry : registry.entries) {
+		result.push_back(entry.usage);
+#ifdef TTM_THREAD_TUNING
+		if (entry.usage.is_running) {
+			read_task_usage(entry.tid, result.back());
+		}
+#endif // !TTM_THREAD_TUNING
+	}
+	return result;
+}
+
+#endif // !THREAD_TUNING_DEFINITIONS
+
+#ifndef THREAD_TUNING_PRINT_FUNCTIONS
+
+inline static void print_thread_usage(const std::vector<ThreadUsage>& threads) {
+	print("Threads (CPU time, voluntary/involuntary context switches):\n");
+	for (auto&& thread : threads) {
+		print("[", thread.role, "/", thread.name, thread.is_running ? "" : " (finished)", "] ",
+			std::chrono::duration_cast<ms>(thread.cpu_time).count(), " ms, ");
+		if (thread.voluntary_switches >= 0) {
+			print(thread.voluntary_switches, "/", thread.involuntary_switches, " switches");
+		}
+		else {
+			print("switches n/a");
+		}
+		print(" - ", thread.placement, "\n");
+	}
+}
+
+#endif // !THREAD_TUNING_PRINT_FUNCTIONS
@@ -0,0 +1,110 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <memory_resource>
+
+#ifndef ALLOCATION_COUNTERS
+
+/**
+ * @brief Heap allocations (global operator new, counted if the executable includes allocation_counting.h)
+ * - heap_allocations: all threads of the process
+ * - thread_heap_allocations: the calling thread only (i.e. one tick of the analysis)
+ */
+std::atomic<uint64_t> heap_allocations(0);
+thread_local uint64_t thread_heap_allocations = 0;
+
+/**
+ * @brief Heap allocations of a part of the tick (i.e. the indicators, the whole tick)
+ */
+struct AllocationStats {
+	size_t ticks = 0;
+	size_t allocating_ticks = 0; // ticks which allocated at all (i.e. trades, snapshots, warm-up)
+	uint64_t last_tick = 0; // allocations of the latest tick
+	uint64_t last_tick_shards = 0; // of those on the shard threads
+	uint64_t total = 0;
+	size_t arena_bytes = 0; // capacity of all the arenas
+
+	void add_tick(uint64_t allocations) {
+		++ticks;
+		allocating_ticks += allocations > 0 ? 1 : 0;
+		last_tick = allocations;
+		total += allocations;
+	}
+};
+
+#endif // !ALLOCATION_COUNTERS
+
+/**
+ * @brief Monotonic arena of short-lived temporaries (pmr containers)
+ * - allocating is a pointer bump, nothing is freed until reset()
+ * - the buffer grows when it has not sufficed (the overflow is taken from the heap meanwhile),
+ * once it fits the peak the arena does not touch the heap anymore
+ * - not thread-safe, one arena per thread (shard)
+ */
+class TickArena {
+public:
+	TickArena(size_t initial_capacity = 4096);
+	TickArena(const TickArena&) = delete;
+	TickArena& operator=(const TickArena&) = delete;
+
+	std::pmr::memory_resource* get_resource() { return &*arena; }
+
+	/**
+	 * @brief Frees everything allocated since the previous reset
+	 * - the memory of the containers from the arena must not be used afterwards
+	 */
+	void reset();
+
+	size_t get_capacity() const { return capacity; }
+
+private:
+	/**
+	 * @brief Heap behind the arena, counts what it is asked for
+	 */
+	class Overflow : public std::pmr::memory_resource {
+	public:
+		size_t taken = 0;
+
+	private:
+		void* do_allocate(size_t bytes, size_t alignment) override {
+			taken += bytes;
+			return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+		}
+		void do_deallocate(void* pointer, size_t bytes, size_t alignment) override {
+			std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+		}
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+			return this == &other;
+		}
+	};
+
+	size_t capacity;
+	std::unique_ptr<std::byte[]> buffer;
+	Overflow overflow;
+	std::optional<std::pmr::monotonic_buffer_resource> arena;
+};
+
+#ifndef TICK_ARENA_DEFINITIONS
+
+TickArena::TickArena(size_t initial_capacity)
+	: capacity(initial_capacity), buffer(new std::byte[initial_capacity]) {
+	arena.emplace(buffer.get(), capacity, &overflow);
+}
+
+void TickArena::reset() {
+	// the arena starts from the beginning of its buffer again
+	arena->release();
+	if (overflow.taken == 0) {
+		return;
+	}
+	capacity += overflow.taken;
+	overflow.taken = 0;
+	arena.reset();
+	buffer.reset(new std::byte[capacity]);
+	arena.emplace(buffer.get(), capacity, &overflow);
+}
+
+#endif // !TICK_ARENA_DEFINITIONS
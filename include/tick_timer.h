@@ -0,0 +1,176 @@
+#pragma once
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+#include "utilities.h"
+#include "thread_tuning.h"
+
+using steady_clock = std::chrono::steady_clock;
+using us = std::chrono::microseconds;
+
+/**
+ * @brief Info handed over to a tick of the timer.
+ */
+struct TickInfo {
+	size_t index = 0;
+	bool is_minute_boundary = false; // the tick is aligned to a wall-clock minute
+	us lateness = us(0); // wake-up after the deadline
+};
+
+/**
+ * @brief Scheduling quality of the timer.
+ */
+struct TimerStats {
+	size_t ticks = 0;
+	size_t overruns = 0; // ticks which were due before the previous one ended
+	us mean_lateness = us(0);
+	us max_lateness = us(0);
+	us mean_overhead = us(0); // time spent in the tick
+	us max_overhead = us(0);
+};
+
+/**
+ * @brief Long-lived worker which runs ticks on a monotonic timer
+ * - deadlines are absolute (previous deadline + interval),
+ * the time spent in a tick or a late wake-up does not accumulate drift
+ * - a deadline which crosses a wall-clock minute is moved to the minute,
+ * such tick is marked as a minute boundary (i.e. the dataset is extended)
+ * - a tick which is overdue when the previous one ends is run right away
+ * and the schedule restarts from it (no burst of ticks)
+ */
+class TickTimer {
+public:
+	/**
+	 * @param in_on_tick - called on the worker thread
+	 * @param in_next_interval - called after every tick, interval to the next one
+	 */
+	TickTimer(const std::function<void(const TickInfo&)>& in_on_tick,
+		const std::function<ms()>& in_next_interval);
+	TickTimer(const TickTimer&) = delete;
+	TickTimer& operator=(const TickTimer&) = delete;
+	~TickTimer();
+
+	/**
+	 * @brief Stops the worker (the running tick is finished).
+	 */
+	void stop();
+
+	TimerStats get_stats() const;
+
+private:
+	void run();
+
+	/**
+	 * @returns steady time of the first wall-clock minute after now
+	 * (at least a second away - the current minute's tick is not repeated)
+	 */
+	static steady_clock::time_point get_next_minute(const steady_clock::time_point& now);
+
+	void record(us lateness, us overhead);
+
+	std::function<void(const TickInfo&)> on_tick;
+	std::function<ms()> next_interval;
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	bool running;
+	TimerStats stats;
+	us total_lateness;
+	us total_overhead;
+	std::thread worker;
+};
+
+#ifndef TICK_TIMER_DEFINITIONS
+
+TickTimer::TickTimer(
+	const std::function<void(const TickInfo&)>& in_on_tick,
+	const std::function<ms()>& in_next_interval
+) : on_tick(in_on_tick), next_interval(in_next_interval), running(true),
+	total_lateness(0), total_overhead(0) {
+	worker = std::thread(&TickTimer::run, this);
+}
+
+TickTimer::~TickTimer() {
+	stop();
+}
+
+void TickTimer::stop() {
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		running = false;
+	}
+	wake.notify_all();
+	if (worker.joinable()) {
+		worker.join();
+	}
+}
+
+steady_clock::time_point TickTimer::get_next_minute(const steady_clock::time_point& now) {
+	// the wall clock is read again every time (NTP adjustments)
+	sys_clock::time_point wall_now = sys_clock::now();
+	auto&& minute = std::chrono::ceil<std::chrono::minutes>(wall_now + std::chrono::seconds(1));
+	return now + std::chrono::duration_cast<steady_clock::duration>(minute - wall_now);
+}
+
+void TickTimer::record(us lateness, us overhead) {
+	std::lock_guard<std::mutex> guard(mutex);
+	++stats.ticks;
+	total_lateness += lateness;
+	total_overhead += overhead;
+	stats.max_lateness = std::max(stats.max_lateness, lateness);
+	stats.max_overhead = std::max(stats.max_overhead, overhead);
+}
+
+TimerStats TickTimer::get_stats() const {
+	std::lock_guard<std::mutex> guard(mutex);
+	TimerStats result = stats;
+	if (stats.ticks > 0) {
+		result.mean_lateness = total_lateness / (us::rep)stats.ticks;
+		result.mean_overhead = total_overhead / (us::rep)stats.ticks;
+	}
+	return result;
+}
+
+void TickTimer::run() {
+	ThreadTuning tuning("ingest", "timer");
+	steady_clock::time_point deadline = steady_clock::now();
+	steady_clock::time_point next_minute = get_next_minute(deadline);
+	bool is_minute_boundary = false;
+	for (size_t index = 0; ; ++index) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			if (wake.wait_until(lock, deadline, [this] { return !running; })) {
+				break;
+			}
+		}
+		steady_clock::time_point woken = steady_clock::now();
+		us lateness = std::chrono::duration_cast<us>(woken - deadline);
+		on_tick({ index, is_minute_boundary, lateness });
+		steady_clock::time_point done = steady_clock::now();
+		record(lateness, std::chrono::duration_cast<us>(done - woken));
+
+		steady_clock::time_point next = deadline + next_interval();
+		if (next < done) {
+			std::lock_guard<std::mutex> guard(mutex);
+			++stats.overruns;
+			next = done;
+		}
+		// a minute passed during a long tick - its tick is run right away
+		bool is_minute_missed = !is_minute_boundary && done >= next_minute;
+		if (is_minute_boundary || is_minute_missed) {
+			next_minute = get_next_minute(done);
+		}
+		if (is_minute_missed) {
+			is_minute_boundary = true;
+			deadline = done;
+		}
+		else {
+			is_minute_boundary = next >= next_minute;
+			deadline = is_minute_boundary ? next_minute : next;
+		}
+	}
+}
+
+#endif // !TICK_TIMER_DEFINITIONS
@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include <string_view>
+
+#include "symbol_table.h"
+
+/**
+ * @brief Learned order of the full-market ticker response
+ * - the exchange lists the symbols in the same order every time,
+ * therefore the symbol at a position is only verified (a short comparison)
+ * and its id is taken from the previous response
+ * - the symbol table is consulted (hashing, locking) only for positions
+ * whose symbol has changed (listing, delisting)
+ */
+class TickerLayout {
+public:
+	TickerLayout() : relearned(0) { }
+
+	/**
+	 * @param position - index of the record in the response
+	 * @param symbol - symbol of the record
+	 * @returns id of the symbol
+	 */
+	SymbolId resolve(size_t position, std::string_view symbol, SymbolTable& table);
+
+	/**
+	 * @brief Ends a response of the given length (the rest of the layout is dropped)
+	 * @returns number of positions which had to be relearned during the response
+	 */
+	size_t finish(size_t count);
+
+	size_t size() const;
+
+private:
+	/**
+	 * @brief Interned name (stable view) and id of the symbol at each position.
+	 */
+	std::vector<std::pair<std::string_view, SymbolId>> slots;
+	size_t relearned;
+};
+
+#ifndef TICKER_LAYOUT_DEFINITIONS
+
+SymbolId TickerLayout::resolve(size_t position, std::string_view symbol, SymbolTable& table) {
+	if (position < slots.size() && slots[position].first == symbol) {
+		return slots[position].second;
+	}
+	++relearned;
+	SymbolId id = table.intern(symbol);
+	if (position >= slots.size()) {
+		slots.resize(position + 1);
+	}
+	slots[position] = { table.get_name(id), id };
+	return id;
+}
+
+size_t TickerLayout::finish(size_t count) {
+	if (count < slots.size()) {
+		slots.resize(count);
+	}
+	size_t result = relearned;
+	relearned = 0;
+	return result;
+}
+
+size_t TickerLayout::size() const {
+	return slots.size();
+}
+
+#endif // !TICKER_LAYOUT_DEFINITIONS
@@ -0,0 +1,550 @@
+#pragma once
+#include <bit>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <shared_mutex>
+
+#include "utilities.h"
+#include "record_log.h"
+#include "symbol_table.h"
+#include "journal_writer.h"
+
+/**
+ * @brief Gorilla compressed block of (timestamp, value) points
+ * - the first point is stored as is (64 + 64 bits)
+ * - timestamps (ms) as delta of deltas:
+ * '0' (same delta), '10' + 7 bits, '110' + 12 bits, '1110' + 20 bits, '1111' + 64 bits
+ * - values as XOR with the previous value:
+ * '0' (same value), '10' + meaningful bits within the previous window,
+ * '11' + 5 bits leading zeros + 6 bits length + meaningful bits
+ * @see https://www.vldb.org/pvldb/vol8/p1816-teller.pdf
+ */
+struct SeriesBlock {
+	int64_t first_time = 0;
+	int64_t last_time = 0;
+	uint32_t count = 0;
+	uint64_t bit_count = 0;
+	std::vector<uint64_t> words;
+};
+
+/**
+ * @brief Decompresses the points of a block one by one.
+ */
+class BlockDecoder {
+public:
+	BlockDecoder(const SeriesBlock& in_block)
+		: block(in_block), position(0), index(0),
+		time(0), delta(0), bits(0), leading(0), trailing(0) { }
+
+	/**
+	 * @returns false once all the points have been read
+	 */
+	bool next(int64_t& out_time, double& out_value);
+
+private:
+	uint64_t read(unsigned length);
+
+	const SeriesBlock& block;
+	uint64_t position; // bit position
+	uint32_t index; // point index
+	int64_t time;
+	int64_t delta;
+	uint64_t bits;
+	unsigned leading;
+	unsigned trailing;
+};
+
+/**
+ * @brief History of one symbol - sealed blocks and the block being appended to
+ * - blocks are ordered by time, a range scan decompresses only
+ * the blocks which overlap the range
+ */
+class TimeSeries {
+public:
+	TimeSeries() : prev_delta(0), prev_bits(0), prev_leading(no_window), prev_trailing(0) { }
+
+	/**
+	 * @brief Appends a point (points older than the last one are ignored)
+	 * @param block_capacity - points of a block before it is sealed
+	 * @returns whether a block has been sealed (the last of get_sealed)
+	 */
+	bool append(int64_t timestamp, double value, uint32_t block_capacity);
+
+	/**
+	 * @brief Adds a sealed block (i.e. loaded from the disk).
+	 */
+	void add_sealed(SeriesBlock&& block);
+
+	/**
+	 * @brief Seals the current block (if it is not empty)
+	 * @returns whether a block has been sealed
+	 */
+	bool seal();
+
+	/**
+	 * @brief Calls fn(timestamp, value) for the points in [from, to], oldest first.
+	 */
+	void scan(int64_t from, int64_t to, const std::function<void(int64_t, double)>& fn) const;
+
+	const std::vector<SeriesBlock>& get_sealed() const;
+	size_t get_point_count() const;
+	size_t get_memory_usage() const;
+	std::optional<std::pair<int64_t, int64_t>> get_time_range() const;
+
+private:
+	void write(uint64_t value, unsigned length);
+	static void scan_block(const SeriesBlock& block, int64_t from, int64_t to,
+		const std::function<void(int64_t, double)>& fn);
+
+	static constexpr unsigned no_window = 65;
+
+	std::vector<SeriesBlock> sealed;
+	SeriesBlock current;
+	// encoder state of the current block
+	int64_t prev_delta;
+	uint64_t prev_bits;
+	unsigned prev_leading;
+	unsigned prev_trailing;
+};
+
+/**
+ * @brief Compressed tick history of the symbols (in memory and on the disk)
+ * - sealed blocks are appended to <dir>/prices.tsb by a background writer
+ * (records framed as in record_log.h), the blocks being filled are sealed
+ * and written upon destruction
+ * - all the stored history is loaded upon the start
+ * - thread safe (appended by the analysis, scanned by the commands)
+ */
+class TimeSeriesStore {
+public:
+	TimeSeriesStore(const std::shared_ptr<SymbolTable>& in_symbol_table,
+		const std::string& in_dir = "history", uint32_t in_block_capacity = 1024)
+		: symbol_table(in_symbol_table), dir(in_dir), block_capacity(in_block_capacity) { }
+	TimeSeriesStore(const TimeSeriesStore&) = delete;
+	TimeSeriesStore& operator=(const TimeSeriesStore&) = delete;
+	~TimeSeriesStore();
+
+	/**
+	 * @brief Loads the stored history and opens the file for appending
+	 * @returns number of loaded points
+	 */
+	size_t load();
+
+	void append(SymbolId symbol, int64_t timestamp, double value);
+
+	/**
+	 * @brief Appends the quotes of a tick (the columns of a token table) under a single lock
+	 * - only the quotes updated at the timestamp (updates[i] == timestamp) are taken,
+	 * stale and not yet priced (zero) values are skipped
+	 * @returns number of appended points
+	 */
+	size_t append_tick(int64_t timestamp, const std::vector<SymbolId>& symbols,
+		const std::vector<double>& values, const std::vector<int64_t>& updates);
+
+	/**
+	 * @brief Calls fn(timestamp, value) for the points of a symbol in [from, to], oldest first.
+	 */
+	void scan(SymbolId symbol, int64_t from, int64_t to,
+		const std::function<void(int64_t, double)>& fn) const;
+
+	size_t get_point_count(SymbolId symbol) const;
+	std::optional<std::pair<int64_t, int64_t>> get_time_range(SymbolId symbol) const;
+
+	/**
+	 * @returns bytes taken by the compressed points of all the symbols
+	 */
+	size_t get_memory_usage() const;
+
+private:
+	std::string get_path() const;
+	void persist(SymbolId symbol, const SeriesBlock& block);
+
+	static constexpr uint32_t max_payload = 1 << 20;
+
+	std::shared_ptr<SymbolTable> symbol_table;
+	std::string dir;
+	uint32_t block_capacity;
+	mutable std::shared_mutex mutex;
+	SymbolMap<TimeSeries> series;
+	std::unique_ptr<JournalWriter> writer;
+};
+
+#ifndef TIME_SERIES_DEFINITIONS
+
+inline static uint64_t low_bits_mask(unsigned length) {
+	return length >= 64 ? ~0ULL : (1ULL << length) - 1;
+}
+
+inline static bool fits_signed(int64_t value, unsigned length) {
+	return value >= -(1LL << (length - 1)) && value < (1LL << (length - 1));
+}
+
+inline static int64_t sign_extend(uint64_t value, unsigned length) {
+	if (length >= 64) {
+		return (int64_t)value;
+	}
+	uint64_t sign = 1ULL << (length - 1);
+	return (int64_t)((value ^ sign) - sign);
+}
+
+uint64_t BlockDecoder::read(unsigned length) {
+	if (length == 0) {
+		return 0;
+	}
+	size_t word = position / 64;
+	unsigned available = 64 - (unsigned)(position % 64);
+	uint64_t result = 0;
+	if (length <= available) {
+		result = (block.words[word] >> (available - length)) & low_bits_mask(length);
+	}
+	else {
+		unsigned rest = length - available;
+		result = ((block.words[word] & low_bits_mask(available)) << rest)
+			| (block.words[word + 1] >> (64 - rest));
+	}
+	position += length;
+	return result;
+}
+
+bool BlockDecoder::next(int64_t& out_time, double& out_value) {
+	if (index >= block.count) {
+		return false;
+	}
+	if (index == 0) {
+		time = (int64_t)read(64);
+		bits = read(64);
+	}
+	else {
+		unsigned length = 0;
+		if (read(1) == 0) {
+			length = 0;
+		}
+		else if (read(1) == 0) {
+			length = 7;
+		}
+		else if (read(1) == 0) {
+			length = 12;
+		}
+		else if (read(1) == 0) {
+			length = 20;
+		}
+		else {
+			length = 64;
+		}
+		if (length > 0) {
+			delta += sign_extend(read(length), length);
+		}
+		time += delta;
+		if (read(1) == 1) {
+			if (read(1) == 1) {
+				leading = (unsigned)read(5);
+				unsigned meaningful = (unsigned)read(6);
+				trailing = 64 - leading - (meaningful == 0 ? 64 : meaningful);
+			}
+			bits ^= read(64 - leading - trailing) << trailing;
+		}
+	}
+	++index;
+	out_time = time;
+	std::memcpy(&out_value, &bits, sizeof(bits));
+	return true;
+}
+
+void TimeSeries::write(uint64_t value, unsigned length) {
+	if (length == 0) {
+		return;
+	}
+	value &= low_bits_mask(length);
+	unsigned offset = (unsigned)(current.bit_count % 64);
+	if (offset == 0) {
+		current.words.push_back(0);
+	}
+	unsigned available = 64 - offset;
+	if (length <= available) {
+		current.words.back() |= value << (available - length);
+	}
+	else {
+		unsigned rest = length - available;
+		current.words.back() |= value >> rest;
+		current.words.push_back(value << (64 - rest));
+	}
+	current.bit_count += length;
+}
+
+bool TimeSeries::append(int64_t timestamp, double value, uint32_t block_capacity) {
+	if (current.count > 0 ? timestamp < current.last_time
+		: !sealed.empty() && timestamp < sealed.back().last_time) {
+		return false;
+	}
+	uint64_t bits = 0;
+	std::memcpy(&bits, &value, sizeof(bits));
+	if (current.count == 0) {
+		current.first_time = timestamp;
+		write((uint64_t)timestamp, 64);
+		write(bits, 64);
+		prev_delta = 0;
+		prev_leading = no_window;
+	}
+	else {
+		int64_t delta = timestamp - current.last_time;
+		int64_t delta_of_delta = delta - prev_delta;
+		if (delta_of_delta == 0) {
+			write(0, 1);
+		}
+		else if (fits_signed(delta_of_delta, 7)) {
+			write(0b10, 2);
+			write((uint64_t)delta_of_delta, 7);
+		}
+		else if (fits_signed(delta_of_delta, 12)) {
+			write(0b110, 3);
+			write((uint64_t)delta_of_delta, 12);
+		}
+		else if (fits_signed(delta_of_delta, 20)) {
+			write(0b1110, 4);
+			write((uint64_t)delta_of_delta, 20);
+		}
+		else {
+			write(0b1111, 4);
+			write((uint64_t)delta_of_delta, 64);
+		}
+		prev_delta = delta;
+
+		uint64_t xored = bits ^ prev_bits;
+		if (xored == 0) {
+			write(0, 1);
+		}
+		else {
+			unsigned leading = std::min(31u, (unsigned)std::countl_zero(xored));
+			unsigned trailing = (unsigned)std::countr_zero(xored);
+			if (prev_leading != no_window && leading >= prev_leading && trailing >= prev_trailing) {
+				write(0b10, 2);
+				write(xored >> prev_trailing, 64 - prev_leading - prev_trailing);
+			}
+			else {
+				unsigned meaningful = 64 - leading - trailing;
+				write(0b11, 2);
+				write(leading, 5);
+				write(meaningful == 64 ? 0 : meaningful, 6);
+				write(xored >> trailing, meaningful);
+				prev_leading = leading;
+				prev_trailing = trailing;
+			}
+		}
+	}
+	prev_bits = bits;
+	current.last_time = timestamp;
+	++current.count;
+	return current.count >= block_capacity && seal();
+}
+
+bool TimeSeries::seal() {
+	if (current.count == 0) {
+		return false;
+	}
+	current.words.shrink_to_fit();
+	sealed.push_back(std::move(current));
+	current = SeriesBlock();
+	return true;
+}
+
+void TimeSeries::add_sealed(SeriesBlock&& block) {
+	sealed.push_back(std::move(block));
+}
+
+void TimeSeries::scan_block(
+	const SeriesBlock& block, int64_t from, int64_t to,
+	const std::function<void(int64_t, double)>& fn
+) {
+	BlockDecoder decoder(block);
+	int64_t time = 0;
+	double value = 0;
+	while (decoder.next(time, value) && time <= to) {
+		if (time >= from) {
+			fn(time, value);
+		}
+	}
+}
+
+void TimeSeries::scan(int64_t from, int64_t to, const std::function<void(int64_t, double)>& fn) const {
+	// the first block which may contain the range
+	auto it = std::lower_bound(sealed.begin(), sealed.end(), from,
+		[](const SeriesBlock& block, int64_t time) { return block.last_time < time; });
+	for (; it != sealed.end() && it->first_time <= to; ++it) {
+		scan_block(*it, from, to, fn);
+	}
+	if (current.count > 0 && current.last_time >= from && current.first_time <= to) {
+		scan_block(current, from, to, fn);
+	}
+}
+
+const std::vector<SeriesBlock>& TimeSeries::get_sealed() const {
+	return sealed;
+}
+
+size_t TimeSeries::get_point_count() const {
+	size_t count = current.count;
+	for (auto&& block : sealed) {
+		count += block.count;
+	}
+	return count;
+}
+
+size_t TimeSeries::get_memory_usage() const {
+	size_t bytes = sizeof(TimeSeries) + current.words.capacity() * sizeof(uint64_t);
+	for (auto&& block : sealed) {
+		bytes += sizeof(SeriesBlock) + block.words.capacity() * sizeof(uint64_t);
+	}
+	return bytes;
+}
+
+std::optional<std::pair<int64_t, int64_t>> TimeSeries::get_time_range() const {
+	if (sealed.empty() && current.count == 0) {
+		return std::nullopt;
+	}
+	int64_t first = sealed.empty() ? current.first_time : sealed.front().first_time;
+	int64_t last = current.count > 0 ? current.last_time : sealed.back().last_time;
+	return std::make_pair(first, last);
+}
+
+TimeSeriesStore::~TimeSeriesStore() {
+	if (!writer) {
+		return;
+	}
+	// the blocks being filled are kept as shorter ones
+	std::unique_lock<std::shared_mutex> lock(mutex);
+	for (auto&& [symbol, history] : series) {
+		if (history.seal()) {
+			persist(symbol, history.get_sealed().back());
+		}
+	}
+}
+
+std::string TimeSeriesStore::get_path() const {
+	return (std::filesystem::path(dir) / "prices.tsb").string();
+}
+
+size_t TimeSeriesStore::load() {
+	std::unique_lock<std::shared_mutex> lock(mutex);
+	size_t loaded = 0;
+	std::string path = get_path();
+	uint64_t valid_end = read_records(path, max_payload, [&](const std::string& payload, uint64_t) {
+		size_t offset = 0;
+		uint16_t name_size = 0;
+		SeriesBlock block;
+		if (!take_binary(payload, offset, name_size) || offset + name_size > payload.size()) {
+			return false;
+		}
+		std::string name = payload.substr(offset, name_size);
+		offset += name_size;
+		bool is_complete = take_binary(payload, offset, block.first_time)
+			&& take_binary(payload, offset, block.last_time)
+			&& take_binary(payload, offset, block.count)
+			&& take_binary(payload, offset, block.bit_count)
+			&& (block.bit_count + 63) / 64 * sizeof(uint64_t) == payload.size() - offset;
+		if (!is_complete) {
+			return false;
+		}
+		block.words.resize((size_t)(block.bit_count + 63) / 64);
+		std::memcpy(block.words.data(), payload.data() + offset, payload.size() - offset);
+		loaded += block.count;
+		series[symbol_table->intern(name)].add_sealed(std::move(block));
+		return true;
+	});
+	drop_torn_tail(path, valid_end);
+	try {
+		std::filesystem::create_directories(dir);
+	}
+	catch (std::exception& exc) {
+		print(exc.what(), "\n");
+	}
+	JournalConfig config;
+	// losing the last blocks upon a power failure is acceptable
+	config.policy = FsyncPolicy::None;
+	writer = std::make_unique<JournalWriter>(path, config);
+	return loaded;
+}
+
+void TimeSeriesStore::persist(SymbolId symbol, const SeriesBlock& block) {
+	if (!writer) {
+		return;
+	}
+	const std::string& name = symbol_table->get_name(symbol);
+	std::string payload;
+	payload.reserve(name.size() + 32 + block.words.size() * sizeof(uint64_t));
+	append_binary(payload, (uint16_t)name.size());
+	payload += name;
+	append_binary(payload, block.first_time);
+	append_binary(payload, block.last_time);
+	append_binary(payload, block.count);
+	append_binary(payload, block.bit_count);
+	payload.append(reinterpret_cast<const char*>(block.words.data()), block.words.size() * sizeof(uint64_t));
+	writer->append(frame_record(payload));
+}
+
+void TimeSeriesStore::append(SymbolId symbol, int64_t timestamp, double value) {
+	std::unique_lock<std::shared_mutex> lock(mutex);
+	TimeSeries& history = series[symbol];
+	if (history.append(timestamp, value, block_capacity)) {
+		persist(symbol, history.get_sealed().back());
+	}
+}
+
+size_t TimeSeriesStore::append_tick(
+	int64_t timestamp, const std::vector<SymbolId>& symbols,
+	const std::vector<double>& values, const std::vector<int64_t>& updates
+) {
+	size_t appended = 0;
+	std::unique_lock<std::shared_mutex> lock(mutex);
+	for (size_t position = 0; position < symbols.size(); ++position) {
+		if (updates[position] != timestamp || values[position] <= 0) {
+			continue;
+		}
+		TimeSeries& history = series[symbols[position]];
+		if (history.append(timestamp, values[position], block_capacity)) {
+			persist(symbols[position], history.get_sealed().back());
+		}
+		++appended;
+	}
+	return appended;
+}
+
+void TimeSeriesStore::scan(
+	SymbolId symbol, int64_t from, int64_t to,
+	const std::function<void(int64_t, double)>& fn
+) const {
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	const TimeSeries* history = series.find(symbol);
+	if (history != nullptr) {
+		history->scan(from, to, fn);
+	}
+}
+
+size_t TimeSeriesStore::get_point_count(SymbolId symbol) const {
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	const TimeSeries* history = series.find(symbol);
+	return history != nullptr ? history->get_point_count() : 0;
+}
+
+std::optional<std::pair<int64_t, int64_t>> TimeSeriesStore::get_time_range(SymbolId symbol) const {
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	const TimeSeries* history = series.find(symbol);
+	return history != nullptr ? history->get_time_range() : std::nullopt;
+}
+
+size_t TimeSeriesStore::get_memory_usage() const {
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	size_t bytes = 0;
+	for (auto&& [symbol, history] : series) {
+		bytes += history.get_memory_usage();
+	}
+	return bytes;
+}
+
+#endif // !TIME_SERIES_DEFINITIONS
@@ -12,6 +12,8 @@
 #include "utilities.h"
 #include "connection.h"
 #include "thread_controller.h"
+#include "tick_timer.h"
+#include "stdin_poller.h"
 
 using seconds = std::chrono::seconds;
 
@@ -33,7 +35,7 @@ public:
 	std::vector<std::string> receive_user_input(int argc, char** argv);
 
 	/**
-	 * @brief Reads standard input (non-blocking) in a separate thread
+	 * @brief Reads standard input in a separate thread (where it can't be polled, i.e. Windows)
 	 * and transfers the input appropriately
 	 * to appropriate instance methods for a further processing
 	 * - runs until the user withdraws or ends the program by force
@@ -42,6 +44,13 @@ public:
 	 */
 	void read_cin(std::atomic<bool>& run, std::shared_ptr<ThreadController>& c);
 
+	/**
+	 * @brief Dispatches one line of the input to the commands
+	 * @param user_input - line without the newline
+	 * @returns false if the user withdraws (no more input is expected)
+	 */
+	bool process_line(std::string user_input);
+
 	/**
 	 * @brief A guide for the first launch
 	 * - since it is not a triggered command
@@ -75,6 +84,8 @@ private: // methods
 	/**
 	 * @brief Asks to add a cryptrocurrency to a user's watchlist
 	 * via transferring the query to a concerned class
+	 * - the query is queued, the analysis thread applies it at the next tick
+	 * and prints the outcome (once the dataset is downloaded)
 	 * - upon invalid values prints error message
 	 * @param user_v entered value from the user
 	 */
@@ -83,6 +94,7 @@ private: // methods
 	/**
 	 * @brief Asks to remove a cryptrocurrency from a user's watchlist
 	 * via transferring the query to a concerned class
+	 * - the query is queued, the analysis thread applies it at the next tick
 	 * - upon invalid values prints error message
 	 * @param user_v entered value from the user
 	 */
@@ -96,11 +108,25 @@ private: // methods
 	 */
 	void try_deposit(const std::string& user_v);
 
+	/**
+	 * @brief Shows the stored price history of a cryptocurrency
+	 * @param user_v entered value from the user
+	 */
+	void show_prices(const std::string& user_v);
+
+	/**
+	 * @brief Queries the transaction history
+	 * - history [symbol|all] [from] [to] [page], dates in dd-mm-yyyy format (UTC)
+	 * - upon invalid values prints error message
+	 * @param input_tokens - tokenized user input
+	 */
+	void query_history(std::vector<std::string>& input_tokens);
+
 	// simple commands
 	void call_history() const;
 	void call_current() const;
 	void call_market() const;
-	void call_withdraw() const;
+	void call_threads() const;
 	void print_help() const;
 
 	void print_commands_common(bool found, const std::string& user_input) const;
@@ -114,7 +140,7 @@ private: // fields
 		WithdrawCash, GetCurrent,
 		GetMarket, GetHistory,
 		GetHelp, GetIndicators,
-		Add, Remove, DepositCash
+		Add, Remove, DepositCash, GetPrices, GetThreads
 	};
 
 	/**
@@ -140,14 +166,35 @@ private: // fields
 
 #ifndef PRINT_FUNCTIONS
 
-inline static void print_time_elapsed(long long time, const seconds& delay) {
-	print("Getting data took: ", time, " ms (consider delay afterwards: ", delay.count(), " s)\n");
+inline static void print_time_elapsed(long long time, const ms& delay) {
+	print("Getting data took: ", time, " ms (consider delay afterwards: ", delay.count(), " ms)\n");
 }
 
 inline static void print_empty_watchlist_warning() {
 	print("[WARNING] Make sure to use add [symbol] command, otherwise your watchlist is empty\n");
 }
 
+inline static void print_timer_stats(const TimerStats& stats) {
+	print("Ticks: ", stats.ticks, " (", stats.overruns, " overdue)",
+		" - wake-up lateness mean ", stats.mean_lateness.count(), " us, max ", stats.max_lateness.count(), " us",
+		" - tick overhead mean ", stats.mean_overhead.count(), " us, max ", stats.max_overhead.count(), " us\n");
+}
+
+inline static void print_pipeline_stats(const RingStats& stats) {
+	print("Analysis queue: ", stats.popped, " snapshots (", stats.conflated, " conflated)",
+		" - depth ", stats.depth, ", max ", stats.max_depth, " of ", stats.capacity,
+		" - latency mean ", stats.mean_latency.count(), " us, max ", stats.max_latency.count(), " us\n");
+}
+
+inline static void print_allocation_stats(const std::string& label, const AllocationStats& stats) {
+	print(label, ": ", stats.ticks, " ticks (", stats.allocating_ticks, " allocated on the heap)",
+		" - ", stats.total, " allocations, ", stats.last_tick, " in the latest tick\n");
+}
+
+inline static void print_heap_usage(const AllocationStats& analysis) {
+	print("Arenas ", analysis.arena_bytes, " B - process total ", heap_allocations.load(), " allocations\n");
+}
+
 inline static void print_end() {
 	print("Program ended successfully\n");
 }
@@ -185,6 +232,14 @@ inline static void print_deposit(double value) {
 	print(value, " USD added\n");
 }
 
+inline static void print_queued(size_t ticket, const std::string& label) {
+	print("Command #", ticket, " (", label, ") is applied at the next tick\n");
+}
+
+inline static void print_withdrawing() {
+	print("Withdrawing once the running tick is finished\n");
+}
+
 inline static void print_separator() {
 	print("-------------------------------------\n");
 }
@@ -255,16 +310,17 @@ void Processor::set_supported_commands() {
 	map_init(enum_mapper)
 		(Options::GetHelp, "help")
 		(Options::DepositCash, "deposit [value]")(Options::WithdrawCash, "withdraw")
-		(Options::GetCurrent, "current")(Options::GetHistory, "history")
+		(Options::GetCurrent, "current")(Options::GetHistory, "history [symbol|all] [from] [to] [page]")
 		(Options::GetMarket, "market")(Options::GetIndicators, "indicators")
-		(Options::Add, "add [symbol]")(Options::Remove, "remove [symbol]");
+		(Options::Add, "add [symbol]")(Options::Remove, "remove [symbol]")
+		(Options::GetPrices, "prices [symbol]")(Options::GetThreads, "threads");
 	// func_mapper added for the straightforward parameterless void commands
 	map_init(simple_func_mapper)
 		("history", std::bind(&Processor::call_history, this))
 		("current", std::bind(&Processor::call_current, this))
 		("market", std::bind(&Processor::call_market, this))
-		("withdraw", std::bind(&Processor::call_withdraw, this))
 		("indicators", std::bind(&Processor::get_indicators, this))
+		("threads", std::bind(&Processor::call_threads, this))
 		("help", std::bind(&Processor::print_help, this));
 	map_init(param_func_mapper)
 		("deposit", std::bind(
@@ -275,18 +331,30 @@ void Processor::set_supported_commands() {
 		))
 		("remove", std::bind(
 			&Processor::try_remove_cryptocurrency, this, std::placeholders::_1
+		))
+		("prices", std::bind(
+			&Processor::show_prices, this, std::placeholders::_1
 		));
 }
 
 void Processor::try_add_cryptocurrency(const std::string& symbol) {
-	conn->try_add_cryptocurrency(symbol) ?
-		print_added(symbol) : print_invalid_operation();
+	std::string label = "add " + symbol;
+	// the outcome is reported by the analysis thread (once the dataset is there)
+	size_t ticket = commands->submit(label, [target = conn, symbol] {
+		if (!target->try_add_cryptocurrency(symbol, [symbol] { print_added(symbol); })) {
+			print_invalid_operation();
+		}
+	});
+	print_queued(ticket, label);
 }
 
 void Processor::try_remove_cryptocurrency(const std::string& symbol) {
-	conn->try_remove_cryptocurrency(symbol) ?
-		print_removed(symbol) : print_invalid_operation();
-
+	std::string label = "remove " + symbol;
+	size_t ticket = commands->submit(label, [target = conn, symbol] {
+		target->try_remove_cryptocurrency(symbol) ?
+			print_removed(symbol) : print_invalid_operation();
+	});
+	print_queued(ticket, label);
 }
 
 void Processor::process_simple_command(const std::string& user_input) const {
@@ -316,8 +384,12 @@ void Processor::try_deposit(const std::string& user_input) {
 	try {
 		double amount = convert_string_to<double>(user_input);
 		if (amount > 0) {
-			conn->deposit(amount);
-			print_deposit(amount);
+			std::string label = "deposit " + user_input;
+			size_t ticket = commands->submit(label, [target = conn, amount] {
+				target->deposit(amount);
+				print_deposit(amount);
+			});
+			print_queued(ticket, label);
 		}
 		else {
 			print_invalid_amount();
@@ -332,6 +404,32 @@ void Processor::get_indicators() const {
 	conn->show_indicators();
 }
 
+void Processor::show_prices(const std::string& symbol) {
+	conn->show_price_history(symbol);
+}
+
+void Processor::query_history(std::vector<std::string>& input_tokens) {
+	std::string symbol = input_tokens.at(1);
+	to_uppercase(symbol);
+	int64_t from = std::numeric_limits<int64_t>::min();
+	int64_t to = std::numeric_limits<int64_t>::max();
+	size_t page = 1;
+	bool is_valid = input_tokens.size() <= 5
+		&& (input_tokens.size() <= 2 || parse_date(input_tokens.at(2), from))
+		&& (input_tokens.size() <= 3 || parse_date(input_tokens.at(3), to))
+		&& (input_tokens.size() <= 4 || (parse_number(input_tokens.at(4), page) && page > 0));
+	if (!is_valid) {
+		print_invalid_operation();
+		print("Usage: ", enum_mapper.at(Options::GetHistory), " (dates as dd-mm-yyyy)\n");
+		return;
+	}
+	if (input_tokens.size() > 3) {
+		// the whole last day
+		to += 86400000 - 1;
+	}
+	conn->show_history(symbol, from, to, page);
+}
+
 void Processor::call_current() const {
 	conn->show_current_state();
 }
@@ -344,8 +442,8 @@ void Processor::call_market() const {
 	conn->show_current_values();
 }
 
-void Processor::call_withdraw() const {
-	conn->show_result();
+void Processor::call_threads() const {
+	print_thread_usage(get_thread_usage());
 }
 
 #endif // !COMMANDS
@@ -353,36 +451,52 @@ void Processor::call_withdraw() const {
 #ifndef INPUT_READER
 
 void Processor::read_cin(std::atomic<bool>& run, std::shared_ptr<ThreadController>& c) {
+	ThreadTuning tuning("console", "input");
 	std::string user_input;
 	while (run.load()) {
-		getline(std::cin, user_input);
-		// prevent unknown action spamming with empty cin
-		if (user_input.empty()) {
-			continue;
+		if (!getline(std::cin, user_input)) {
+			// stdin closed - the ticks go on until the process is ended
+			break;
 		}
-		to_lowercase(user_input);
-		trim(user_input);
-		print_separator();
-		std::vector<std::string> tokens = tokenize(user_input, ' ');
-		// special case
-		if (tokens.size() == 1 
-			&& tokens.at(0) == enum_mapper.at(Options::WithdrawCash)) {
+		if (!process_line(user_input)) {
 			run.store(false);
 			c->kill();
-			process_simple_command(user_input);
-		}
-		else if (tokens.size() == 1) {
-			process_simple_command(user_input);
-		}
-		else if (tokens.size() == 2) {
-			process_param_command(tokens);
 		}
-		else {
-			print_unknown_action(user_input);
-			print_help();
-		}
-		print_separator();
 	}
 }
 
+bool Processor::process_line(std::string user_input) {
+	// prevent unknown action spamming with empty cin
+	if (user_input.empty()) {
+		return true;
+	}
+	to_lowercase(user_input);
+	trim(user_input);
+	print_separator();
+	std::vector<std::string> tokens = tokenize(user_input, ' ');
+	bool shall_continue = true;
+	// special case
+	if (tokens.size() == 1 
+		&& tokens.at(0) == enum_mapper.at(Options::WithdrawCash)) {
+		// the result is shown once the ticks are stopped (see run_loop)
+		print_withdrawing();
+		shall_continue = false;
+	}
+	else if (tokens.size() == 1) {
+		process_simple_command(user_input);
+	}
+	else if (tokens.at(0) == "history") {
+		query_history(tokens);
+	}
+	else if (tokens.size() == 2) {
+		process_param_command(tokens);
+	}
+	else {
+		print_unknown_action(user_input);
+		print_help();
+	}
+	print_separator();
+	return shall_continue;
+}
+
 #endif // !INPUT_READER
@@ -0,0 +1,180 @@
+#pragma once
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include "utilities.h"
+#include "record_log.h"
+#include "journal_writer.h"
+
+/**
+ * @brief Kinds of the journal records - everything which changes the assets.
+ */
+enum class JournalEntryType : uint8_t { Deposit = 1, Buy = 2, Sell = 3, Withdraw = 4 };
+
+/**
+ * @brief One record of the trade journal
+ * - replaying the records in order rebuilds the assets
+ */
+struct JournalEntry {
+	JournalEntryType type = JournalEntryType::Deposit;
+	int64_t timestamp = 0; // Unix time in ms
+	std::string symbol; // empty for deposits and withdrawals
+	double amount = 0; // cryptocurrency amount (buy, sell)
+	double xrate = 0; // exchange rate (buy, sell)
+	double usd = 0; // change of the USD balance, the withdrawn value for withdrawals
+};
+
+/**
+ * @brief Binary append-only journal of deposits, trades and withdrawals
+ * - records are framed with their size and checksum (see record_log.h)
+ * - records are written by a background JournalWriter (fsync policy applies)
+ * - a torn or corrupted tail (crash during a write) is cut off upon recovery,
+ * everything before it is replayed
+ */
+class TradeJournal {
+public:
+	TradeJournal(const std::string& in_path, const JournalConfig& in_config = JournalConfig())
+		: path(in_path), config(in_config), end_offset(0) { }
+	TradeJournal(const TradeJournal&) = delete;
+	TradeJournal& operator=(const TradeJournal&) = delete;
+
+	/**
+	 * @brief Replays valid records and opens the journal for appending
+	 * - only the records from the offset on are read (and checked)
+	 * @param from_offset - offset of the first record to be replayed
+	 * (records before it are already reflected in the state, i.e. a snapshot)
+	 * @param apply - called for every replayed record
+	 * @returns number of replayed records
+	 */
+	size_t recover(uint64_t from_offset, const std::function<void(const JournalEntry&)>& apply);
+
+	/**
+	 * @brief Reads the records between the offsets (the journal is not changed)
+	 * @param from_offset - a record boundary, the records before it are not read
+	 * @param to_offset - the records which end after it are not read
+	 */
+	void scan(uint64_t from_offset, uint64_t to_offset,
+		const std::function<void(const JournalEntry&)>& visit) const;
+
+	/**
+	 * @brief Appends a record (the caller does not wait for the disk).
+	 */
+	void append(const JournalEntry& entry);
+
+	/**
+	 * @returns offset after the last appended record
+	 * (including records not written yet)
+	 */
+	uint64_t get_end_offset() const;
+
+	size_t get_queue_depth() const;
+
+private:
+	static std::string encode(const JournalEntry& entry);
+	static bool decode(const std::string& payload, JournalEntry& entry);
+
+	/**
+	 * @brief Upper bound of a payload - anything bigger is a corrupted size.
+	 */
+	static constexpr uint32_t max_payload = 1 << 16;
+
+	std::string path;
+	JournalConfig config;
+	std::unique_ptr<JournalWriter> writer;
+	mutable std::mutex mutex; // keeps offsets in the order of the records
+	uint64_t end_offset;
+};
+
+#ifndef TRADE_JOURNAL_DEFINITIONS
+
+std::string TradeJournal::encode(const JournalEntry& entry) {
+	std::string payload;
+	append_binary(payload, (uint8_t)entry.type);
+	append_binary(payload, entry.timestamp);
+	append_binary(payload, entry.amount);
+	append_binary(payload, entry.xrate);
+	append_binary(payload, entry.usd);
+	append_binary(payload, (uint16_t)entry.symbol.size());
+	payload += entry.symbol;
+	return frame_record(payload);
+}
+
+bool TradeJournal::decode(const std::string& payload, JournalEntry& entry) {
+	size_t offset = 0;
+	uint8_t type = 0;
+	uint16_t symbol_size = 0;
+	bool is_complete = take_binary(payload, offset, type)
+		&& take_binary(payload, offset, entry.timestamp)
+		&& take_binary(payload, offset, entry.amount)
+		&& take_binary(payload, offset, entry.xrate)
+		&& take_binary(payload, offset, entry.usd)
+		&& take_binary(payload, offset, symbol_size)
+		&& offset + symbol_size == payload.size();
+	if (!is_complete || type < (uint8_t)JournalEntryType::Deposit || type > (uint8_t)JournalEntryType::Withdraw) {
+		return false;
+	}
+	entry.type = (JournalEntryType)type;
+	entry.symbol = payload.substr(offset, symbol_size);
+	return true;
+}
+
+size_t TradeJournal::recover(uint64_t from_offset, const std::function<void(const JournalEntry&)>& apply) {
+	std::lock_guard<std::mutex> guard(mutex);
+	size_t replayed = 0;
+	uint64_t valid_end = read_records(path, max_payload, [&](const std::string& payload, uint64_t) {
+		JournalEntry entry;
+		if (!decode(payload, entry)) {
+			return false;
+		}
+		apply(entry);
+		++replayed;
+		return true;
+	}, from_offset);
+	drop_torn_tail(path, valid_end);
+	end_offset = valid_end;
+	writer = std::make_unique<JournalWriter>(path, config);
+	return replayed;
+}
+
+void TradeJournal::scan(
+	uint64_t from_offset, uint64_t to_offset,
+	const std::function<void(const JournalEntry&)>& visit
+) const {
+	if (from_offset >= to_offset) {
+		return;
+	}
+	read_records(path, max_payload, [&](const std::string& payload, uint64_t offset) {
+		JournalEntry entry;
+		if (offset > to_offset || !decode(payload, entry)) {
+			return false;
+		}
+		visit(entry);
+		return true;
+	}, from_offset);
+}
+
+void TradeJournal::append(const JournalEntry& entry) {
+	std::string record = encode(entry);
+	std::lock_guard<std::mutex> guard(mutex);
+	if (!writer) {
+		print("Journal ", path, " has not been recovered yet\n");
+		return;
+	}
+	end_offset += record.size();
+	writer->append(std::move(record));
+}
+
+uint64_t TradeJournal::get_end_offset() const {
+	std::lock_guard<std::mutex> guard(mutex);
+	return end_offset;
+}
+
+size_t TradeJournal::get_queue_depth() const {
+	std::lock_guard<std::mutex> guard(mutex);
+	return writer ? writer->get_queue_depth() : 0;
+}
+
+#endif // !TRADE_JOURNAL_DEFINITIONS
@@ -29,6 +29,19 @@ private:
 		action(in_action), cryptopair(in_cryptopair),
 		date_time(get_current_datetime()) {}
 
+	/**
+	 * @brief Transaction accomplished earlier (replayed from the journal).
+	 */
+	Transaction(
+		double in_amount,
+		double in_xrate,
+		const std::string& in_action,
+		const std::string& in_cryptopair,
+		const std::string& in_datetime
+	) : amount(in_amount), exchange_rate(in_xrate),
+		action(in_action), cryptopair(in_cryptopair),
+		date_time(in_datetime) {}
+
 	double amount;
 	double exchange_rate;
 	std::string action;
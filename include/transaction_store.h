@@ -0,0 +1,375 @@
+#pragma once
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <algorithm>
+#include <shared_mutex>
+
+#include "record_log.h"
+#include "symbol_table.h"
+
+/**
+ * @brief Side of a stored transaction.
+ */
+enum class TradeSide : uint8_t { Buy = 1, Sell = 2 };
+
+/**
+ * @brief Aggregates of the transactions of a symbol (within a time range)
+ */
+struct TradeAggregate {
+	size_t buys = 0;
+	size_t sells = 0;
+	double volume = 0; // traded USD (buys and sells)
+	double realized_pnl = 0; // USD (average cost of the sold amount)
+};
+
+/**
+ * @brief One stored transaction (a row of the columns)
+ */
+struct TradeRow {
+	int64_t timestamp = 0;
+	SymbolId symbol = 0;
+	TradeSide side = TradeSide::Buy;
+	double amount = 0;
+	double xrate = 0;
+	double realized_pnl = 0;
+};
+
+/**
+ * @brief Transactions of a time range, newest first
+ */
+struct TradePage {
+	size_t total = 0; // transactions of the range
+	std::vector<uint32_t> rows; // rows of the requested page
+};
+
+/**
+ * @brief In-memory columnar store of the whole transaction history
+ * - one column per attribute, a transaction is a row index
+ * - transactions are appended in time order, therefore time ranges
+ * are found by binary search of the time column
+ * - per-symbol index (rows of the symbol) with prefix sums of the aggregates,
+ * an aggregate of any time range takes two binary searches
+ * - checkpoints (rows appended since the previous one and the open positions)
+ * let a restart load the history instead of rebuilding it from the whole journal
+ * - thread safe (appended by the analysis, queried by the commands)
+ */
+class TransactionStore {
+public:
+	TransactionStore() { }
+	TransactionStore(const TransactionStore&) = delete;
+	TransactionStore& operator=(const TransactionStore&) = delete;
+
+	/**
+	 * @param usd - change of the USD balance (negative for buys)
+	 * @returns realized profit or loss of the transaction (0 for buys)
+	 */
+	double append(int64_t timestamp, SymbolId symbol, TradeSide side, double amount, double xrate, double usd);
+
+	/**
+	 * @brief Positions are closed (everything has been converted to USD)
+	 * - the liquidated ones are booked as sells before, this drops what is left
+	 * (i.e. symbols without a price upon the withdrawal)
+	 */
+	void close_positions();
+
+	/**
+	 * @brief Encodes the rows appended since the previous checkpoint and the open positions
+	 * @param journal_offset - journal records before it are reflected in the rows
+	 * @returns payload of a checkpoint record (empty if nothing has changed)
+	 */
+	std::string take_checkpoint(uint64_t journal_offset, const SymbolTable& symbol_table);
+
+	/**
+	 * @brief Appends the rows of a checkpoint (as they have been booked)
+	 * and takes its positions - nothing is changed if the payload can't be decoded
+	 * @returns whether the checkpoint has been loaded
+	 */
+	bool load_checkpoint(const std::string& payload, SymbolTable& symbol_table);
+
+	/**
+	 * @returns journal offset of a checkpoint payload (0 if it can't be read)
+	 */
+	static uint64_t get_checkpoint_offset(const std::string& payload);
+
+	/**
+	 * @param symbol - all symbols if none
+	 * @param from, to - time range (Unix time in ms, inclusive)
+	 * @param page - 1 is the newest one
+	 */
+	TradePage query(std::optional<SymbolId> symbol, int64_t from, int64_t to,
+		size_t page, size_t page_size) const;
+
+	TradeAggregate aggregate(SymbolId symbol, int64_t from, int64_t to) const;
+
+	/**
+	 * @returns symbols which have been traded (ordered by their ids)
+	 */
+	std::vector<SymbolId> get_symbols() const;
+
+	size_t size() const;
+
+	/**
+	 * @brief Gathers a row of the columns.
+	 */
+	TradeRow get_row(uint32_t row) const;
+
+private:
+	/**
+	 * @brief Rows of a symbol and prefix sums of their aggregates
+	 * (prefix[i] covers rows[0, i))
+	 */
+	struct SymbolIndex {
+		std::vector<uint32_t> rows;
+		std::vector<uint32_t> buys_prefix { 0 };
+		std::vector<double> volume_prefix { 0 };
+		std::vector<double> pnl_prefix { 0 };
+		double held = 0;
+		double cost_basis = 0; // USD paid for the held amount
+	};
+
+	/**
+	 * @returns [first, last) positions of the rows within the time range
+	 */
+	std::pair<size_t, size_t> find_range(const std::vector<uint32_t>* rows, int64_t from, int64_t to) const;
+
+	/**
+	 * @brief Appends a row to the columns and the index of its symbol (the lock is held).
+	 */
+	void push_row(SymbolIndex& index, int64_t timestamp, SymbolId symbol, TradeSide side,
+		double amount, double xrate, double usd, double pnl);
+
+	mutable std::shared_mutex mutex;
+	std::vector<int64_t> times;
+	std::vector<SymbolId> symbols;
+	std::vector<TradeSide> sides;
+	std::vector<double> amounts;
+	std::vector<double> xrates;
+	std::vector<double> realized;
+	std::vector<double> usd_changes;
+	SymbolMap<SymbolIndex> indexes;
+	size_t checkpoint_rows = 0; // rows covered by the previous checkpoint
+	bool positions_closed = false; // since the previous checkpoint
+};
+
+#ifndef TRANSACTION_STORE_DEFINITIONS
+
+double TransactionStore::append(
+	int64_t timestamp, SymbolId symbol, TradeSide side, double amount, double xrate, double usd
+) {
+	std::unique_lock<std::shared_mutex> lock(mutex);
+	SymbolIndex& index = indexes[symbol];
+	double pnl = 0;
+	if (side == TradeSide::Buy) {
+		index.held += amount;
+		index.cost_basis -= usd;
+	}
+	else {
+		double sold = std::min(amount, index.held);
+		double cost = index.held > 0 ? index.cost_basis * sold / index.held : 0;
+		pnl = usd - cost;
+		index.held -= sold;
+		index.cost_basis -= cost;
+	}
+	push_row(index, timestamp, symbol, side, amount, xrate, usd, pnl);
+	return pnl;
+}
+
+void TransactionStore::push_row(
+	SymbolIndex& index, int64_t timestamp, SymbolId symbol, TradeSide side,
+	double amount, double xrate, double usd, double pnl
+) {
+	uint32_t row = (uint32_t)times.size();
+	// a clock step back shall not break the time order
+	times.push_back(times.empty() ? timestamp : std::max(timestamp, times.back()));
+	symbols.push_back(symbol);
+	sides.push_back(side);
+	amounts.push_back(amount);
+	xrates.push_back(xrate);
+	realized.push_back(pnl);
+	usd_changes.push_back(usd);
+	index.rows.push_back(row);
+	index.buys_prefix.push_back(index.buys_prefix.back() + (side == TradeSide::Buy ? 1 : 0));
+	index.volume_prefix.push_back(index.volume_prefix.back() + std::abs(usd));
+	index.pnl_prefix.push_back(index.pnl_prefix.back() + pnl);
+}
+
+void TransactionStore::close_positions() {
+	std::unique_lock<std::shared_mutex> lock(mutex);
+	for (auto&& [symbol, index] : indexes) {
+		index.held = 0;
+		index.cost_basis = 0;
+	}
+	positions_closed = true;
+}
+
+std::string TransactionStore::take_checkpoint(uint64_t journal_offset, const SymbolTable& symbol_table) {
+	std::unique_lock<std::shared_mutex> lock(mutex);
+	std::string payload;
+	if (checkpoint_rows == times.size() && !positions_closed) {
+		return payload;
+	}
+	append_binary(payload, journal_offset);
+	append_binary(payload, (uint32_t)(times.size() - checkpoint_rows));
+	for (size_t row = checkpoint_rows; row < times.size(); ++row) {
+		append_name(payload, symbol_table.get_name(symbols[row]));
+		append_binary(payload, times[row]);
+		append_binary(payload, (uint8_t)sides[row]);
+		append_binary(payload, amounts[row]);
+		append_binary(payload, xrates[row]);
+		append_binary(payload, usd_changes[row]);
+		append_binary(payload, realized[row]);
+	}
+	append_binary(payload, (uint32_t)indexes.size());
+	for (auto&& [symbol, index] : indexes) {
+		append_name(payload, symbol_table.get_name(symbol));
+		append_binary(payload, index.held);
+		append_binary(payload, index.cost_basis);
+	}
+	checkpoint_rows = times.size();
+	positions_closed = false;
+	return payload;
+}
+
+uint64_t TransactionStore::get_checkpoint_offset(const std::string& payload) {
+	size_t offset = 0;
+	uint64_t journal_offset = 0;
+	return take_binary(payload, offset, journal_offset) ? journal_offset : 0;
+}
+
+bool TransactionStore::load_checkpoint(const std::string& payload, SymbolTable& symbol_table) {
+	struct Position {
+		std::string name;
+		double held = 0;
+		double cost_basis = 0;
+	};
+	size_t offset = 0;
+	uint64_t journal_offset = 0;
+	uint32_t count = 0;
+	if (!take_binary(payload, offset, journal_offset) || !take_count(payload, offset, count)) {
+		return false;
+	}
+	// decoded as a whole first - a checkpoint is applied entirely or not at all
+	std::vector<std::pair<std::string, TradeRow>> rows(count);
+	std::vector<double> usds(count);
+	for (size_t row = 0; row < count; ++row) {
+		auto&& [name, trade] = rows[row];
+		uint8_t side = 0;
+		if (!take_name(payload, offset, name) || !take_binary(payload, offset, trade.timestamp)
+			|| !take_binary(payload, offset, side) || !take_binary(payload, offset, trade.amount)
+			|| !take_binary(payload, offset, trade.xrate) || !take_binary(payload, offset, usds[row])
+			|| !take_binary(payload, offset, trade.realized_pnl)
+			|| (side != (uint8_t)TradeSide::Buy && side != (uint8_t)TradeSide::Sell)) {
+			return false;
+		}
+		trade.side = (TradeSide)side;
+	}
+	if (!take_count(payload, offset, count)) {
+		return false;
+	}
+	std::vector<Position> positions(count);
+	for (auto&& position : positions) {
+		if (!take_name(payload, offset, position.name) || !take_binary(payload, offset, position.held)
+			|| !take_binary(payload, offset, position.cost_basis)) {
+			return false;
+		}
+	}
+	std::unique_lock<std::shared_mutex> lock(mutex);
+	for (size_t row = 0; row < rows.size(); ++row) {
+		auto&& [name, trade] = rows[row];
+		SymbolId symbol = symbol_table.intern(name);
+		push_row(indexes[symbol], trade.timestamp, symbol, trade.side,
+			trade.amount, trade.xrate, usds[row], trade.realized_pnl);
+	}
+	for (auto&& position : positions) {
+		SymbolIndex& index = indexes[symbol_table.intern(position.name)];
+		index.held = position.held;
+		index.cost_basis = position.cost_basis;
+	}
+	checkpoint_rows = times.size();
+	return true;
+}
+
+std::pair<size_t, size_t> TransactionStore::find_range(
+	const std::vector<uint32_t>* rows, int64_t from, int64_t to
+) const {
+	if (rows == nullptr) {
+		// all rows - the time column itself
+		auto first = std::lower_bound(times.begin(), times.end(), from);
+		auto last = std::upper_bound(first, times.end(), to);
+		return { (size_t)(first - times.begin()), (size_t)(last - times.begin()) };
+	}
+	auto first = std::lower_bound(rows->begin(), rows->end(), from,
+		[this](uint32_t row, int64_t time) { return times[row] < time; });
+	auto last = std::upper_bound(first, rows->end(), to,
+		[this](int64_t time, uint32_t row) { return time < times[row]; });
+	return { (size_t)(first - rows->begin()), (size_t)(last - rows->begin()) };
+}
+
+TradePage TransactionStore::query(
+	std::optional<SymbolId> symbol, int64_t from, int64_t to, size_t page, size_t page_size
+) const {
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	TradePage result;
+	const std::vector<uint32_t>* rows = nullptr;
+	if (symbol) {
+		const SymbolIndex* index = indexes.find(*symbol);
+		if (index == nullptr) {
+			return result;
+		}
+		rows = &index->rows;
+	}
+	auto [first, last] = find_range(rows, from, to);
+	result.total = last - first;
+	size_t skipped = (std::max<size_t>(page, 1) - 1) * page_size;
+	if (skipped >= result.total) {
+		return result;
+	}
+	size_t newest = last - skipped; // exclusive
+	size_t oldest = newest - std::min(page_size, newest - first);
+	for (size_t position = newest; position > oldest; --position) {
+		result.rows.push_back(rows != nullptr ? (*rows)[position - 1] : (uint32_t)(position - 1));
+	}
+	return result;
+}
+
+TradeAggregate TransactionStore::aggregate(SymbolId symbol, int64_t from, int64_t to) const {
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	TradeAggregate result;
+	const SymbolIndex* index = indexes.find(symbol);
+	if (index == nullptr) {
+		return result;
+	}
+	auto [first, last] = find_range(&index->rows, from, to);
+	result.buys = index->buys_prefix[last] - index->buys_prefix[first];
+	result.sells = (last - first) - result.buys;
+	result.volume = index->volume_prefix[last] - index->volume_prefix[first];
+	result.realized_pnl = index->pnl_prefix[last] - index->pnl_prefix[first];
+	return result;
+}
+
+std::vector<SymbolId> TransactionStore::get_symbols() const {
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	std::vector<SymbolId> result;
+	for (auto&& [symbol, index] : indexes) {
+		result.push_back(symbol);
+	}
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+size_t TransactionStore::size() const {
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	return times.size();
+}
+
+TradeRow TransactionStore::get_row(uint32_t row) const {
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	return { times.at(row), symbols.at(row), sides.at(row),
+		amounts.at(row), xrates.at(row), realized.at(row) };
+}
+
+#endif // !TRANSACTION_STORE_DEFINITIONS
@@ -9,6 +9,10 @@
 #include <memory>
 #include <random>
 #include <utility>
+#include <cctype>
+#include <charconv>
+#include <string_view>
+#include <type_traits>
 
 // hopefully not for long
 // https://en.cppreference.com/w/cpp/compiler_support
@@ -116,12 +120,54 @@ static inline void trim(std::string& input_str) {
     back_trim(input_str);
 }
 
+/**
+ * @brief Locale independent and allocation free number parsing
+ * (every price of the exchange and every dataset cell goes through it)
+ * - surrounding whitespace and a leading '+' are accepted,
+ * anything else after the number is not
+ * @returns false if the input is not a number or the number does not fit into T
+ */
+template<typename T>
+inline bool parse_number(std::string_view str, T& value) {
+    static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>);
+    const char* first = str.data();
+    const char* last = first + str.size();
+    while (first != last && std::isspace(static_cast<unsigned char>(*first))) {
+        ++first;
+    }
+    while (first != last && std::isspace(static_cast<unsigned char>(*(last - 1)))) {
+        --last;
+    }
+    if (first != last && *first == '+') {
+        ++first;
+    }
+    // floating point from_chars is not provided by every standard library yet
+#ifndef __cpp_lib_to_chars
+    if constexpr (std::is_floating_point_v<T>) {
+        std::istringstream s_stream(std::string(first, last));
+        s_stream.imbue(std::locale::classic());
+        return (s_stream >> value) && s_stream.peek() == EOF;
+    }
+    else
+#endif // !__cpp_lib_to_chars
+    {
+        auto [end, error] = std::from_chars(first, last, value);
+        return error == std::errc() && end == last;
+    }
+}
+
 template<typename T>
 inline T convert_string_to(const std::string& str) {
     T converted {};
-    std::istringstream s_stream(str);
-    if (!(s_stream >> converted))
-        throw std::invalid_argument("Can't be converted.");
+    if constexpr (std::is_arithmetic_v<T> && !std::is_same_v<T, bool>) {
+        if (!parse_number(str, converted))
+            throw std::invalid_argument("Can't be converted: '" + str + "'");
+    }
+    else {
+        std::istringstream s_stream(str);
+        if (!(s_stream >> converted))
+            throw std::invalid_argument("Can't be converted.");
+    }
     return converted;
 }
 
@@ -229,21 +275,28 @@ long long measure_time(F func, Args&&... args) {
 }
 
 /**
- * @brief Get current datetime in dd-mm-yyyy hh:MM:ss format.
+ * @returns Current Unix time in milliseconds (the exchange API format)
+ */
+inline int64_t get_unix_time_ms() {
+    return std::chrono::duration_cast<ms>(sys_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Get datetime of a time point in dd-mm-yyyy hh:MM:ss format.
  * - if std::format is supported - time format is set via this header
  * - otherwise a string buffer is created and std::localtime is utilized
  * @see https://stackoverflow.com/a/52884698/14262598 - non std::format version
  */
-inline std::string get_current_datetime() {
+inline std::string get_datetime(const std::chrono::system_clock::time_point& point) {
 #ifdef __cpp_lib_format
     std::ostringstream os;
     //auto&& now = std::chrono::zoned_time{ std::chrono::current_zone(), std::chrono::system_clock::now()}; 
     // - cleaner zone time solution, nevertheless, it is not yet supported by g++-11
-    auto&& now = std::chrono::system_clock::now() + std::chrono::hours(1);
+    auto&& now = point + std::chrono::hours(1);
     os << std::format("{:%d-%m-%Y %H:%M:%OS}", now) << '\n';
     return os.str();
 #else
-    std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    std::time_t now = std::chrono::system_clock::to_time_t(point);
     std::string str_buffer;
     str_buffer.resize(30);
     std::strftime(&str_buffer.front(), str_buffer.size(), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
@@ -251,6 +304,34 @@ inline std::string get_current_datetime() {
 #endif
 }
 
+inline std::string get_current_datetime() {
+    return get_datetime(std::chrono::system_clock::now());
+}
+
+/**
+ * @brief Parses a date in dd-mm-yyyy format (UTC)
+ * @param out_ms - Unix time (ms) of the beginning of the day
+ * @returns false if the date is not valid
+ */
+inline bool parse_date(const std::string& date, int64_t& out_ms) {
+    std::vector<std::string> parts = tokenize(date, '-');
+    int day = 0;
+    unsigned month = 0;
+    int year = 0;
+    if (parts.size() != 3 || !parse_number(parts[0], day)
+        || !parse_number(parts[1], month) || !parse_number(parts[2], year)) {
+        return false;
+    }
+    std::chrono::year_month_day ymd { std::chrono::year(year), std::chrono::month(month),
+        std::chrono::day((unsigned)std::max(day, 0)) };
+    if (!ymd.ok()) {
+        return false;
+    }
+    out_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::sys_days(ymd).time_since_epoch()).count();
+    return true;
+}
+
 #endif // !TIME_UTILITIES
 
 #ifndef MISC_UTILITIES
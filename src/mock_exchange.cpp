@@ -0,0 +1,72 @@
+
+#include "../include/mock_exchange.h"
+
+#ifndef ENTRYPOINT_FUNCTIONS
+
+inline static void print_mock_usage() {
+	print("Usage: MockExchange [--port 8080] [--symbols 500] [--latency ms] [--jitter ms]\n");
+	print("                    [--error-rate percentage] [--weight-limit 1200]\n");
+	print("                    [--ticker-file recorded_ticker.json] [--price-scale 1.0]\n");
+}
+
+/**
+ * @brief Fills the mock configuration from the commandline
+ * @returns false upon an unknown option or an invalid value
+ */
+bool parse_mock_args(int argc, char** argv, MockConfig& config) {
+	try {
+		for (int i = 1; i + 1 < argc; i += 2) {
+			std::string option = argv[i];
+			std::string value = argv[i + 1];
+			if (option == "--port") {
+				config.port = convert_string_to<unsigned short>(value);
+			}
+			else if (option == "--symbols") {
+				config.symbol_count = convert_string_to<size_t>(value);
+			}
+			else if (option == "--latency") {
+				config.latency = ms(convert_string_to<long long>(value));
+			}
+			else if (option == "--jitter") {
+				config.latency_jitter = ms(convert_string_to<long long>(value));
+			}
+			else if (option == "--error-rate") {
+				config.error_rate = convert_string_to<double>(value);
+			}
+			else if (option == "--weight-limit") {
+				config.weight_limit = convert_string_to<size_t>(value);
+			}
+			else if (option == "--ticker-file") {
+				config.ticker_file = value;
+			}
+			else if (option == "--price-scale") {
+				config.price_scale = convert_string_to<double>(value);
+			}
+			else {
+				return false;
+			}
+		}
+	}
+	catch (std::invalid_argument&) {
+		return false;
+	}
+	return argc % 2 == 1;
+}
+
+int main(int argc, char** argv) {
+	MockConfig config;
+	if (!parse_mock_args(argc, argv, config)) {
+		print_mock_usage();
+		return 1;
+	}
+	MockExchange exchange(config);
+	exchange.open();
+	print("Run the bot with TTM_API_URL=", exchange.get_url(), "\n");
+	print("Press enter to stop\n");
+	std::string line;
+	std::getline(std::cin, line);
+	exchange.close();
+	return 0;
+}
+
+#endif // !ENTRYPOINT_FUNCTIONS
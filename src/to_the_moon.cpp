@@ -6,61 +6,110 @@
 //#define GOLD_DATA
 
 #include "../include/to_the_moon.h"
+// every heap allocation of the process is counted
+#include "../include/allocation_counting.h"
 
 #ifndef ENTRYPOINT_FUNCTIONS
 
 void run_loop(
 	Processor& in_processor, GenericConn& conn, const std::vector<std::string>& input
 ) {
-	// delay needs to be set, otherwise the program's request spam
-	// would result in a quick suspension by the API service provider
-	auto delay = seconds(10);
-	auto start = std::chrono::system_clock::now();
 	bool add_to_dataset = false;
-	bool is_initial_run = true;
 
 	conn.prepare_datasets(input);
 	in_processor.print_help_initial();
-	auto controller = std::make_shared<ThreadController>();
-	
-	while (true) {
-		std::atomic<bool> run(true);
-		auto&& cin_func = std::bind(&Processor::read_cin, in_processor, std::ref(run), controller);
-		std::thread cin_thread(cin_func);
-		while (run.load()) {
-			auto&& worker_func = std::bind(&GenericConn::receive_current_data, conn, add_to_dataset);
+
+	// ticks run on a single long-lived worker
+	// - delay needs to be set, otherwise the program's request spam
+	// would result in a quick suspension by the API service provider
+	// - the scheduler sets it according to the request weight budget
+	// and the volatility of the watchlist
+	TickTimer timer([&conn, &add_to_dataset](const TickInfo& tick) {
+		// in order to stay consistent with API provided
+		// we shall update only once upon a time (each wall-clock minute, not every call)
+		add_to_dataset = add_to_dataset || tick.is_minute_boundary;
 #ifdef DEBUG
-			// to check whether 3rd party library
-			// cpprest provides reasonably fast requests
-			auto time = measure_time(worker_func);
-			print_time_elapsed(time, delay);
-			std::this_thread::sleep_for(delay); // do not use outside of debugging purposes - slow thread join
+		// to check whether 3rd party library
+		// cpprest provides reasonably fast requests
+		auto&& worker_func = std::bind(&GenericConn::receive_current_data, conn, add_to_dataset);
+		auto time = measure_time(worker_func);
+		print_time_elapsed(time, scheduler->next_delay());
+		bool submitted = true;
 #else
-			if (is_initial_run || controller->wait_for(delay)) {
-				std::thread worker(worker_func);
-				worker.join();
-			}
+		// only the request is sent here, parsing and analysis happen
+		// in the tick pipeline while the next request is already on its way
+		bool submitted = conn.submit_current_data(add_to_dataset);
 #endif // !DEBUG
+		if (submitted) {
+			// otherwise the dataset update waits for the next tick
 			add_to_dataset = false;
-			auto current = std::chrono::system_clock::now();
-			std::chrono::duration<double> elapsed = current - start;
-			if (elapsed >= std::chrono::minutes(1)) {
-				// in order to stay consistent with API provided
-				// we shall update only once upon a time (not every call)
-				add_to_dataset = true;
-				start = current;
-			}
-			is_initial_run = false;
 		}
-		cin_thread.join();
-		break;
+	}, [] { return scheduler->next_delay(); });
+
+#ifdef TTM_STDIN_POLL
+	// the main thread handles the input until the user withdraws
+	// (or SIGINT/SIGTERM arrives)
+	ThreadTuning tuning("console", "main");
+	StdinPoller poller;
+	auto&& on_line = [&in_processor](const std::string& line) { return in_processor.process_line(line); };
+	while (poller.poll_once(on_line)) { }
+	timer.stop();
+	conn.stop_pipeline();
+#else
+	auto controller = std::make_shared<ThreadController>();
+	std::atomic<bool> run(true);
+	auto&& cin_func = std::bind(&Processor::read_cin, in_processor, std::ref(run), controller);
+	std::thread cin_thread(cin_func);
+	// until the user withdraws
+	while (controller->wait_for(std::chrono::minutes(1))) { }
+	timer.stop();
+	conn.stop_pipeline();
+	cin_thread.join();
+#endif // !TTM_STDIN_POLL
+	// the symbols being added submit their commands before the final drain
+	conn.finish_tasks();
+	// nothing runs the analysis anymore - the remaining commands and the withdrawal
+	commands->drain();
+	conn.show_result();
+	print_timer_stats(timer.get_stats());
+	print_pipeline_stats(conn.get_pipeline_stats());
+	print_thread_usage(get_thread_usage());
+	// the whole tick (prices to the published view) and the indicators with the ledger within it
+	print_allocation_stats("Ticks", conn.get_tick_allocation_stats());
+	print_allocation_stats("Indicators and ledger", analyzer->get_allocation_stats());
+	print_heap_usage(analyzer->get_allocation_stats());
+}
+
+/**
+ * @brief Further Binance compatible venues of the consolidated feed
+ * - configured via TTM_VENUES (comma separated name=url pairs),
+ * e.g. TTM_VENUES=BinanceUS=https://api.binance.us,Mock=http://127.0.0.1:8080
+ */
+std::vector<std::shared_ptr<BinanceApiConn>> create_venues() {
+	std::vector<std::shared_ptr<BinanceApiConn>> venues;
+	const char* configured = std::getenv("TTM_VENUES");
+	if (configured == nullptr) {
+		return venues;
+	}
+	for (auto&& entry : tokenize(configured, ',')) {
+		size_t separator = entry.find('=');
+		if (separator == 0 || separator == std::string::npos || separator + 1 == entry.size()) {
+			print("Ignoring venue '", entry, "' - expected name=url\n");
+			continue;
+		}
+		venues.push_back(create_shared<BinanceApiConn>(entry.substr(0, separator), entry.substr(separator + 1)));
 	}
+	return venues;
 }
 
 int main(int argc, char** argv) {
+#ifdef TTM_STDIN_POLL
+	// std::cin keeps its own buffer (not the one of C stdio),
+	// whatever it has read ahead is taken over by the poller
+	std::ios::sync_with_stdio(false);
+#endif // !TTM_STDIN_POLL
 	std::shared_ptr<BinanceApiConn> binance = create_shared<BinanceApiConn>();
-	//std::shared_ptr<CoinbaseApiConn> coinbase = create_shared<CoinbaseApiConn>();
-	GenericConn conn(binance);
+	GenericConn conn(binance, create_venues());
 	Processor in_processor(conn);
 	std::vector<std::string> input = in_processor.receive_user_input(argc, argv);
 	// an initial api call is required in advance
@@ -0,0 +1,75 @@
+#include <thread>
+#include <vector>
+#include <stdexcept>
+
+#include "../include/command_queue.h"
+#include "test_support.h"
+
+/**
+ * Commands are applied only at the tick boundary (drain), in the order of submission,
+ * by the draining thread - a failing one does not stop the others
+ */
+
+#ifndef COMMAND_QUEUE_TESTS
+
+void test_tick_boundary() {
+	CommandQueue commands;
+	std::vector<int> state; // owned by the "analysis" (this thread)
+	std::thread console([&] {
+		commands.submit("first", [&] { state.push_back(1); });
+		commands.submit("second", [&] { state.push_back(2); });
+	});
+	console.join();
+	// nothing is applied until the tick ends
+	CHECK(state.empty());
+	CHECK(commands.size() == 2);
+	CHECK(commands.drain() == 2);
+	CHECK(state == std::vector<int>({ 1, 2 }));
+	CHECK(commands.size() == 0);
+	CHECK(commands.drain() == 0);
+}
+
+void test_draining_thread() {
+	CommandQueue commands;
+	std::thread::id applied_by;
+	std::thread console([&] {
+		commands.submit("where", [&] { applied_by = std::this_thread::get_id(); });
+	});
+	console.join();
+	commands.drain();
+	CHECK(applied_by == std::this_thread::get_id());
+}
+
+void test_submitted_while_draining() {
+	CommandQueue commands;
+	std::vector<int> state;
+	commands.submit("outer", [&] {
+		state.push_back(1);
+		// i.e. a command which schedules a follow-up - it waits for the next tick
+		commands.submit("inner", [&] { state.push_back(2); });
+	});
+	CHECK(commands.drain() == 1);
+	CHECK(state == std::vector<int>({ 1 }));
+	CHECK(commands.drain() == 1);
+	CHECK(state == std::vector<int>({ 1, 2 }));
+}
+
+void test_failure() {
+	CommandQueue commands;
+	std::vector<int> state;
+	size_t first = commands.submit("failing", [] { throw std::runtime_error("expected failure"); });
+	size_t second = commands.submit("next", [&] { state.push_back(2); });
+	CHECK(second > first);
+	CHECK(commands.drain() == 2);
+	CHECK(state == std::vector<int>({ 2 }));
+}
+
+int main() {
+	run_test("command queue tick boundary", test_tick_boundary);
+	run_test("command queue draining thread", test_draining_thread);
+	run_test("command queue submitted while draining", test_submitted_while_draining);
+	run_test("command queue failure", test_failure);
+	return finish_tests();
+}
+
+#endif // !COMMAND_QUEUE_TESTS
@@ -0,0 +1,99 @@
+#include <algorithm>
+
+#include "../include/consolidated_feed.h"
+#include "test_support.h"
+
+/**
+ * Best buy and sell prices across the venues, the changed symbols of a merge
+ * and the staleness of a venue
+ */
+
+#ifndef CONSOLIDATED_FEED_TESTS
+
+const SymbolId btc = 0;
+const SymbolId eth = 1;
+
+inline static bool has_changed(const ConsolidatedFeed& feed, SymbolId symbol) {
+	auto&& changed = feed.get_changed();
+	return std::find(changed.begin(), changed.end(), symbol) != changed.end();
+}
+
+void test_sided_best() {
+	ConsolidatedFeed feed;
+	size_t cheap = feed.add_venue("Cheap");
+	size_t dear = feed.add_venue("Dear");
+	feed.publish(cheap, { 1000, { { btc, 100 }, { eth, 10 } } });
+	feed.publish(dear, { 1001, { { btc, 102 }, { eth, 9 } } });
+	CHECK(feed.merge() == 2);
+	auto&& best = feed.get_best(btc);
+	CHECK(best.has_value());
+	CHECK(best->buy == 100 && best->buy_venue == cheap);
+	CHECK(best->sell == 102 && best->sell_venue == dear);
+	auto&& other = feed.get_best(eth);
+	CHECK(other->buy == 9 && other->buy_venue == dear);
+	CHECK(other->sell == 10 && other->sell_venue == cheap);
+	CHECK(has_changed(feed, btc) && has_changed(feed, eth));
+	CHECK(!feed.get_best(2).has_value());
+}
+
+void test_unchanged_prices() {
+	ConsolidatedFeed feed;
+	size_t first = feed.add_venue("First");
+	size_t second = feed.add_venue("Second");
+	feed.publish(first, { 1000, { { btc, 100 }, { eth, 10 } } });
+	feed.publish(second, { 1000, { { btc, 101 }, { eth, 11 } } });
+	feed.merge();
+	// the same prices again - nothing to recompute
+	feed.publish(first, { 2000, { { btc, 100 }, { eth, 10 } } });
+	feed.publish(second, { 2000, { { btc, 101 }, { eth, 11 } } });
+	CHECK(feed.merge() == 2);
+	CHECK(feed.get_changed().empty());
+	feed.publish(first, { 3000, { { eth, 12 } } });
+	feed.merge();
+	CHECK(feed.get_changed().size() == 1 && has_changed(feed, eth));
+	CHECK(feed.get_best(eth)->buy == 11 && feed.get_best(eth)->sell == 12);
+}
+
+void test_stale_venue() {
+	ConsolidatedFeed feed;
+	size_t alive = feed.add_venue("Alive");
+	size_t silent = feed.add_venue("Silent");
+	feed.publish(alive, { 1000, { { btc, 100 } } });
+	feed.publish(silent, { 1000, { { btc, 90 } } });
+	feed.merge();
+	CHECK(feed.get_best(btc)->buy_venue == silent);
+	// an update without changed prices keeps the venue fresh
+	feed.publish(alive, { 30000, {} });
+	feed.merge();
+	CHECK(feed.get_changed().empty());
+	// the silent venue has not answered for more than a minute
+	feed.publish(alive, { 70000, {} });
+	feed.merge();
+	CHECK(has_changed(feed, btc));
+	CHECK(feed.get_best(btc)->buy == 100 && feed.get_best(btc)->buy_venue == alive);
+	CHECK(feed.get_best(btc)->sell_venue == alive);
+	// and it is back
+	feed.publish(silent, { 71000, { { btc, 90 } } });
+	feed.merge();
+	CHECK(feed.get_best(btc)->buy == 90 && feed.get_best(btc)->sell == 100);
+}
+
+void test_timestamp_order() {
+	ConsolidatedFeed feed;
+	size_t venue = feed.add_venue("Only");
+	feed.publish(venue, { 1000, { { btc, 100 } } });
+	feed.publish(venue, { 2000, { { btc, 105 } } });
+	feed.merge();
+	// the later update wins
+	CHECK(feed.get_best(btc)->buy == 105);
+}
+
+int main() {
+	run_test("consolidated feed sided best", test_sided_best);
+	run_test("consolidated feed unchanged prices", test_unchanged_prices);
+	run_test("consolidated feed stale venue", test_stale_venue);
+	run_test("consolidated feed timestamp order", test_timestamp_order);
+	return finish_tests();
+}
+
+#endif // !CONSOLIDATED_FEED_TESTS
@@ -0,0 +1,62 @@
+#include <fstream>
+
+#include "../include/csv_loader.h"
+#include "test_support.h"
+
+/**
+ * Rows of a memory mapped csv file - the header is skipped, incomplete first rows are kept
+ * as they are and the reading stops at the first empty line
+ */
+
+#ifndef CSV_LOADER_TESTS
+
+inline static void write_file(const std::string& path, const std::string& content) {
+	std::ofstream file(path, std::ios::binary);
+	file << content;
+}
+
+void test_rows() {
+	TemporaryDirectory directory("csv_loader_rows");
+	std::string path = directory.get_path("BTCUSDT.csv");
+	write_file(path, "RSI;Lower;Upper;Close\r\n"
+		";;;40000.5\r\n"
+		"55.25;39000;41000;40100\r\n"
+		"60;39100;41100;40200\r\n"
+		"\r\n"
+		"1;2;3;4\r\n");
+	auto&& rows = load_csv_rows(path, ';');
+	CHECK(rows.has_value());
+	CHECK(rows->size() == 3);
+	// a row ends at its first empty cell
+	CHECK(rows->at(0).empty());
+	CHECK(rows->at(1) == std::deque<double>({ 55.25, 39000, 41000, 40100 }));
+	CHECK(rows->at(2).back() == 40200);
+}
+
+void test_without_trailing_newline() {
+	TemporaryDirectory directory("csv_loader_trailing");
+	std::string path = directory.get_path("ETHUSDT.csv");
+	write_file(path, "Close,Volume\n1.5,2\n3,4");
+	auto&& rows = load_csv_rows(path, ',');
+	CHECK(rows.has_value() && rows->size() == 2);
+	CHECK(rows->back() == std::deque<double>({ 3, 4 }));
+}
+
+void test_malformed() {
+	TemporaryDirectory directory("csv_loader_malformed");
+	std::string path = directory.get_path("XRPUSDT.csv");
+	write_file(path, "Close;Volume\n1;x;3\n");
+	auto&& rows = load_csv_rows(path, ';');
+	// the row is cut at the malformed value
+	CHECK(rows.has_value() && rows->size() == 1 && rows->at(0) == std::deque<double>({ 1 }));
+	CHECK(!load_csv_rows(directory.get_path("missing.csv"), ';').has_value());
+}
+
+int main() {
+	run_test("csv loader rows", test_rows);
+	run_test("csv loader without trailing newline", test_without_trailing_newline);
+	run_test("csv loader malformed", test_malformed);
+	return finish_tests();
+}
+
+#endif // !CSV_LOADER_TESTS
@@ -0,0 +1,137 @@
+#include <atomic>
+#include <memory>
+#include <functional>
+
+#include "../include/executor.h"
+#include "test_support.h"
+
+/**
+ * Coroutine executor - timers, completions of foreign asynchronous operations
+ * and stopping with tasks still running (nothing is resumed after the executor is gone)
+ */
+
+#ifndef EXECUTOR_TESTS
+
+/**
+ * @brief Asynchronous operation completed by another thread (as pplx::task is)
+ */
+class FakeOperation {
+public:
+	FakeOperation() : state(std::make_shared<State>()) { }
+
+	bool is_done() const {
+		std::lock_guard<std::mutex> guard(state->mutex);
+		return state->done;
+	}
+
+	int get() const {
+		std::lock_guard<std::mutex> guard(state->mutex);
+		return state->value;
+	}
+
+	void then(std::function<void(FakeOperation)> callback) {
+		std::unique_lock<std::mutex> lock(state->mutex);
+		if (state->done) {
+			lock.unlock();
+			callback(*this);
+			return;
+		}
+		state->callback = std::move(callback);
+	}
+
+	void complete(int value) {
+		std::unique_lock<std::mutex> lock(state->mutex);
+		state->done = true;
+		state->value = value;
+		auto callback = std::move(state->callback);
+		lock.unlock();
+		if (callback) {
+			callback(*this);
+		}
+	}
+
+private:
+	struct State {
+		std::mutex mutex;
+		bool done = false;
+		int value = 0;
+		std::function<void(FakeOperation)> callback;
+	};
+
+	std::shared_ptr<State> state;
+};
+
+Task<int> sleep_and_add(Executor& executor, int value) {
+	co_await executor.sleep_for(ms(5));
+	co_return value + 1;
+}
+
+Task<void> sleep_long(Executor& executor, std::atomic<bool>& was_stopping, std::atomic<bool>& finished) {
+	co_await executor.sleep_for(std::chrono::hours(1));
+	was_stopping = executor.is_stopping();
+	finished = true;
+}
+
+Task<void> await_operation(Executor& executor, FakeOperation operation, std::atomic<int>& result) {
+	result = co_await executor.completion_of(operation);
+}
+
+void test_run_sync() {
+	Executor executor;
+	CHECK(executor.run_sync(sleep_and_add(executor, 41)) == 42);
+}
+
+void test_stop_wakes_sleepers() {
+	Executor executor;
+	std::atomic<bool> was_stopping(false);
+	std::atomic<bool> finished(false);
+	executor.spawn(sleep_long(executor, was_stopping, finished));
+	auto&& started = high_clock::now();
+	executor.stop();
+	CHECK(high_clock::now() - started < std::chrono::seconds(5));
+	CHECK(finished && was_stopping);
+}
+
+void test_stop_waits_for_completion() {
+	Executor executor;
+	FakeOperation operation;
+	std::atomic<int> result(0);
+	executor.spawn(await_operation(executor, operation, result));
+	std::thread completer([operation]() mutable {
+		std::this_thread::sleep_for(ms(100));
+		operation.complete(7);
+	});
+	// the completion callback finds the executor running
+	executor.stop();
+	CHECK(result == 7);
+	completer.join();
+}
+
+void test_spawn_after_stop() {
+	Executor executor;
+	executor.stop();
+	std::atomic<bool> was_stopping(false);
+	std::atomic<bool> finished(false);
+	executor.spawn(sleep_long(executor, was_stopping, finished));
+	CHECK(!finished);
+	bool has_thrown = false;
+	try {
+		executor.run_sync(sleep_and_add(executor, 1));
+	}
+	catch (std::runtime_error&) {
+		has_thrown = true;
+	}
+	CHECK(has_thrown);
+	// stopping again does nothing
+	executor.stop();
+}
+
+int main() {
+	run_test("executor run sync", test_run_sync);
+	run_test("executor stop wakes sleepers", test_stop_wakes_sleepers);
+	run_test("executor stop waits for completion", test_stop_waits_for_completion);
+	run_test("executor spawn after stop", test_spawn_after_stop);
+	return finish_tests();
+}
+
+#endif // !EXECUTOR_TESTS
@@ -0,0 +1,165 @@
+#include <fstream>
+#include <filesystem>
+
+#include "../include/trade_journal.h"
+#include "test_support.h"
+
+/**
+ * Recovery of the trade journal - a torn or corrupted tail is cut off,
+ * a recovery from an offset reads the later records only
+ */
+
+#ifndef JOURNAL_TESTS
+
+inline static JournalEntry make_entry(JournalEntryType type, int64_t timestamp,
+	const std::string& symbol = "", double amount = 0, double usd = 0
+) {
+	JournalEntry entry;
+	entry.type = type;
+	entry.timestamp = timestamp;
+	entry.symbol = symbol;
+	entry.amount = amount;
+	entry.xrate = amount > 0 ? -usd / amount : 0;
+	entry.usd = usd;
+	return entry;
+}
+
+inline static std::vector<JournalEntry> get_entries() {
+	return {
+		make_entry(JournalEntryType::Deposit, 1000, "", 0, 1000),
+		make_entry(JournalEntryType::Buy, 2000, "BTCUSDT", 0.01, -400),
+		make_entry(JournalEntryType::Sell, 3000, "BTCUSDT", 0.01, 450)
+	};
+}
+
+/**
+ * @returns offsets after each of the records
+ */
+inline static std::vector<uint64_t> write_entries(const std::string& path, const std::vector<JournalEntry>& entries) {
+	std::vector<uint64_t> offsets;
+	TradeJournal journal(path);
+	journal.recover(0, [](const JournalEntry&) { });
+	for (auto&& entry : entries) {
+		journal.append(entry);
+		offsets.push_back(journal.get_end_offset());
+	}
+	// the queued records are written when the journal goes away
+	return offsets;
+}
+
+inline static std::vector<JournalEntry> recover_entries(const std::string& path, uint64_t from_offset, uint64_t& end_offset) {
+	std::vector<JournalEntry> replayed;
+	TradeJournal journal(path);
+	journal.recover(from_offset, [&](const JournalEntry& entry) { replayed.push_back(entry); });
+	end_offset = journal.get_end_offset();
+	return replayed;
+}
+
+inline static void corrupt_byte(const std::string& path, uint64_t offset) {
+	std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+	file.seekg((std::streamoff)offset);
+	char byte = 0;
+	file.get(byte);
+	file.seekp((std::streamoff)offset);
+	file.put((char)(byte ^ 0x5A));
+}
+
+void test_round_trip() {
+	TemporaryDirectory directory("journal_round_trip");
+	std::string path = directory.get_path("journal.bin");
+	auto&& entries = get_entries();
+	auto&& offsets = write_entries(path, entries);
+	CHECK(std::filesystem::file_size(path) == offsets.back());
+	uint64_t end_offset = 0;
+	auto&& replayed = recover_entries(path, 0, end_offset);
+	CHECK(replayed.size() == entries.size());
+	CHECK(end_offset == offsets.back());
+	for (size_t i = 0; i < std::min(replayed.size(), entries.size()); ++i) {
+		CHECK(replayed[i].type == entries[i].type);
+		CHECK(replayed[i].timestamp == entries[i].timestamp);
+		CHECK(replayed[i].symbol == entries[i].symbol);
+		CHECK(replayed[i].amount == entries[i].amount);
+		CHECK(replayed[i].usd == entries[i].usd);
+	}
+}
+
+void test_torn_tail() {
+	TemporaryDirectory directory("journal_torn_tail");
+	std::string path = directory.get_path("journal.bin");
+	auto&& offsets = write_entries(path, get_entries());
+	{
+		// a crash in the middle of a write - half of a record header
+		std::ofstream file(path, std::ios::binary | std::ios::app);
+		file.write("\x2A\x00\x00", 3);
+	}
+	uint64_t end_offset = 0;
+	CHECK(recover_entries(path, 0, end_offset).size() == 3);
+	CHECK(end_offset == offsets.back());
+	CHECK(std::filesystem::file_size(path) == offsets.back());
+	// records appended after the recovery follow the valid ones
+	{
+		TradeJournal journal(path);
+		journal.recover(0, [](const JournalEntry&) { });
+		journal.append(make_entry(JournalEntryType::Withdraw, 4000, "", 0, 1050));
+	}
+	auto&& replayed = recover_entries(path, 0, end_offset);
+	CHECK(replayed.size() == 4);
+	CHECK(!replayed.empty() && replayed.back().type == JournalEntryType::Withdraw);
+}
+
+void test_corrupted_tail() {
+	TemporaryDirectory directory("journal_corrupted_tail");
+	std::string path = directory.get_path("journal.bin");
+	auto&& offsets = write_entries(path, get_entries());
+	// the last byte of the last payload (the checksum does not match)
+	corrupt_byte(path, offsets.back() - 1);
+	uint64_t end_offset = 0;
+	CHECK(recover_entries(path, 0, end_offset).size() == 2);
+	CHECK(end_offset == offsets[1]);
+	CHECK(std::filesystem::file_size(path) == offsets[1]);
+}
+
+void test_recovery_from_offset() {
+	TemporaryDirectory directory("journal_from_offset");
+	std::string path = directory.get_path("journal.bin");
+	auto&& offsets = write_entries(path, get_entries());
+	// the records before the offset are not read at all - a damaged one goes unnoticed
+	corrupt_byte(path, offsets[0] - 1);
+	uint64_t end_offset = 0;
+	auto&& replayed = recover_entries(path, offsets[0], end_offset);
+	CHECK(replayed.size() == 2);
+	CHECK(!replayed.empty() && replayed.front().type == JournalEntryType::Buy);
+	CHECK(end_offset == offsets.back());
+	CHECK(std::filesystem::file_size(path) == offsets.back());
+	// at the end of the journal there is nothing to replay
+	CHECK(recover_entries(path, offsets.back(), end_offset).empty());
+	CHECK(end_offset == offsets.back());
+}
+
+void test_scan() {
+	TemporaryDirectory directory("journal_scan");
+	std::string path = directory.get_path("journal.bin");
+	auto&& offsets = write_entries(path, get_entries());
+	TradeJournal journal(path);
+	std::vector<JournalEntry> visited;
+	journal.scan(0, offsets[1], [&](const JournalEntry& entry) { visited.push_back(entry); });
+	CHECK(visited.size() == 2);
+	CHECK(visited.size() == 2 && visited[1].type == JournalEntryType::Buy);
+	visited.clear();
+	journal.scan(offsets[0], offsets[1], [&](const JournalEntry& entry) { visited.push_back(entry); });
+	CHECK(visited.size() == 1 && visited[0].type == JournalEntryType::Buy);
+	visited.clear();
+	journal.scan(offsets[1], offsets[1], [&](const JournalEntry& entry) { visited.push_back(entry); });
+	CHECK(visited.empty());
+}
+
+int main() {
+	run_test("journal round trip", test_round_trip);
+	run_test("journal torn tail", test_torn_tail);
+	run_test("journal corrupted tail", test_corrupted_tail);
+	run_test("journal recovery from an offset", test_recovery_from_offset);
+	run_test("journal scan", test_scan);
+	return finish_tests();
+}
+
+#endif // !JOURNAL_TESTS
@@ -0,0 +1,89 @@
+#include <thread>
+#include <vector>
+#include <fstream>
+
+#include "../include/journal_writer.h"
+#include "test_support.h"
+
+/**
+ * Rows appended from several threads are all written, the rows of a thread in its order,
+ * including the ones still queued when the writer is destroyed
+ */
+
+#ifndef JOURNAL_WRITER_TESTS
+
+inline static std::vector<std::string> read_lines(const std::string& path) {
+	std::ifstream file(path);
+	std::vector<std::string> lines;
+	std::string line;
+	while (std::getline(file, line)) {
+		lines.push_back(line);
+	}
+	return lines;
+}
+
+void test_producers() {
+	TemporaryDirectory directory("journal_writer_producers");
+	std::string path = directory.get_path("journal.csv");
+	const int producers = 4;
+	const int rows = 2000;
+	{
+		JournalConfig config;
+		config.policy = FsyncPolicy::EveryN;
+		config.fsync_every = 500;
+		JournalWriter writer(path, config);
+		std::vector<std::thread> threads;
+		for (int producer = 0; producer < producers; ++producer) {
+			threads.emplace_back([&writer, producer] {
+				for (int row = 0; row < rows; ++row) {
+					writer.append(std::to_string(producer) + ";" + std::to_string(row) + "\n");
+				}
+			});
+		}
+		for (auto&& thread : threads) {
+			thread.join();
+		}
+		// the queued rows are written upon destruction
+	}
+	auto&& lines = read_lines(path);
+	CHECK(lines.size() == (size_t)(producers * rows));
+	std::vector<int> next(producers, 0);
+	bool is_ordered = true;
+	for (auto&& line : lines) {
+		auto&& cells = tokenize(line, ';');
+		int producer = convert_string_to<int>(cells.at(0));
+		int row = convert_string_to<int>(cells.at(1));
+		is_ordered = is_ordered && row == next.at(producer);
+		next.at(producer) = row + 1;
+	}
+	CHECK(is_ordered);
+}
+
+void test_appended_after_stop() {
+	TemporaryDirectory directory("journal_writer_stopped");
+	std::string path = directory.get_path("journal.csv");
+	{
+		JournalConfig config;
+		config.policy = FsyncPolicy::None;
+		JournalWriter writer(path, config);
+		writer.append("first\n");
+		writer.stop();
+		writer.append("second\n");
+		CHECK(writer.get_queue_depth() >= 1);
+	}
+	CHECK(read_lines(path) == std::vector<std::string>({ "first", "second" }));
+	{
+		// appended to the existing file
+		JournalWriter writer(path);
+		writer.append("third\n");
+	}
+	CHECK(read_lines(path).size() == 3);
+}
+
+int main() {
+	run_test("journal writer producers", test_producers);
+	run_test("journal writer appended after stop", test_appended_after_stop);
+	return finish_tests();
+}
+
+#endif // !JOURNAL_WRITER_TESTS
@@ -0,0 +1,103 @@
+#include <atomic>
+#include <thread>
+
+#include "../include/market_view.h"
+#include "test_support.h"
+
+/**
+ * Versions of the published view increase, a reader keeps its version as long as it wants
+ * and always sees a complete one while the writer publishes
+ */
+
+#ifndef MARKET_VIEW_TESTS
+
+inline static std::shared_ptr<MarketView> make_view(double withdrawal) {
+	auto view = std::make_shared<MarketView>();
+	view->estimated_withdrawal = withdrawal;
+	view->assets.emplace_back("USD", withdrawal);
+	return view;
+}
+
+void test_versions() {
+	VersionedSnapshot<MarketView> snapshot;
+	CHECK(snapshot.read() == nullptr);
+	snapshot.publish(make_view(100));
+	auto&& first = snapshot.read();
+	CHECK(first->version == 1 && first->estimated_withdrawal == 100);
+	snapshot.publish(make_view(200));
+	auto&& second = snapshot.read();
+	CHECK(second->version == 2 && second->estimated_withdrawal == 200);
+	// the former version is still there for its reader
+	CHECK(first->version == 1 && first->estimated_withdrawal == 100);
+	CHECK(first->assets.size() == 1 && first->assets[0].second == 100);
+}
+
+void test_concurrent_readers() {
+	VersionedSnapshot<MarketView> snapshot;
+	snapshot.publish(make_view(0));
+	std::atomic<bool> running = true;
+	std::atomic<size_t> inconsistent = 0;
+	std::atomic<size_t> regressions = 0;
+	std::vector<std::thread> readers;
+	for (int reader = 0; reader < 2; ++reader) {
+		readers.emplace_back([&] {
+			uint64_t seen = 0;
+			while (running) {
+				auto&& view = snapshot.read();
+				// a view is published complete - its fields agree
+				if (view->assets.size() != 1 || view->assets[0].second != view->estimated_withdrawal) {
+					++inconsistent;
+				}
+				if (view->version < seen) {
+					++regressions;
+				}
+				seen = view->version;
+			}
+		});
+	}
+	for (int version = 1; version <= 20000; ++version) {
+		snapshot.publish(make_view(version));
+	}
+	running = false;
+	for (auto&& reader : readers) {
+		reader.join();
+	}
+	CHECK(inconsistent == 0);
+	CHECK(regressions == 0);
+	CHECK(snapshot.read()->version == 20001);
+}
+
+void test_recycling() {
+	VersionedSnapshot<MarketView> snapshot;
+	auto&& first = snapshot.acquire();
+	MarketView* first_address = first.get();
+	snapshot.publish(first);
+	first.reset();
+	auto&& reader = snapshot.read();
+	// the current version is never built again
+	auto&& second = snapshot.acquire();
+	CHECK(second.get() != first_address);
+	snapshot.publish(second);
+	second.reset();
+	// the reader still holds the first version
+	auto&& third = snapshot.acquire();
+	CHECK(third.get() != first_address);
+	snapshot.publish(third);
+	third.reset();
+	CHECK(reader->version == 1);
+	reader.reset();
+	// nobody holds the first version anymore - its memory is reused
+	auto&& fourth = snapshot.acquire();
+	CHECK(fourth.get() == first_address);
+	snapshot.publish(fourth);
+	CHECK(snapshot.read()->version == 4);
+}
+
+int main() {
+	run_test("market view versions", test_versions);
+	run_test("market view recycling", test_recycling);
+	run_test("market view concurrent readers", test_concurrent_readers);
+	return finish_tests();
+}
+
+#endif // !MARKET_VIEW_TESTS
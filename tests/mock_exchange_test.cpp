@@ -0,0 +1,120 @@
+#include "../include/mock_exchange.h"
+#include <cpprest/http_client.h>
+
+#include "test_support.h"
+
+/**
+ * The mock exchange answered over the loopback the way the connectors expect
+ * (shape of the responses, request weight, simulated failures)
+ */
+
+#ifndef MOCK_EXCHANGE_TESTS
+
+inline static MockConfig get_test_config(unsigned short port) {
+	MockConfig config;
+	config.port = port;
+	config.symbol_count = 50;
+	return config;
+}
+
+inline static http_response get(const std::string& url, const std::string& path) {
+	web::http::client::http_client client(utility::conversions::to_string_t(url));
+	return client.request(methods::GET, utility::conversions::to_string_t(path)).get();
+}
+
+inline static size_t get_used_weight(const http_response& response) {
+	auto&& header = response.headers().find(_XPLATSTR("X-MBX-USED-WEIGHT-1M"));
+	if (header == response.headers().end()) {
+		return 0;
+	}
+	return convert_string_to<size_t>(utility::conversions::to_utf8string(header->second));
+}
+
+void test_ticker() {
+	MockExchange exchange(get_test_config(18081));
+	exchange.open();
+	auto&& response = get(exchange.get_url(), "/api/v3/ticker/price");
+	CHECK(response.status_code() == status_codes::OK);
+	CHECK(get_used_weight(response) == 4);
+	auto json = response.extract_json().get();
+	auto&& records = json.as_array();
+	CHECK(records.size() == 50);
+	auto&& first = records.at(0).as_object();
+	CHECK(utility::conversions::to_utf8string(first.at(_XPLATSTR("symbol")).as_string()) == "BTCUSDT");
+	CHECK(convert_string_to<double>(utility::conversions::to_utf8string(first.at(_XPLATSTR("price")).as_string())) > 0);
+	exchange.close();
+}
+
+void test_klines() {
+	MockExchange exchange(get_test_config(18082));
+	exchange.open();
+	auto&& response = get(exchange.get_url(), "/api/v3/klines?symbol=ETHUSDT&interval=1m&limit=5");
+	CHECK(response.status_code() == status_codes::OK);
+	auto json = response.extract_json().get();
+	auto&& klines = json.as_array();
+	CHECK(klines.size() == 5);
+	for (auto&& kline : klines) {
+		auto&& fields = kline.as_array();
+		CHECK(fields.size() == 12);
+		double high = convert_string_to<double>(utility::conversions::to_utf8string(fields.at(2).as_string()));
+		double low = convert_string_to<double>(utility::conversions::to_utf8string(fields.at(3).as_string()));
+		CHECK(low > 0);
+		CHECK(low <= high);
+	}
+	auto&& unknown = get(exchange.get_url(), "/api/v3/klines?symbol=NOPEUSDT&interval=1m");
+	CHECK(unknown.status_code() == status_codes::BadRequest);
+	exchange.close();
+}
+
+void test_malformed_klines() {
+	MockExchange exchange(get_test_config(18085));
+	exchange.open();
+	for (auto&& path : { "/api/v3/klines?symbol=ETHUSDT&interval=1m&limit=five",
+		"/api/v3/klines?symbol=ETHUSDT&interval=1m&startTime=yesterday" }) {
+		auto&& response = get(exchange.get_url(), path);
+		CHECK(response.status_code() == status_codes::BadRequest);
+		CHECK(get_used_weight(response) > 0);
+		auto json = response.extract_json().get();
+		CHECK(json.at(_XPLATSTR("code")).as_integer() == -1100);
+	}
+	exchange.close();
+}
+
+void test_weight_limit() {
+	MockConfig config = get_test_config(18083);
+	config.weight_limit = 10; // two ticker requests per minute
+	MockExchange exchange(config);
+	exchange.open();
+	CHECK(get(exchange.get_url(), "/api/v3/ticker/price").status_code() == status_codes::OK);
+	CHECK(get(exchange.get_url(), "/api/v3/ticker/price").status_code() == status_codes::OK);
+	auto&& rejected = get(exchange.get_url(), "/api/v3/ticker/price");
+	// the minute window may have just rolled over
+	CHECK(rejected.status_code() == status_codes::TooManyRequests || get_used_weight(rejected) <= 8);
+	exchange.close();
+}
+
+void test_simulated_failures() {
+	MockConfig config = get_test_config(18084);
+	config.error_rate = 100;
+	MockExchange exchange(config);
+	exchange.open();
+	for (int i = 0; i < 4; ++i) {
+		auto&& response = get(exchange.get_url(), "/api/v3/ticker/price");
+		auto code = response.status_code();
+		CHECK(code == status_codes::ServiceUnavailable || code == status_codes::TooManyRequests);
+		// the scheduler reads the weight of the failed requests too
+		CHECK(get_used_weight(response) > 0);
+	}
+	exchange.close();
+}
+
+int main() {
+	run_test("mock exchange ticker", test_ticker);
+	run_test("mock exchange klines", test_klines);
+	run_test("mock exchange malformed klines", test_malformed_klines);
+	run_test("mock exchange weight limit", test_weight_limit);
+	run_test("mock exchange simulated failures", test_simulated_failures);
+	return finish_tests();
+}
+
+#endif // !MOCK_EXCHANGE_TESTS
@@ -0,0 +1,146 @@
+#include <cmath>
+#include "../include/mapping.h"
+#include "../include/analysis.h"
+
+#include "test_support.h"
+
+/**
+ * Restart of the analyzer - the state is resumed from the snapshot written upon leaving
+ * and the journal records which follow it
+ */
+
+#ifndef RECOVERY_TESTS
+
+inline static JournalEntry make_entry(JournalEntryType type, const std::string& symbol, double amount, double usd) {
+	JournalEntry entry;
+	entry.type = type;
+	entry.timestamp = get_unix_time_ms();
+	entry.symbol = symbol;
+	entry.amount = amount;
+	entry.xrate = amount > 0 ? -usd / amount : 0;
+	entry.usd = usd;
+	return entry;
+}
+
+/**
+ * @brief Journal of a previous run (the analyzer recovers it when created)
+ */
+inline static void write_journal(const std::vector<JournalEntry>& entries) {
+	std::filesystem::create_directories("transactions");
+	TradeJournal journal("transactions/journal.bin");
+	journal.recover(0, [](const JournalEntry&) { });
+	for (auto&& entry : entries) {
+		journal.append(entry);
+	}
+}
+
+void test_journal_replay() {
+	TemporaryDirectory directory("recovery_journal_replay");
+	WorkingDirectory working(directory.get());
+	write_journal({
+		make_entry(JournalEntryType::Deposit, "", 0, 1000),
+		make_entry(JournalEntryType::Buy, "BTCUSDT", 0.01, -400)
+	});
+	auto symbols = std::make_shared<SymbolTable>();
+	auto analyzer = create_shared<Analyzer>(symbols);
+	CHECK(analyzer->get_balance() == 600);
+	auto&& held = analyzer->get_held_symbols();
+	CHECK(held.size() == 1 && held[0] == "BTCUSDT");
+}
+
+void test_snapshot_resume() {
+	TemporaryDirectory directory("recovery_snapshot_resume");
+	WorkingDirectory working(directory.get());
+	auto symbols = std::make_shared<SymbolTable>();
+	{
+		auto analyzer = create_shared<Analyzer>(symbols);
+		analyzer->deposit(500);
+		// the final snapshot is written upon leaving
+	}
+	CHECK(std::filesystem::exists("transactions/snapshot.0") || std::filesystem::exists("transactions/snapshot.1"));
+	{
+		auto analyzer = create_shared<Analyzer>(symbols);
+		CHECK(analyzer->get_balance() == 500);
+		analyzer->deposit(250);
+	}
+	{
+		// a torn record after the snapshot is dropped, the state stays
+		std::ofstream file("transactions/journal.bin", std::ios::binary | std::ios::app);
+		file.write("\x2A\x00", 2);
+	}
+	auto analyzer = create_shared<Analyzer>(symbols);
+	CHECK(analyzer->get_balance() == 750);
+}
+
+void test_snapshot_rows() {
+	TemporaryDirectory directory("recovery_snapshot_rows");
+	WorkingDirectory working(directory.get());
+	auto symbols = std::make_shared<SymbolTable>();
+	SymbolId btc = symbols->intern("BTCUSDT");
+	SymbolId eth = symbols->intern("ETHUSDT");
+	matrix rows = { { 40, 1, 2, 100 }, { 45, 1, 2, 101 } };
+	{
+		auto analyzer = create_shared<Analyzer>(symbols);
+		analyzer->restore(btc, rows);
+		analyzer->restore(eth, rows);
+		// rows changed after being restored are captured as they are now
+		analyzer->extend(eth, { 102 });
+		CHECK(analyzer->get_rows(eth).size() == 3);
+	}
+	auto analyzer = create_shared<Analyzer>(symbols);
+	CHECK(analyzer->resume(btc));
+	CHECK(analyzer->get_rows(btc) == rows);
+	CHECK(analyzer->resume(eth));
+	CHECK(analyzer->get_rows(eth).size() == 3);
+	CHECK(analyzer->get_rows(eth).back().back() == 102);
+}
+
+void test_withdraw_restart() {
+	TemporaryDirectory directory("recovery_withdraw_restart");
+	WorkingDirectory working(directory.get());
+	write_journal({
+		make_entry(JournalEntryType::Deposit, "", 0, 1000),
+		make_entry(JournalEntryType::Buy, "BTCUSDT", 0.01, -400),
+		make_entry(JournalEntryType::Buy, "ETHUSDT", 1, -100),
+		make_entry(JournalEntryType::Buy, "XRPUSDT", 10, -5)
+	});
+	auto symbols = std::make_shared<SymbolTable>();
+	{
+		auto analyzer = create_shared<Analyzer>(symbols);
+		// ETHUSDT is no longer watched, its latest known price is the last close of its dataset
+		analyzer->restore(symbols->intern("ETHUSDT"), { { 40, 1, 2, 100 }, { 45, 1, 2, 120 } });
+		TokenTable tokens;
+		tokens.insert(symbols->intern("BTCUSDT"), 45000);
+		double withdrawn = analyzer->withdraw(tokens);
+		// the trading fee is deducted as by any sell, XRPUSDT has never been priced
+		CHECK(std::abs(withdrawn - (495 + 450 * 0.995 + 120 * 0.995)) < 1e-9);
+		CHECK(analyzer->get_held_symbols().empty());
+		// the final snapshot follows the withdrawal
+	}
+	// the liquidation is journaled as sells ahead of the withdrawal
+	std::vector<JournalEntry> entries;
+	TradeJournal("transactions/journal.bin").scan(0, UINT64_MAX, [&](const JournalEntry& entry) { entries.push_back(entry); });
+	CHECK(entries.size() == 7);
+	if (entries.size() == 7) {
+		CHECK(entries[4].type == JournalEntryType::Sell && entries[4].symbol == "BTCUSDT"
+			&& std::abs(entries[4].usd - 450 * 0.995) < 1e-9);
+		CHECK(entries[5].type == JournalEntryType::Sell && entries[5].symbol == "ETHUSDT"
+			&& std::abs(entries[5].usd - 120 * 0.995) < 1e-9);
+		CHECK(entries[6].type == JournalEntryType::Withdraw);
+	}
+	// the history is checkpointed with the final snapshot
+	CHECK(std::filesystem::file_size("transactions/history.idx") > 0);
+	auto analyzer = create_shared<Analyzer>(symbols);
+	CHECK(analyzer->get_held_symbols().empty());
+	CHECK(analyzer->get_balance() == 0);
+}
+
+int main() {
+	run_test("recovery journal replay", test_journal_replay);
+	run_test("recovery snapshot resume", test_snapshot_resume);
+	run_test("recovery snapshot rows", test_snapshot_rows);
+	run_test("recovery withdraw and restart", test_withdraw_restart);
+	return finish_tests();
+}
+
+#endif // !RECOVERY_TESTS
@@ -0,0 +1,87 @@
+#include <atomic>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "../include/shard_pool.h"
+#include "test_support.h"
+
+/**
+ * Every shard runs the job, a failing shard is reported to the caller
+ * and the shards are pinned one per core of the analysis role
+ */
+
+#ifndef SHARD_POOL_TESTS
+
+void test_run() {
+	ShardPool pool(3);
+	std::vector<int> runs(3, 0);
+	for (int tick = 0; tick < 100; ++tick) {
+		pool.run([&](size_t shard) { ++runs[shard]; });
+	}
+	CHECK(runs == std::vector<int>({ 100, 100, 100 }));
+}
+
+void test_failure() {
+	ShardPool pool(2);
+	bool thrown = false;
+	try {
+		pool.run([](size_t shard) {
+			if (shard == 1) {
+				throw std::runtime_error("shard 1");
+			}
+		});
+	}
+	catch (std::runtime_error&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+	// the pool is still usable
+	std::atomic<size_t> runs = 0;
+	pool.run([&](size_t) { ++runs; });
+	CHECK(runs == 2);
+}
+
+void test_member_placement() {
+	setenv("TTM_AFFINITY_ANALYSIS", "2-3,5", 1);
+	CHECK(get_member_placement("analysis", 0).cpus == std::vector<int>({ 2 }));
+	CHECK(get_member_placement("analysis", 1).cpus == std::vector<int>({ 3 }));
+	CHECK(get_member_placement("analysis", 2).cpus == std::vector<int>({ 5 }));
+	CHECK(get_member_placement("analysis", 3).cpus == std::vector<int>({ 2 }));
+	unsetenv("TTM_AFFINITY_ANALYSIS");
+	CHECK(get_member_placement("analysis", 1).cpus.empty());
+}
+
+#ifdef TTM_THREAD_TUNING
+
+void test_shard_affinity() {
+	// core 0 is there on any machine - every shard is pinned to it alone
+	setenv("TTM_AFFINITY_ANALYSIS", "0", 1);
+	std::vector<int> cores(2, -1);
+	{
+		ShardPool pool(2);
+		pool.run([&](size_t shard) {
+			if (shard != 0) {
+				cpu_set_t set;
+				CPU_ZERO(&set);
+				pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+				cores[shard] = CPU_COUNT(&set) == 1 && CPU_ISSET(0, &set) ? 0 : CPU_COUNT(&set);
+			}
+		});
+	}
+	unsetenv("TTM_AFFINITY_ANALYSIS");
+	CHECK(cores[1] == 0);
+}
+
+#endif // !TTM_THREAD_TUNING
+
+int main() {
+	run_test("shard pool run", test_run);
+	run_test("shard pool failure", test_failure);
+	run_test("shard pool member placement", test_member_placement);
+#ifdef TTM_THREAD_TUNING
+	run_test("shard pool shard affinity", test_shard_affinity);
+#endif // !TTM_THREAD_TUNING
+	return finish_tests();
+}
+
+#endif // !SHARD_POOL_TESTS
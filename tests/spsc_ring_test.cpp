@@ -0,0 +1,94 @@
+#include <memory>
+#include <thread>
+#include <string>
+
+#include "../include/spsc_ring.h"
+#include "test_support.h"
+
+/**
+ * Single producer single consumer ring - items come out in the order
+ * they went in (across the wrap-around), a full ring rejects without
+ * taking the item, a closed one hands out the rest and ends
+ */
+
+#ifndef SPSC_RING_TESTS
+
+void test_fifo_and_full() {
+	SpscRing<std::string> ring(3);
+	CHECK(ring.get_stats().capacity == 4);
+	for (int i = 0; i < 4; ++i) {
+		std::string item = "item " + std::to_string(i);
+		CHECK(ring.try_push(item));
+	}
+	std::string rejected = "rejected";
+	CHECK(!ring.try_push(rejected));
+	// the producer still owns it (i.e. to conflate it)
+	CHECK(rejected == "rejected");
+	RingStats stats = ring.get_stats();
+	CHECK(stats.depth == 4 && stats.max_depth == 4 && stats.rejected == 1);
+	CHECK(ring.pop() == "item 0");
+	CHECK(ring.pop() == "item 1");
+	// the freed slots are reused after the wrap-around
+	std::string next = "item 4";
+	CHECK(ring.try_push(next));
+	for (int i = 2; i <= 4; ++i) {
+		CHECK(ring.pop() == "item " + std::to_string(i));
+	}
+	CHECK(ring.get_stats().depth == 0);
+}
+
+void test_close() {
+	SpscRing<std::unique_ptr<int>> ring(4);
+	auto first = std::make_unique<int>(1);
+	auto second = std::make_unique<int>(2);
+	CHECK(ring.try_push(first) && ring.try_push(second));
+	CHECK(!first && !second);
+	ring.close();
+	auto late = std::make_unique<int>(3);
+	CHECK(!ring.try_push(late));
+	CHECK(late && *late == 3);
+	// the remaining items are still handed out
+	auto&& popped_first = ring.pop();
+	CHECK(popped_first && *popped_first && **popped_first == 1);
+	auto&& popped_second = ring.pop();
+	CHECK(popped_second && *popped_second && **popped_second == 2);
+	CHECK(!ring.pop().has_value());
+	CHECK(!ring.pop().has_value());
+}
+
+void test_ordering_across_threads() {
+	const uint64_t count = 200000;
+	SpscRing<uint64_t> ring(8);
+	std::thread producer([&ring, count] {
+		for (uint64_t value = 1; value <= count; ++value) {
+			uint64_t item = value;
+			while (!ring.try_push(item)) {
+				std::this_thread::yield();
+			}
+		}
+		ring.close();
+	});
+	uint64_t expected = 1;
+	size_t out_of_order = 0;
+	while (auto&& item = ring.pop()) {
+		if (*item != expected) {
+			++out_of_order;
+		}
+		expected = *item + 1;
+	}
+	producer.join();
+	CHECK(out_of_order == 0);
+	CHECK(expected == count + 1);
+	RingStats stats = ring.get_stats();
+	CHECK(stats.pushed == count && stats.popped == count && stats.depth == 0);
+	CHECK(stats.max_depth <= stats.capacity);
+}
+
+int main() {
+	run_test("spsc ring fifo and full", test_fifo_and_full);
+	run_test("spsc ring close", test_close);
+	run_test("spsc ring ordering across threads", test_ordering_across_threads);
+	return finish_tests();
+}
+
+#endif // !SPSC_RING_TESTS
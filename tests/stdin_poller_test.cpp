@@ -0,0 +1,128 @@
+#include <vector>
+
+#include "../include/stdin_poller.h"
+#include "test_support.h"
+
+/**
+ * Lines of the standard input split across reads, a last line without a newline at EOF,
+ * a line handler which ends the loop and a wake-up (fd 0 is a pipe of the test)
+ */
+
+#ifndef STDIN_POLLER_TESTS
+
+#ifdef TTM_STDIN_POLL
+
+/**
+ * @brief Replaces fd 0 with the read end of a pipe until leaving the scope
+ */
+class PipedStdin {
+public:
+	PipedStdin() {
+		int fds[2];
+		if (pipe(fds) != 0) {
+			throw std::runtime_error("Can't create the stdin pipe");
+		}
+		saved = dup(STDIN_FILENO);
+		dup2(fds[0], STDIN_FILENO);
+		close(fds[0]);
+		writer = fds[1];
+	}
+	PipedStdin(const PipedStdin&) = delete;
+	PipedStdin& operator=(const PipedStdin&) = delete;
+	~PipedStdin() {
+		close_writer();
+		dup2(saved, STDIN_FILENO);
+		close(saved);
+	}
+
+	void write_text(const std::string& text) {
+		[[maybe_unused]] ssize_t written = write(writer, text.data(), text.size());
+	}
+
+	/**
+	 * @brief EOF of the standard input
+	 */
+	void close_writer() {
+		if (writer >= 0) {
+			close(writer);
+			writer = -1;
+		}
+	}
+
+private:
+	int saved = -1;
+	int writer = -1;
+};
+
+void test_line_splitting() {
+	PipedStdin input;
+	StdinPoller poller(false);
+	std::vector<std::string> lines;
+	auto&& collect = [&](const std::string& line) { lines.push_back(line); return true; };
+	input.write_text("ad");
+	CHECK(poller.poll_once(collect));
+	// the line is not complete yet
+	CHECK(lines.empty());
+	input.write_text("d BTCUSDT\r\nremove ETHUSDT\n\nbal");
+	CHECK(poller.poll_once(collect));
+	CHECK(lines == std::vector<std::string>({ "add BTCUSDT", "remove ETHUSDT", "" }));
+	input.write_text("ance\n");
+	CHECK(poller.poll_once(collect));
+	CHECK(lines.size() == 4 && lines.back() == "balance");
+}
+
+void test_eof() {
+	PipedStdin input;
+	StdinPoller poller(false);
+	std::vector<std::string> lines;
+	auto&& collect = [&](const std::string& line) { lines.push_back(line); return true; };
+	input.write_text("help\nwithdraw");
+	CHECK(poller.poll_once(collect));
+	CHECK(lines == std::vector<std::string>({ "help" }));
+	input.close_writer();
+	// the last line does not need to end with a newline
+	CHECK(poller.poll_once(collect));
+	CHECK(lines == std::vector<std::string>({ "help", "withdraw" }));
+	// stdin is not polled anymore - only a wake-up ends the loop
+	poller.wake();
+	CHECK(!poller.poll_once(collect));
+	CHECK(lines.size() == 2);
+}
+
+void test_end_of_loop() {
+	PipedStdin input;
+	StdinPoller poller(false);
+	std::vector<std::string> lines;
+	auto&& until_withdraw = [&](const std::string& line) {
+		lines.push_back(line);
+		return line != "withdraw";
+	};
+	input.write_text("deposit 100\nwithdraw\nhelp\n");
+	CHECK(!poller.poll_once(until_withdraw));
+	CHECK(lines == std::vector<std::string>({ "deposit 100", "withdraw" }));
+	// the rest stays buffered for the next call
+	input.close_writer();
+	CHECK(poller.poll_once(until_withdraw));
+	CHECK(lines.size() == 3 && lines.back() == "help");
+}
+
+void test_wake() {
+	PipedStdin input;
+	StdinPoller poller(false);
+	poller.wake();
+	CHECK(!poller.poll_once([](const std::string&) { return true; }));
+}
+
+#endif // !TTM_STDIN_POLL
+
+int main() {
+#ifdef TTM_STDIN_POLL
+	run_test("stdin poller line splitting", test_line_splitting);
+	run_test("stdin poller eof", test_eof);
+	run_test("stdin poller end of loop", test_end_of_loop);
+	run_test("stdin poller wake", test_wake);
+#endif // !TTM_STDIN_POLL
+	return finish_tests();
+}
+
+#endif // !STDIN_POLLER_TESTS
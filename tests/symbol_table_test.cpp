@@ -0,0 +1,67 @@
+#include <map>
+
+#include "../include/symbol_table.h"
+#include "test_support.h"
+
+/**
+ * Symbols are interned once to dense ids, the per-symbol state is indexed by them
+ * (an erased value does not disturb the others)
+ */
+
+#ifndef SYMBOL_TABLE_TESTS
+
+void test_interning() {
+	SymbolTable symbols;
+	SymbolId btc = symbols.intern("BTCUSDT");
+	SymbolId eth = symbols.intern("ETHUSDT");
+	CHECK(btc == 0 && eth == 1);
+	CHECK(symbols.intern(std::string("BTCUSDT")) == btc);
+	CHECK(symbols.size() == 2);
+	CHECK(symbols.find("ETHUSDT") == eth);
+	CHECK(!symbols.find("XRPUSDT").has_value());
+	// the names stay where they are
+	const std::string& name = symbols.get_name(btc);
+	for (int i = 0; i < 1000; ++i) {
+		symbols.intern("SYN" + std::to_string(i));
+	}
+	CHECK(name == "BTCUSDT" && &name == &symbols.get_name(btc));
+}
+
+void test_symbol_map() {
+	SymbolMap<double> values;
+	CHECK(values.empty() && values.find(3) == nullptr);
+	values[3] = 30;
+	values[0] = 0.5;
+	values[7] = 70;
+	CHECK(values.size() == 3);
+	CHECK(values.at(7) == 70 && values.contains(0) && !values.contains(1));
+	bool thrown = false;
+	try {
+		values.at(1);
+	}
+	catch (std::out_of_range&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+	// the last value takes the place of the erased one
+	CHECK(values.erase(3));
+	CHECK(!values.erase(3));
+	CHECK(values.size() == 2 && values.at(7) == 70 && values.at(0) == 0.5);
+	std::map<SymbolId, double> iterated;
+	for (auto&& [id, value] : values) {
+		iterated[id] = value;
+	}
+	CHECK((iterated == std::map<SymbolId, double>({ { 0, 0.5 }, { 7, 70 } })));
+	values[3] = 33;
+	CHECK(values.at(3) == 33);
+	values.clear();
+	CHECK(values.empty() && !values.contains(7));
+}
+
+int main() {
+	run_test("symbol table interning", test_interning);
+	run_test("symbol table symbol map", test_symbol_map);
+	return finish_tests();
+}
+
+#endif // !SYMBOL_TABLE_TESTS
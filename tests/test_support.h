@@ -0,0 +1,102 @@
+#pragma once
+#include <string>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <system_error>
+
+#include "../include/utilities.h"
+
+/**
+ * Test support header
+ * @brief Checks shared by the test executables
+ * - a test is a function run by run_test, a failing CHECK is reported and the test goes on
+ * - an exception fails the test it has escaped from
+ * - the executable returns nonzero (i.e. ctest reports it) if anything has failed
+ */
+
+#ifndef TEST_SUPPORT
+
+inline static size_t failed_checks = 0;
+
+inline static void check_condition(bool condition, const char* expression, const char* file, int line) {
+	if (!condition) {
+		++failed_checks;
+		print(file, ":", line, ": CHECK(", expression, ") failed\n");
+	}
+}
+
+#define CHECK(condition) check_condition(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
+
+inline static void run_test(const std::string& name, const std::function<void()>& test) {
+	size_t failed_before = failed_checks;
+	try {
+		test();
+	}
+	catch (std::exception& exc) {
+		++failed_checks;
+		print(name, ": unexpected exception: ", exc.what(), "\n");
+	}
+	print(failed_checks == failed_before ? "[passed] " : "[FAILED] ", name, "\n");
+}
+
+/**
+ * @returns exit code of the test executable
+ */
+inline static int finish_tests() {
+	if (failed_checks != 0) {
+		print(failed_checks, " check(s) failed\n");
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Empty directory (under the working directory) removed with its content upon leaving
+ */
+class TemporaryDirectory {
+public:
+	TemporaryDirectory(const std::string& name)
+		: path(std::filesystem::current_path() / name) {
+		std::filesystem::remove_all(path);
+		std::filesystem::create_directories(path);
+	}
+	TemporaryDirectory(const TemporaryDirectory&) = delete;
+	TemporaryDirectory& operator=(const TemporaryDirectory&) = delete;
+	~TemporaryDirectory() {
+		std::error_code ignored;
+		std::filesystem::remove_all(path, ignored);
+	}
+
+	std::string get_path(const std::string& file) const {
+		return (path / file).string();
+	}
+
+	const std::filesystem::path& get() const { return path; }
+
+private:
+	std::filesystem::path path;
+};
+
+/**
+ * @brief Changes the working directory until leaving the scope
+ * (for the parts which keep their files relative to it, i.e. the analyzer)
+ */
+class WorkingDirectory {
+public:
+	WorkingDirectory(const std::filesystem::path& path)
+		: previous(std::filesystem::current_path()) {
+		std::filesystem::current_path(path);
+	}
+	WorkingDirectory(const WorkingDirectory&) = delete;
+	WorkingDirectory& operator=(const WorkingDirectory&) = delete;
+	~WorkingDirectory() {
+		std::error_code ignored;
+		std::filesystem::current_path(previous, ignored);
+	}
+
+private:
+	std::filesystem::path previous;
+};
+
+#endif // !TEST_SUPPORT
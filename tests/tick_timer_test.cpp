@@ -0,0 +1,106 @@
+#include <atomic>
+#include <vector>
+
+#include "../include/tick_timer.h"
+#include "test_support.h"
+
+/**
+ * The ticks keep to their absolute deadlines (the time spent in a tick does not drift them)
+ * and an overdue tick restarts the schedule instead of a burst
+ */
+
+#ifndef TICK_TIMER_TESTS
+
+struct RecordedTick {
+	steady_clock::time_point started;
+	TickInfo info;
+};
+
+/**
+ * @brief Runs the timer until the given number of ticks
+ * @param work - time spent in the tick of an index
+ */
+inline static std::vector<RecordedTick> record_ticks(size_t count, ms interval, const std::function<ms(size_t)>& work) {
+	std::vector<RecordedTick> ticks;
+	std::mutex mutex;
+	std::condition_variable done;
+	{
+		TickTimer timer([&](const TickInfo& info) {
+			{
+				std::lock_guard<std::mutex> guard(mutex);
+				if (ticks.size() == count) {
+					return;
+				}
+				ticks.push_back({ steady_clock::now(), info });
+			}
+			std::this_thread::sleep_for(work(info.index));
+			done.notify_one();
+		}, [interval] { return interval; });
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [&] { return ticks.size() == count; });
+	}
+	return ticks;
+}
+
+void test_drift_free() {
+	ms interval(20);
+	// every tick takes half of the interval - a relative schedule would be 10 ms late per tick
+	auto&& ticks = record_ticks(30, interval, [](size_t) { return ms(10); });
+	// a wall-clock minute moves the schedule - it is measured from the latest one
+	size_t first = 0;
+	for (size_t index = 0; index < ticks.size(); ++index) {
+		if (ticks[index].info.is_minute_boundary) {
+			first = index;
+		}
+	}
+	size_t last = ticks.size() - 1;
+	if (last - first < 10) {
+		print("tick timer drift free: skipped (a minute boundary at the end)\n");
+		return;
+	}
+	auto&& elapsed = std::chrono::duration_cast<ms>(ticks[last].started - ticks[first].started);
+	auto&& expected = interval * (long long)(last - first);
+	// the drift would be (last - first) * 10 ms
+	CHECK(elapsed >= expected - ms(5));
+	CHECK(elapsed <= expected + interval);
+	for (size_t index = 0; index < ticks.size(); ++index) {
+		CHECK(ticks[index].info.index == index);
+	}
+}
+
+void test_overrun() {
+	ms interval(10);
+	// the second tick is 3 intervals long
+	auto&& ticks = record_ticks(6, interval, [](size_t index) { return index == 1 ? ms(35) : ms(0); });
+	auto&& gap = [&](size_t index) {
+		return std::chrono::duration_cast<ms>(ticks[index + 1].started - ticks[index].started);
+	};
+	// the overdue tick is run right away, the following one keeps the interval (no burst)
+	CHECK(gap(1) >= ms(35));
+	CHECK(gap(2) >= interval - ms(2) || ticks[3].info.is_minute_boundary);
+	CHECK(gap(3) >= interval - ms(2) || ticks[4].info.is_minute_boundary);
+}
+
+void test_stats() {
+	ms interval(5);
+	std::atomic<size_t> count = 0;
+	TimerStats stats;
+	{
+		TickTimer timer([&](const TickInfo&) { ++count; }, [interval] { return interval; });
+		std::this_thread::sleep_for(ms(60));
+		timer.stop();
+		stats = timer.get_stats();
+	}
+	CHECK(stats.ticks == count);
+	CHECK(stats.ticks > 1);
+	CHECK(stats.mean_lateness <= stats.max_lateness);
+}
+
+int main() {
+	run_test("tick timer drift free", test_drift_free);
+	run_test("tick timer overrun", test_overrun);
+	run_test("tick timer stats", test_stats);
+	return finish_tests();
+}
+
+#endif // !TICK_TIMER_TESTS
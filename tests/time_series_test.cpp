@@ -0,0 +1,125 @@
+#include <cmath>
+#include <random>
+
+#include "../include/time_series.h"
+#include "test_support.h"
+
+/**
+ * Gorilla compression of the price history - points read back bit exact,
+ * block sealing, range scans, reloading from the disk and the tick appends
+ */
+
+#ifndef TIME_SERIES_TESTS
+
+inline static bool same_bits(double first, double second) {
+	return std::memcmp(&first, &second, sizeof(double)) == 0;
+}
+
+inline static std::vector<std::pair<int64_t, double>> read_all(const TimeSeries& history) {
+	std::vector<std::pair<int64_t, double>> points;
+	history.scan(INT64_MIN, INT64_MAX, [&](int64_t time, double value) { points.emplace_back(time, value); });
+	return points;
+}
+
+void test_round_trip() {
+	std::vector<std::pair<int64_t, double>> points;
+	int64_t time = 1700000000000;
+	// every delta of delta width: the same delta, 7, 12, 20 and 64 bits
+	std::vector<int64_t> deltas = { 1000, 1000, 1000, 1030, 990, 1500, 3000, 200000, 700000, 1LL << 40, 1000, 0 };
+	// the same value, a value within the previous window, a new window, signs and extremes
+	std::vector<double> values = { 100.5, 100.5, 100.25, 100.75, 0.00001234, -3.5, 0.0, -0.0,
+		1e300, 5e-324, 42, 42 };
+	for (size_t i = 0; i < deltas.size(); ++i) {
+		time += deltas[i];
+		points.emplace_back(time, values[i]);
+	}
+	std::mt19937_64 generator(7);
+	std::uniform_int_distribution<int64_t> jitter(-50, 50);
+	double price = 27000;
+	for (int i = 0; i < 5000; ++i) {
+		time += 1000 + jitter(generator);
+		price *= 1 + (double)jitter(generator) / 10000;
+		points.emplace_back(time, std::round(price * 100) / 100);
+	}
+	TimeSeries history;
+	size_t sealed = 0;
+	for (auto&& [point_time, value] : points) {
+		sealed += history.append(point_time, value, 1000) ? 1 : 0;
+	}
+	CHECK(sealed == points.size() / 1000);
+	CHECK(history.get_point_count() == points.size());
+	auto&& decoded = read_all(history);
+	CHECK(decoded.size() == points.size());
+	size_t mismatches = 0;
+	for (size_t i = 0; i < std::min(decoded.size(), points.size()); ++i) {
+		if (decoded[i].first != points[i].first || !same_bits(decoded[i].second, points[i].second)) {
+			++mismatches;
+		}
+	}
+	CHECK(mismatches == 0);
+	// compressed below the 16 bytes of a raw point
+	CHECK(history.get_memory_usage() < points.size() * 16);
+}
+
+void test_range_scan() {
+	TimeSeries history;
+	for (int64_t time = 0; time < 100; ++time) {
+		history.append(time * 1000, (double)time, 16);
+	}
+	// an older point is ignored
+	CHECK(!history.append(5000, 1, 16));
+	CHECK(history.get_point_count() == 100);
+	std::vector<int64_t> times;
+	history.scan(30000, 49000, [&](int64_t time, double value) {
+		CHECK(value == (double)(time / 1000));
+		times.push_back(time);
+	});
+	CHECK(times.size() == 20 && times.front() == 30000 && times.back() == 49000);
+	auto&& range = history.get_time_range();
+	CHECK(range && range->first == 0 && range->second == 99000);
+}
+
+void test_reload() {
+	TemporaryDirectory directory("time_series_reload");
+	auto symbols = std::make_shared<SymbolTable>();
+	SymbolId btc = symbols->intern("BTCUSDT");
+	{
+		TimeSeriesStore store(symbols, directory.get_path("history"), 8);
+		CHECK(store.load() == 0);
+		for (int64_t time = 1; time <= 20; ++time) {
+			store.append(btc, time * 1000, 100.0 + (double)time / 8);
+		}
+		// the block being filled is sealed upon leaving
+	}
+	TimeSeriesStore store(symbols, directory.get_path("history"), 8);
+	CHECK(store.load() == 20);
+	std::vector<double> values;
+	store.scan(btc, 0, INT64_MAX, [&](int64_t, double value) { values.push_back(value); });
+	CHECK(values.size() == 20 && values.back() == 100.0 + 20.0 / 8);
+}
+
+void test_tick_append() {
+	auto symbols = std::make_shared<SymbolTable>();
+	TimeSeriesStore store(symbols);
+	std::vector<SymbolId> watched = { symbols->intern("BTCUSDT"), symbols->intern("ETHUSDT"), symbols->intern("NEWUSDT") };
+	std::vector<double> values = { 27000, 1600, 0 };
+	std::vector<int64_t> updates = { 1000, 1000, 0 };
+	CHECK(store.append_tick(1000, watched, values, updates) == 2);
+	// ETH has not been quoted this tick - its stale price is not repeated
+	values[0] = 27010;
+	updates[0] = 2000;
+	CHECK(store.append_tick(2000, watched, values, updates) == 1);
+	CHECK(store.get_point_count(watched[0]) == 2);
+	CHECK(store.get_point_count(watched[1]) == 1);
+	CHECK(store.get_point_count(watched[2]) == 0);
+}
+
+int main() {
+	run_test("time series round trip", test_round_trip);
+	run_test("time series range scan", test_range_scan);
+	run_test("time series reload", test_reload);
+	run_test("time series tick append", test_tick_append);
+	return finish_tests();
+}
+
+#endif // !TIME_SERIES_TESTS
@@ -0,0 +1,123 @@
+#include <cmath>
+
+#include "../include/transaction_store.h"
+#include "test_support.h"
+
+/**
+ * Transaction history - pages of a time range (newest first), aggregates
+ * of a symbol and the profit or loss booked by the sells
+ */
+
+#ifndef TRANSACTION_STORE_TESTS
+
+const SymbolId btc = 0;
+const SymbolId eth = 1;
+
+inline static bool is_close(double value, double expected) {
+	return std::abs(value - expected) < 1e-9;
+}
+
+/**
+ * @brief A buy of BTC at every even second, of ETH at every odd one (0..19 s)
+ */
+inline static void fill_store(TransactionStore& store) {
+	for (int64_t second = 0; second < 20; ++second) {
+		SymbolId symbol = second % 2 == 0 ? btc : eth;
+		store.append(second * 1000, symbol, TradeSide::Buy, 1, 10, -10);
+	}
+}
+
+void test_paging() {
+	TransactionStore store;
+	fill_store(store);
+	CHECK(store.size() == 20);
+	TradePage first = store.query(std::nullopt, 0, 19000, 1, 8);
+	CHECK(first.total == 20);
+	CHECK(first.rows.size() == 8 && first.rows.front() == 19 && first.rows.back() == 12);
+	TradePage last = store.query(std::nullopt, 0, 19000, 3, 8);
+	CHECK(last.rows.size() == 4 && last.rows.front() == 3 && last.rows.back() == 0);
+	CHECK(store.query(std::nullopt, 0, 19000, 4, 8).rows.empty());
+	// a time range of a symbol
+	TradePage range = store.query(btc, 4000, 11000, 1, 10);
+	CHECK(range.total == 4);
+	CHECK(range.rows.size() == 4 && range.rows.front() == 10 && range.rows.back() == 4);
+	for (uint32_t row : range.rows) {
+		CHECK(store.get_row(row).symbol == btc);
+	}
+	CHECK(store.query(2, 0, 19000, 1, 10).total == 0);
+	CHECK(store.query(std::nullopt, 20000, 30000, 1, 10).total == 0);
+}
+
+void test_aggregates() {
+	TransactionStore store;
+	fill_store(store);
+	// 10 BTC bought for 100 USD, a half sold for 75 USD, the rest for 40 USD
+	CHECK(is_close(store.append(20000, btc, TradeSide::Sell, 5, 15, 75), 25));
+	CHECK(is_close(store.append(21000, btc, TradeSide::Sell, 5, 8, 40), -10));
+	TradeAggregate total = store.aggregate(btc, 0, 21000);
+	CHECK(total.buys == 10 && total.sells == 2);
+	CHECK(is_close(total.volume, 100 + 75 + 40));
+	CHECK(is_close(total.realized_pnl, 15));
+	TradeAggregate sells = store.aggregate(btc, 20000, 20000);
+	CHECK(sells.buys == 0 && sells.sells == 1 && is_close(sells.realized_pnl, 25));
+	TradeAggregate none = store.aggregate(eth, 20000, 21000);
+	CHECK(none.buys == 0 && none.sells == 0 && none.volume == 0);
+	auto&& traded = store.get_symbols();
+	CHECK(traded.size() == 2 && traded[0] == btc && traded[1] == eth);
+}
+
+void test_closed_positions() {
+	TransactionStore store;
+	store.append(1000, btc, TradeSide::Buy, 1, 100, -100);
+	store.append(2000, eth, TradeSide::Buy, 1, 50, -50);
+	// the withdrawal sells what is priced, the rest is dropped
+	CHECK(is_close(store.append(3000, btc, TradeSide::Sell, 1, 120, 120), 20));
+	store.close_positions();
+	// a later buy does not inherit the cost of the dropped position
+	store.append(4000, eth, TradeSide::Buy, 1, 60, -60);
+	CHECK(is_close(store.append(5000, eth, TradeSide::Sell, 1, 70, 70), 10));
+	CHECK(is_close(store.aggregate(eth, 0, 5000).realized_pnl, 10));
+}
+
+void test_checkpoints() {
+	SymbolTable symbol_table;
+	SymbolId btc_id = symbol_table.intern("BTCUSDT");
+	SymbolId eth_id = symbol_table.intern("ETHUSDT");
+	TransactionStore store;
+	store.append(1000, btc_id, TradeSide::Buy, 2, 100, -200);
+	store.append(2000, eth_id, TradeSide::Buy, 1, 50, -50);
+	std::string first = store.take_checkpoint(100, symbol_table);
+	CHECK(TransactionStore::get_checkpoint_offset(first) == 100);
+	CHECK(store.take_checkpoint(100, symbol_table).empty());
+	store.append(3000, btc_id, TradeSide::Sell, 1, 120, 120);
+	std::string second = store.take_checkpoint(150, symbol_table);
+	CHECK(!second.empty());
+
+	// ids of another run differ - the rows are bound by the names
+	SymbolTable restarted_table;
+	restarted_table.intern("XRPUSDT");
+	TransactionStore restarted;
+	CHECK(restarted.load_checkpoint(first, restarted_table));
+	CHECK(restarted.load_checkpoint(second, restarted_table));
+	CHECK(!restarted.load_checkpoint(second.substr(0, second.size() - 1), restarted_table));
+	CHECK(restarted.size() == 3);
+	SymbolId btc_restarted = restarted_table.intern("BTCUSDT");
+	TradeAggregate total = restarted.aggregate(btc_restarted, 0, 3000);
+	CHECK(total.buys == 1 && total.sells == 1 && is_close(total.volume, 320) && is_close(total.realized_pnl, 20));
+	// the position is taken over - the rest is sold at its original cost
+	CHECK(is_close(restarted.append(4000, btc_restarted, TradeSide::Sell, 1, 90, 90), -10));
+	// only the rows after the loaded ones are checkpointed
+	std::string third = restarted.take_checkpoint(200, restarted_table);
+	TransactionStore tail;
+	CHECK(tail.load_checkpoint(third, restarted_table) && tail.size() == 1);
+}
+
+int main() {
+	run_test("transaction store paging", test_paging);
+	run_test("transaction store aggregates", test_aggregates);
+	run_test("transaction store closed positions", test_closed_positions);
+	run_test("transaction store checkpoints", test_checkpoints);
+	return finish_tests();
+}
+
+#endif // !TRANSACTION_STORE_TESTS
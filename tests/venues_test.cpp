@@ -0,0 +1,56 @@
+#include <cmath>
+#include "../include/mapping.h"
+#include "../include/mock_exchange.h"
+#include "../include/connection.h"
+
+#include "test_support.h"
+
+/**
+ * Two local stand-in venues quoting apart merged into the consolidated feed
+ * - a token is bought at the cheaper venue and sold at the dearer one
+ */
+
+#ifndef VENUES_TESTS
+
+void test_two_venues() {
+	MockConfig cheap_config;
+	cheap_config.port = 18091;
+	cheap_config.symbol_count = 20;
+	MockConfig dear_config = cheap_config;
+	dear_config.port = 18092;
+	dear_config.price_scale = 1.01;
+	MockExchange cheap(cheap_config);
+	MockExchange dear(dear_config);
+	cheap.open();
+	dear.open();
+	{
+		auto primary = create_shared<BinanceApiConn>("Cheap", cheap.get_url());
+		auto venue = create_shared<BinanceApiConn>("Dear", dear.get_url());
+		GenericConn conn(primary, { venue });
+		// the secondary venue answers on its own - a later tick merges its prices
+		conn.receive_current_data(false);
+		std::this_thread::sleep_for(ms(500));
+		conn.receive_current_data(false);
+		auto&& watched = conn.filter_set_preferences({ "BTCUSDT" });
+		CHECK(watched.size() == 1);
+		SymbolId btc = *symbols->find("BTCUSDT");
+		size_t position = crypto_actions.find(btc);
+		CHECK(position != TokenTable::npos);
+		TokenQuote quote = crypto_actions.get_quote(btc);
+		CHECK(quote.buy < quote.sell);
+		CHECK(std::abs(quote.value - (quote.buy + quote.sell) / 2) < 1e-9);
+		CHECK(crypto_actions.get_sources()[position] == "Cheap");
+		CHECK(crypto_actions.get_sell_sources()[position] == "Dear");
+		conn.stop_pipeline();
+		conn.finish_tasks();
+	}
+	cheap.close();
+	dear.close();
+}
+
+int main() {
+	run_test("two venues", test_two_venues);
+	return finish_tests();
+}
+
+#endif // !VENUES_TESTS